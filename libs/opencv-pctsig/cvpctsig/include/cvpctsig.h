@@ -7,6 +7,10 @@
 #include "../src/pct_clusterizer.hpp"
 #include "../src/pct_sampler.hpp"
 #include "../src/pct_signatures.hpp"
+#include "../src/policies.hpp"
+#include "../src/prepared_signature.hpp"
 #include "../src/similarity.hpp"
+#include "../src/sqfd_kernel.hpp"
+#include "../src/stage_times.hpp"
 
 #endif //__PCTSIGNATURES__ALL_H__
\ No newline at end of file
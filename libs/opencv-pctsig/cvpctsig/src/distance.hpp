@@ -136,6 +136,9 @@ namespace cv
 			public:
 				DistanceLp(float p) : mP(p) {}
 
+				//ADDED accessor for the distance policies
+				float getP() const { return mP; }
+
 				virtual float operator()(const cv::Mat &points1, int idx1,
 					const cv::Mat &points2, int idx2) const
 				{
@@ -1,4 +1,5 @@
 #include "grayscale_bitmap.hpp"
+#include <algorithm>
 
 namespace cv
 {
@@ -35,8 +36,15 @@ namespace cv
 				}
 
 				// Allocate space for pixel data.
-				std::size_t pixelsPerItem = 32 / mBitsPerPixel;
-				mData.resize((mWidth*mHeight + pixelsPerItem - 1) / pixelsPerItem);
+				if (mBitsPerPixel <= 8)
+				{
+					mPixels.resize(mWidth*mHeight);		//ADDED: unpacked pixels, no shifts and masks when reading the windows
+				}
+				else
+				{
+					std::size_t pixelsPerItem = 32 / mBitsPerPixel;
+					mData.resize((mWidth*mHeight + pixelsPerItem - 1) / pixelsPerItem);
+				}
 
 				// Convert the bitmap to grayscale and fill the pixel data.
 				CV_Assert(grayscaleBitmap.depth() == CV_16U);
@@ -54,19 +62,82 @@ namespace cv
 
 
 			void GrayscaleBitmap::getContrastEntropy(std::size_t x, std::size_t y, double &contrast, double &entropy, std::size_t radius)
+			{
+				computeContrastEntropy(x, y, contrast, entropy, radius, mHistogram, mTouched);
+			}
+
+
+			class Parallel_getContrastEntropy : public ParallelLoopBody
+			{
+			private:
+				const GrayscaleBitmap &mBitmap;
+				const std::vector<cv::Point> &mPoints;
+				std::vector<double> &mContrast;
+				std::vector<double> &mEntropy;
+				std::size_t mRadius;
+
+			public:
+				Parallel_getContrastEntropy(const GrayscaleBitmap &bitmap, const std::vector<cv::Point> &points,
+					std::vector<double> &contrast, std::vector<double> &entropy, std::size_t radius)
+					: mBitmap(bitmap), mPoints(points), mContrast(contrast), mEntropy(entropy), mRadius(radius)
+				{
+				}
+
+				void operator()(const Range &range) const
+				{
+					std::vector<std::uint32_t> histogram(mBitmap.mHistogram.size());	// own histogram for each range
+					std::vector<std::uint32_t> touched;
+					for (int i = range.start; i < range.end; i++)
+					{
+						mBitmap.computeContrastEntropy(mPoints[i].x, mPoints[i].y, mContrast[i], mEntropy[i], mRadius, histogram, touched);
+					}
+				}
+			};
+
+
+			void GrayscaleBitmap::getContrastEntropy(const std::vector<cv::Point> &points, std::vector<double> &contrast, std::vector<double> &entropy,
+				std::size_t radius) const
+			{
+				contrast.resize(points.size());
+				entropy.resize(points.size());
+				parallel_for_(Range(0, static_cast<int>(points.size())), Parallel_getContrastEntropy(*this, points, contrast, entropy, radius));
+			}
+
+
+			void GrayscaleBitmap::computeContrastEntropy(std::size_t x, std::size_t y, double &contrast, double &entropy, std::size_t radius,
+				std::vector<std::uint32_t> &histogram, std::vector<std::uint32_t> &touched) const
 			{
 				std::size_t fromX = (x > radius) ? x - radius : 0;
 				std::size_t fromY = (y > radius) ? y - radius : 0;
 				std::size_t toX = std::min<std::size_t>(mWidth - 1, x + radius + 1);
 				std::size_t toY = std::min<std::size_t>(mHeight - 1, y + radius + 1);
-				for (std::size_t j = fromY; j < toY; ++j)
+				touched.clear();
+				if (!mPixels.empty())
+				{
+					for (std::size_t j = fromY; j < toY; ++j)
+					{
+						const std::uint8_t *row0 = &mPixels[j*mWidth];
+						const std::uint8_t *row1 = row0 + mWidth;
+						for (std::size_t i = fromX; i < toX; ++i)							// for each pixel in the window
+						{
+							updateHistogram(getHistogramOffset(row0[i], row1[i]), histogram, touched);			// match every pixel with all 8 its neighbours
+							updateHistogram(getHistogramOffset(row0[i], row0[i + 1]), histogram, touched);
+							updateHistogram(getHistogramOffset(row0[i], row1[i + 1]), histogram, touched);
+							updateHistogram(getHistogramOffset(row0[i + 1], row1[i]), histogram, touched);		// 4 updates per pixel in the window
+						}
+					}
+				}
+				else
 				{
-					for (std::size_t i = fromX; i < toX; ++i)							// for each pixel in the window
+					for (std::size_t j = fromY; j < toY; ++j)
 					{
-						updateHistogram(getPixel(i, j), getPixel(i, j + 1));			// match every pixel with all 8 its neighbours
-						updateHistogram(getPixel(i, j), getPixel(i + 1, j));
-						updateHistogram(getPixel(i, j), getPixel(i + 1, j + 1));
-						updateHistogram(getPixel(i + 1, j), getPixel(i, j + 1));		// 4 updates per pixel in the window
+						for (std::size_t i = fromX; i < toX; ++i)							// for each pixel in the window
+						{
+							updateHistogram(getHistogramOffset(getPixel(i, j), getPixel(i, j + 1)), histogram, touched);
+							updateHistogram(getHistogramOffset(getPixel(i, j), getPixel(i + 1, j)), histogram, touched);
+							updateHistogram(getHistogramOffset(getPixel(i, j), getPixel(i + 1, j + 1)), histogram, touched);
+							updateHistogram(getHistogramOffset(getPixel(i + 1, j), getPixel(i, j + 1)), histogram, touched);
+						}
 					}
 				}
 
@@ -75,16 +146,34 @@ namespace cv
 
 				std::uint32_t pixelsScale = 1 << mBitsPerPixel;
 				double normalizer = (double)((toX - fromX) * (toY - fromY) * 4);				// four increments per pixel in the window (see above)
+				std::size_t triangle = (std::size_t)pixelsScale * (pixelsScale + 1) / 2;
+				if (touched.size() * 16 < triangle)
+				{
+					// few non-zero bins compared to the histogram size (more bits per pixel),
+					// visit just them in the order of the sweep below, so that the sums are the same
+					std::sort(touched.begin(), touched.end());
+					for (std::size_t k = 0; k < touched.size(); ++k)
+					{
+						std::size_t j = touched[k] >> mBitsPerPixel;
+						std::size_t i = touched[k] & (pixelsScale - 1);
+						double value = (double)histogram[touched[k]] / normalizer;
+						contrast += (i - j) * (i - j) * value;
+						entropy -= value * std::log(value);
+						histogram[touched[k]] = 0;
+					}
+					return;
+				}
+
 				for (std::size_t j = 0; j < pixelsScale; ++j)								// iterate row in a 2D histogram
 				{
 					for (std::size_t i = 0; i <= j; ++i)									// iterate column up to the diagonal in 2D histogram
 					{
-						if (mHistogram[j*pixelsScale + i] != 0) 							// consider only non-zero values
+						if (histogram[j*pixelsScale + i] != 0) 							// consider only non-zero values
 						{
-							double value = (double)mHistogram[j*pixelsScale + i] / normalizer;	// normalize value by number of histogram updates
+							double value = (double)histogram[j*pixelsScale + i] / normalizer;	// normalize value by number of histogram updates
 							contrast += (i - j) * (i - j) * value;		// compute contrast
 							entropy -= value * std::log(value);			// compute entropy
-							mHistogram[j*pixelsScale + i] = 0;			// clear the histogram array for the next computation
+							histogram[j*pixelsScale + i] = 0;			// clear the histogram array for the next computation
 						}
 					}
 				}
@@ -77,6 +77,17 @@ namespace cv
 				*/
 				virtual void getContrastEntropy(std::size_t x, std::size_t y, double &contrast, double &entropy, std::size_t windowRadius = 5);
 
+				/**
+				* \brief Compute contrast and entropy at all selected coordinates in parallel.
+				*		The results are the same as of getContrastEntropy called for each point.
+				* \param points Coordinates of the pixels.
+				* \param contrast Output vector of contrast values (one per point).
+				* \param entropy Output vector of entropy values (one per point).
+				* \param windowRadius Radius of the rectangular window, see getContrastEntropy.
+				*/
+				virtual void getContrastEntropy(const std::vector<cv::Point> &points, std::vector<double> &contrast, std::vector<double> &entropy,
+					std::size_t windowRadius = 5) const;
+
 
 				virtual void convertToMat(const cv::OutputArray _bitmap, bool normalize = false) const;
 
@@ -90,7 +101,9 @@ namespace cv
 
 			private:
 				std::vector<std::uint32_t> mData;		///< Pixel data packed in 32-bit uints.
+				std::vector<std::uint8_t> mPixels;		///< Unpacked pixel data, one byte per pixel (used instead of mData if bitsPerPixel <= 8).
 				std::vector<std::uint32_t> mHistogram;	///< Tmp matrix used for computing contrast and entropy.
+				std::vector<std::uint32_t> mTouched;	///< Tmp list of non-zero histogram bins.
 
 
 				/**
@@ -101,6 +114,10 @@ namespace cv
 				*/
 				std::uint32_t getPixel(std::size_t x, std::size_t y) const
 				{
+					if (!mPixels.empty())
+					{
+						return mPixels[y*mWidth + x];
+					}
 					std::size_t pixelsPerItem = 32 / mBitsPerPixel;
 					std::size_t offset = y*mWidth + x;
 					std::size_t shift = (offset % pixelsPerItem) * mBitsPerPixel;
@@ -116,6 +133,11 @@ namespace cv
 				*/
 				void setPixel(std::size_t x, std::size_t y, std::uint32_t val)
 				{
+					if (!mPixels.empty())
+					{
+						mPixels[y*mWidth + x] = static_cast<std::uint8_t>(val & ((1 << mBitsPerPixel) - 1));
+						return;
+					}
 					std::size_t pixelsPerItem = 32 / mBitsPerPixel;
 					std::size_t offset = y*mWidth + x;
 					std::size_t shift = (offset % pixelsPerItem) * mBitsPerPixel;
@@ -126,14 +148,33 @@ namespace cv
 				}
 
 				/**
-				* \brief Perform an update of contrast matrix.
+				* \brief Histogram bin of a pair of pixels.
 				*/
-				void updateHistogram(std::uint32_t a, std::uint32_t b)
+				std::uint32_t getHistogramOffset(std::uint32_t a, std::uint32_t b) const
 				{
-					int offset = (int)((a > b) ? (a << mBitsPerPixel) + b : a + (b << mBitsPerPixel));	// merge to a variable with greater higher bits
-					mHistogram[offset]++;												// to accumulate just in a triangle in 2D histogram for efficiency
+					return (a > b) ? (a << mBitsPerPixel) + b : a + (b << mBitsPerPixel);	// merge to a variable with greater higher bits
+				}																			// to accumulate just in a triangle in 2D histogram for efficiency
+
+				/**
+				* \brief Perform an update of contrast matrix, newly non-zero bins are added to the touched list.
+				*/
+				static void updateHistogram(std::uint32_t offset, std::vector<std::uint32_t> &histogram, std::vector<std::uint32_t> &touched)
+				{
+					if (histogram[offset]++ == 0)
+					{
+						touched.push_back(offset);
+					}
 				}
 
+				/**
+				* \brief Compute contrast and entropy at selected coordinates using the given temporary histogram.
+				*		The histogram must be zero and is cleared again before returning.
+				*/
+				void computeContrastEntropy(std::size_t x, std::size_t y, double &contrast, double &entropy, std::size_t radius,
+					std::vector<std::uint32_t> &histogram, std::vector<std::uint32_t> &touched) const;
+
+				friend class Parallel_getContrastEntropy;
+
 
 			};
 		}
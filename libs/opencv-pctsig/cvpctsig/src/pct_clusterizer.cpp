@@ -1,4 +1,7 @@
 #include "pct_clusterizer.hpp"
+#include "policies.hpp"
+#include "sqfd_kernel.hpp"
+#include <cstring>
 
 namespace cv
 {
@@ -24,15 +27,13 @@ namespace cv
 					mClusterMinSize(clusterMinSize),
 					mJoiningDistance(joiningDistance),
 					mDropThreshold(dropThreshold),
-					mLpNorm(LpNorm),
-					mDistance(*createDistance(LpNorm))
+					mLpNorm(LpNorm)
 				{
 
 				}
 
 				~PCTClusterizer_Impl()
 				{
-					delete(&mDistance);
 				}
 
 
@@ -54,17 +55,17 @@ namespace cv
 				void setLpNorm(float LpNorm)								
 				{ 
 					mLpNorm = LpNorm; 
-					delete(&mDistance);
-					mDistance = *createDistance(LpNorm);
 				}
 
 
 				/**
 				* \brief Join clusters that are closer than joining distance.
 				*		If two clusters are joined one of them gets its weight set to 0.
+				* \param distance Distance policy.
 				* \param clusters List of clusters to be scaned and joined.
 				*/
-				void joinCloseClusters(cv::Mat clusters)
+				template<class Dist>
+				void joinCloseClusters(const Dist &distance, cv::Mat clusters)
 				{
 					for (int i = 0; i < clusters.rows - 1; i++)
 					{
@@ -75,7 +76,7 @@ namespace cv
 
 						for (int j = i + 1; j < clusters.rows; j++)
 						{
-							if (clusters.at<float>(j, WEIGHT_IDX) > 0 && mDistance(clusters, i, clusters, j) <= mJoiningDistance)
+							if (clusters.at<float>(j, WEIGHT_IDX) > 0 && distance(clusters.ptr<float>(i), clusters.ptr<float>(j)) <= mJoiningDistance)
 							{
 								clusters.at<float>(i, WEIGHT_IDX) = 0;
 								break;
@@ -119,18 +120,19 @@ namespace cv
 
 				/**
 				* \brief Find closest cluster to selected point.
+				* \param distanceFunction Distance policy.
 				* \param clusters List of cluster centroids.
-				* \param points List of points.
-				* \param pointIdx Index to the list of points (the point for which the closest cluster is being found).
+				* \param point Row of the point for which the closest cluster is being found.
 				* \return Index to clusters list pointing at the closest cluster.
 				*/
-				int findClosestCluster(Mat &clusters, Mat &points, int pointIdx) const
+				template<class Dist>
+				int findClosestCluster(const Dist &distanceFunction, const Mat &clusters, const float *point) const
 				{
 					int iClosest = 0;
-					float minDistance = mDistance(clusters, 0, points, pointIdx);
+					float minDistance = distanceFunction(clusters.ptr<float>(0), point);
 					for (int iCluster = 1; iCluster < clusters.rows; iCluster++)
 					{
-						float distance = mDistance(clusters, iCluster, points, pointIdx);
+						float distance = distanceFunction(clusters.ptr<float>(iCluster), point);
 						if (distance < minDistance)
 						{
 							iClosest = iCluster;
@@ -141,6 +143,100 @@ namespace cv
 				}
 
 
+				/**
+				* \brief Samples assigned by one parallel task.
+				*/
+				static const int ASSIGNMENT_BLOCK = 256;
+
+				/**
+				* \brief Assigns blocks of samples to their closest clusters in parallel.
+				*		Uses the vectorized kernel on transposed clusters if it supports the Lp norm.
+				*/
+				template<class Dist>
+				class Parallel_assignClusters : public ParallelLoopBody
+				{
+				private:
+					const PCTClusterizer_Impl &mClusterizer;
+					const Dist &mDistance;
+					const Mat &mSamples;
+					const Mat &mClusters;
+					const SQFDBlock *mBlock;		///< Transposed clusters, null if the kernel is not used.
+					SQFDNorm mNorm;
+					std::vector<int> &mLabels;
+
+				public:
+					Parallel_assignClusters(const PCTClusterizer_Impl &clusterizer, const Dist &distance, const Mat &samples, const Mat &clusters,
+						const SQFDBlock *block, SQFDNorm norm, std::vector<int> &labels)
+						: mClusterizer(clusterizer), mDistance(distance), mSamples(samples), mClusters(clusters),
+						mBlock(block), mNorm(norm), mLabels(labels)
+					{
+					}
+
+					void operator()(const Range &range) const
+					{
+						if (mBlock == nullptr)
+						{
+							for (int iSample = range.start; iSample < range.end; iSample++)
+							{
+								mLabels[iSample] = mClusterizer.findClosestCluster(mDistance, mClusters, mSamples.ptr<float>(iSample));
+							}
+							return;
+						}
+
+						std::vector<float> distances(mClusters.rows);
+						for (int iSample = range.start; iSample < range.end; iSample++)
+						{
+							SQFDKernel::computeDistances(mSamples.ptr<float>(iSample), *mBlock, mNorm, distances.data());
+
+							int iClosest = 0;				// same order of comparisons as findClosestCluster
+							for (int iCluster = 1; iCluster < mClusters.rows; iCluster++)
+							{
+								if (distances[iCluster] < distances[iClosest])
+								{
+									iClosest = iCluster;
+								}
+							}
+							mLabels[iSample] = iClosest;
+						}
+					}
+				};
+
+
+				/**
+				* \brief Compares the centroids and weights of two cluster lists bitwise.
+				*/
+				static bool equalClusters(const Mat &clusters1, const Mat &clusters2)
+				{
+					if (clusters1.rows != clusters2.rows)
+					{
+						return false;
+					}
+					for (int i = 0; i < clusters1.rows; i++)
+					{
+						if (std::memcmp(clusters1.ptr<float>(i), clusters2.ptr<float>(i), SIGNATURE_DIMENSION * sizeof(float)) != 0)
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+
+				/**
+				* \brief Tests whether all clusters are larger than the minimal size of an iteration.
+				*/
+				bool keepsAllClusters(const Mat &clusters, int iteration) const
+				{
+					for (int i = 0; i < clusters.rows; i++)
+					{
+						if (!(clusters.at<float>(i, WEIGHT_IDX) > (iteration + 1) * this->mClusterMinSize))
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+
+
 				/**
 				* \brief Make sure that the number of clusters does not exceed maxClusters parameter.
 				*		If it does, the clusters are sorted by their weights and the smallest clusters
@@ -221,7 +317,39 @@ namespace cv
 					}
 				}
 
-				void clusterize(const cv::InputArray _samples, cv::OutputArray _signature)
+				/**
+				* \brief Instantiates the clustering for the distance policy of mLpNorm.
+				*/
+				struct ClusterizeVisitor
+				{
+					typedef void result_type;
+
+					PCTClusterizer_Impl &mClusterizer;
+					const cv::InputArray &mSamples;
+					const cv::OutputArray &mSignature;
+
+					ClusterizeVisitor(PCTClusterizer_Impl &clusterizer, const cv::InputArray &samples, const cv::OutputArray &signature)
+						: mClusterizer(clusterizer), mSamples(samples), mSignature(signature) {}
+
+					template<class Dist>
+					void operator()(const Dist &distance) const
+					{
+						mClusterizer.clusterize(distance, mSamples, mSignature);
+					}
+				};
+
+				void clusterize(const cv::InputArray _samples, cv::OutputArray _signature, StageTimes *times)
+				{
+					int64 start = getTickCount();
+					policy::visitDistance<policy::DIMENSIONS>(mLpNorm, ClusterizeVisitor(*this, _samples, _signature));
+					if (times != nullptr)
+					{
+						times->mClustering += (getTickCount() - start) / getTickFrequency();
+					}
+				}
+
+				template<class Dist>
+				void clusterize(const Dist &distance, const cv::InputArray _samples, cv::OutputArray _signature)
 				{
 					CV_Assert(!_samples.empty());
 
@@ -240,13 +368,28 @@ namespace cv
 
 
 					// prepare for iterating
-					joinCloseClusters(clusters);
+					joinCloseClusters(distance, clusters);
 					dropLightPoints(clusters);
 
 
+					SQFDNorm norm;
+					bool vectorized = SQFDKernel::resolve(mLpNorm, norm);
+					SQFDBlock block;
+					std::vector<int> labels(samples.rows);
+					Mat previousClusters;
+					bool converged = false;
+
 					// Main iterations cycle. Our implementation has fixed number of iterations.
 					for (int iteration = 0; iteration < this->mIterationCount; iteration++)
 					{
+						//ADDED: once the clusters did not change in an iteration, the following iterations produce the same clusters
+						// until the growing minimal cluster size drops some of them, so they are skipped until then
+						if (converged && keepsAllClusters(clusters, iteration))
+						{
+							continue;
+						}
+						clusters.copyTo(previousClusters);
+
 						// Prepare space for new centroid values.
 						Mat tmpCentroids(clusters.size(), clusters.type());
 						tmpCentroids = 0;
@@ -254,13 +397,24 @@ namespace cv
 						// Clear weights for new iteration.
 						clusters(Rect(WEIGHT_IDX, 0, 1, clusters.rows)) = 0;
 						
-						// Compute affiliation of points and sum new coordinates for centroids.
+						// Compute affiliation of points in parallel blocks.				//MODIFIED: was findClosestCluster per sample in this loop
+						if (vectorized)
+						{
+							block.assign(clusters);
+						}
+						parallel_for_(Range(0, samples.rows),
+							Parallel_assignClusters<Dist>(*this, distance, samples, clusters, vectorized ? &block : nullptr, norm, labels),
+							(double)(samples.rows + ASSIGNMENT_BLOCK - 1) / ASSIGNMENT_BLOCK);
+
+						// Sum new coordinates for centroids in the order of samples (the sums do not depend on the number of threads).
 						for (int iSample = 0; iSample < samples.rows; iSample++)
 						{
-							int iClosest = findClosestCluster(clusters, samples, iSample);
+							int iClosest = labels[iSample];
+							const float *sample = samples.ptr<float>(iSample);
+							float *centroid = tmpCentroids.ptr<float>(iClosest);
 							for (int iDimension = 0; iDimension < SIGNATURE_DIMENSION - 1; iDimension++)	
 							{
-								tmpCentroids.at<float>(iClosest, iDimension) += samples.at<float>(iSample, iDimension);
+								centroid[iDimension] += sample[iDimension];
 							}
 							clusters.at<float>(iClosest, WEIGHT_IDX)++;
 						}
@@ -290,8 +444,10 @@ namespace cv
 						}
 
 						// Finally join clusters with too close centroids.
-						joinCloseClusters(clusters);
+						joinCloseClusters(distance, clusters);
 						dropLightPoints(clusters);
+
+						converged = equalClusters(previousClusters, clusters);
 					}
 
 					// The result must not be empty!
@@ -351,8 +507,6 @@ namespace cv
 				* \note The values MIGHT be restricted to following: 0.125, 0.25, 0.5, 1.0, 2.0, and 5.0.
 				*/
 				float mLpNorm;
-
-				Distance &mDistance;
 			};
 
 
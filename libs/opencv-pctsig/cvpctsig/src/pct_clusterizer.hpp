@@ -16,6 +16,7 @@
 #include "opencv2/core.hpp"
 #include "constants.hpp"
 #include "distance.hpp"
+#include "stage_times.hpp"
 
 
 namespace cv
@@ -57,7 +58,13 @@ namespace cv
 				virtual void setDropThreshold(float dropThreshold) = 0;
 				virtual void setLpNorm(float LpNorm) = 0;
 
-				virtual void clusterize(const cv::InputArray samples, cv::OutputArray signature) = 0;
+				//MODIFIED: the clustering time is added to times unless it is null
+				virtual void clusterize(const cv::InputArray samples, cv::OutputArray signature, StageTimes *times) = 0;
+
+				void clusterize(const cv::InputArray samples, cv::OutputArray signature)
+				{
+					clusterize(samples, signature, nullptr);
+				}
 			};
 		}
 	}
@@ -1,4 +1,5 @@
 #include "pct_sampler.hpp"
+#include <cstring>
 
 namespace cv
 {
@@ -118,8 +119,10 @@ namespace cv
 
 
 
-				virtual void sample(const cv::InputArray &_image, cv::OutputArray &_samples) const
+				virtual void sample(const cv::InputArray &_image, cv::OutputArray &_samples, StageTimes *times) const
 				{
+					int64 start = getTickCount();
+
 					// check init points size
 					if (mInitPoints.size() < mSampleCount)
 					{
@@ -132,39 +135,76 @@ namespace cv
 					cv::Mat image = _image.getMat();
 					_samples.create(static_cast<int>(mSampleCount), SIGNATURE_DIMENSION, CV_32F);
 					cv::Mat samples = _samples.getMat();
+					int64 bitmapStart = getTickCount();
 					GrayscaleBitmap grayscaleBitmap(image, mGrayscaleBits);
+					int64 bitmapEnd = getTickCount();
 
 					// debug
 					//cv::Mat gs;
 					//grayscaleBitmap.convertToMat(gs, true);
 
+					if (mSampleCount <= 0)
+					{
+						if (times != nullptr)
+						{
+							times->mBitmap += (bitmapEnd - bitmapStart) / getTickFrequency();
+						}
+						return;
+					}
+
 
+					// sample positions and their pixels in one row, the colors are converted by a single cvtColor call
+					std::vector<cv::Point> points(mSampleCount);
+					Mat pixels(1, mSampleCount, image.type());		//MODIFIED: was a 1x1 Mat and a cvtColor call per sample
+					size_t pixelSize = image.elemSize();
 					for (int iSample = 0; iSample < mSampleCount; iSample++)
 					{
 						int x = static_cast<int>(mInitPoints[iSample].x * (image.cols - 1) + 0.5);
 						int y = static_cast<int>(mInitPoints[iSample].y * (image.rows - 1) + 0.5);
+						points[iSample] = cv::Point(x, y);
+						std::memcpy(pixels.ptr(0, iSample), image.ptr(y, x), pixelSize);
+					}
+
+					Mat labPixels;
+					pixels.convertTo(pixels, CV_32FC3, 1.0 / 255);
+					cvtColor(pixels, labPixels, COLOR_BGR2Lab);
+
+					std::vector<double> contrasts, entropies;		//ADDED: texture of all samples in one parallel pass
+					int64 textureStart = getTickCount();
+					grayscaleBitmap.getContrastEntropy(points, contrasts, entropies, mWindowRadius);
+					int64 textureEnd = getTickCount();
+
+					for (int iSample = 0; iSample < mSampleCount; iSample++)
+					{
+						int x = points[iSample].x;
+						int y = points[iSample].y;
 
 						samples.at<float>(iSample, X_IDX) = static_cast<float>(static_cast<double>(x) / static_cast<double>(image.cols) * mWeights[X_IDX] + mTranslations[X_IDX]);	// x, y normalized
 						samples.at<float>(iSample, Y_IDX) = static_cast<float>(static_cast<double>(y) / static_cast<double>(image.rows) * mWeights[Y_IDX] + mTranslations[Y_IDX]);
 
-						Mat rgbPixel(image, Rect(x, y, 1, 1));				// get Lab pixel color
-						Mat labPixel;										// placeholder -> TODO: optimize
-						rgbPixel.convertTo(rgbPixel, CV_32FC3, 1.0 / 255);
-						cvtColor(rgbPixel, labPixel, COLOR_BGR2Lab);
-						Vec3f labColor = labPixel.at<Vec3f>(0, 0);			// end
+						Vec3f labColor = labPixels.at<Vec3f>(0, iSample);	// get Lab pixel color
 
 						samples.at<float>(iSample, L_IDX) = static_cast<float>(std::floor(labColor[0] + 0.5) / L_COLOR_RANGE * mWeights[L_IDX] + mTranslations[L_IDX]);	// Lab color normalized
 						samples.at<float>(iSample, A_IDX) = static_cast<float>(std::floor(labColor[1] + 0.5) / A_COLOR_RANGE * mWeights[A_IDX] + mTranslations[A_IDX]);
 						samples.at<float>(iSample, B_IDX) = static_cast<float>(std::floor(labColor[2] + 0.5) / B_COLOR_RANGE * mWeights[B_IDX] + mTranslations[B_IDX]);
 
-						double contrast = 0.0, entropy = 0.0;
-						grayscaleBitmap.getContrastEntropy(x, y, contrast, entropy, mWindowRadius);
+						double contrast = contrasts[iSample], entropy = entropies[iSample];
 						samples.at<float>(iSample, CONTRAST_IDX)
 							= static_cast<float>(contrast / SAMPLER_CONTRAST_NORMALIZER * mWeights[CONTRAST_IDX] + mTranslations[CONTRAST_IDX]);			// contrast
 						samples.at<float>(iSample, ENTROPY_IDX)
 							= static_cast<float>(entropy / SAMPLER_ENTROPY_NORMALIZER * mWeights[ENTROPY_IDX] + mTranslations[ENTROPY_IDX]);				// entropy
 					}
 
+					if (times != nullptr)
+					{
+						double frequency = getTickFrequency();
+						int64 end = getTickCount();
+						times->mBitmap += (bitmapEnd - bitmapStart) / frequency;
+						times->mTexture += (textureEnd - textureStart) / frequency;
+						times->mSampling += ((end - start) - (bitmapEnd - bitmapStart) - (textureEnd - textureStart)) / frequency;
+						times->mSamples += mSampleCount;
+					}
+
 				}
 			};
 
@@ -16,6 +16,7 @@
 #include "opencv2/core.hpp"
 #include "constants.hpp"
 #include "grayscale_bitmap.hpp"
+#include "stage_times.hpp"
 
 
 namespace cv
@@ -35,7 +36,13 @@ namespace cv
 					int						windowRadius = 5);
 
 				
-				virtual void sample(const cv::InputArray image, cv::OutputArray samples) const = 0;
+				//MODIFIED: the bitmap, texture and sampling times are added to times unless it is null
+				virtual void sample(const cv::InputArray image, cv::OutputArray samples, StageTimes *times) const = 0;
+
+				void sample(const cv::InputArray image, cv::OutputArray samples) const
+				{
+					sample(image, samples, nullptr);
+				}
 
 				
 				/**** accessors ****/
@@ -1,4 +1,6 @@
 #include "pct_signatures.hpp"
+#include "sqfd_kernel.hpp"
+#include "policies.hpp"
 #include <iostream>
 
 using namespace cv::xfeatures2d::pct_signatures;
@@ -22,6 +24,10 @@ namespace cv
 
 				void computeSignatures(const std::vector<Mat> &images, std::vector<Mat> &signatures) const;
 
+				void computeSamples(InputArray image, OutputArray samples, StageTimes *times) const;
+
+				void computeSignatureFromSamples(InputArray samples, OutputArray signature, StageTimes *times) const;
+
 				
 				/**** sampler ****/
 				int getSampleCount() const				{ return mSampler->getSampleCount(); }
@@ -99,27 +105,51 @@ namespace cv
 				}
 			};
 
-			class Parallel_computeSQFDs : public ParallelLoopBody
+			class Parallel_prepareSignatures : public ParallelLoopBody
 			{
 			private:
-				const Mat &mSourceSignature;
-				const std::vector<Mat> &mImageSignatures;
-				std::vector<float> &mDistances;
+				const std::vector<Mat> &mSignatures;
+				std::vector<PreparedSignature> &mPreparedSignatures;
 				const Similarity &mSimilarity;
 
 			public:
-				Parallel_computeSQFDs(const Mat &sourceSignature, const std::vector<Mat> &imageSignatures, std::vector<float> &distances,
-					const Similarity &similarity)
-					: mSourceSignature(sourceSignature), mImageSignatures(imageSignatures), mDistances(distances), mSimilarity(similarity)
+				Parallel_prepareSignatures(const std::vector<Mat> &signatures, std::vector<PreparedSignature> &preparedSignatures, const Similarity &similarity)
+					: mSignatures(signatures), mPreparedSignatures(preparedSignatures), mSimilarity(similarity)
 				{
-					mDistances.resize(imageSignatures.size());
+					mPreparedSignatures.resize(signatures.size());
 				}
 
 				void operator()(const Range &range) const
 				{
 					for (int i = range.start; i < range.end; i++)
 					{
-						mDistances[i] = PCTSignatures::computeQuadraticFormDistance(mSourceSignature, mImageSignatures[i], mSimilarity);
+						mPreparedSignatures[i].prepare(mSignatures[i], mSimilarity);
+					}
+				}
+			};
+
+			class Parallel_computePreparedSQFDs : public ParallelLoopBody
+			{
+			private:
+				const std::vector<PreparedSignature> &mSourceSignatures;
+				const std::vector<PreparedSignature> &mImageSignatures;
+				Mat &mDistances;
+
+			public:
+				Parallel_computePreparedSQFDs(const std::vector<PreparedSignature> &sourceSignatures, const std::vector<PreparedSignature> &imageSignatures, Mat &distances)
+					: mSourceSignatures(sourceSignatures), mImageSignatures(imageSignatures), mDistances(distances)
+				{
+				}
+
+				void operator()(const Range &range) const
+				{
+					// an image signature is compared with all source signatures before the next one is loaded
+					for (int j = range.start; j < range.end; j++)
+					{
+						for (int i = 0; i < static_cast<int>(mSourceSignatures.size()); i++)
+						{
+							mDistances.at<float>(i, j) = PCTSignatures::computeQuadraticFormDistance(mSourceSignatures[i], mImageSignatures[j]);
+						}
 					}
 				}
 			};
@@ -142,13 +172,25 @@ namespace cv
 
 				// sample features
 				Mat samples;
-				mSampler->sample(image, samples);
+				computeSamples(image, samples, nullptr);
 
 				// kmeans clusterize, use feature samples, produce signature clusters
+				computeSignatureFromSamples(samples, _signature, nullptr);
+			}
+
+			void PCTSignatures_Impl::computeSamples(InputArray _image, OutputArray _samples, StageTimes *times) const
+			{
+				Mat image = _image.getMat();
+				CV_Assert(image.depth() == CV_8U);	// uchar
+
+				mSampler->sample(image, _samples, times);
+			}
+
+			void PCTSignatures_Impl::computeSignatureFromSamples(InputArray _samples, OutputArray _signature, StageTimes *times) const
+			{
 				Mat signature;
-				mClusterizer->clusterize(samples, signature);
+				mClusterizer->clusterize(_samples, signature, times);
 
-				
 				// set result
 				_signature.create(signature.size(), signature.type());
 				Mat result = _signature.getMat();
@@ -250,6 +292,22 @@ namespace cv
 		}
 
 		
+		/**
+		* \brief Checks the signatures of a distance.
+		*/
+		static void checkSignatures(const Mat &signature0, const Mat &signature1)
+		{
+			if (signature0.cols != SIGNATURE_DIMENSION || signature1.cols != SIGNATURE_DIMENSION)
+			{
+				CV_Error_(CV_StsBadArg, ("Signature dimension must be %d!", SIGNATURE_DIMENSION));
+			}
+
+			if (signature0.rows <= 0 || signature1.rows <= 0)
+			{
+				CV_Error(CV_StsBadArg, "Signature count must be greater than 0!");
+			}
+		}
+
 		float PCTSignatures::computeQuadraticFormDistance(const InputArray _signature0, const InputArray _signature1, const Similarity &similarity)
 		{
 			// check input
@@ -260,30 +318,92 @@ namespace cv
 
 			Mat signature0 = _signature0.getMat();
 			Mat signature1 = _signature1.getMat();
+			checkSignatures(signature0, signature1);
 
-			if (signature0.cols != SIGNATURE_DIMENSION || signature1.cols != SIGNATURE_DIMENSION)
+			// compute sqfd
+			//MODIFIED use the vectorized kernel if it supports the similarity, otherwise the policy
+			//instantiation of the similarity; only unknown similarities are called virtually
+			SQFDKernel kernel(similarity);
+			if (kernel.isSupported())
 			{
-				CV_Error_(CV_StsBadArg, ("Signature dimension must be %d!", SIGNATURE_DIMENSION));
+				return sqrt(kernel.computeSquared(signature0, signature1));
 			}
 
-			if (signature0.rows <= 0 || signature1.rows <= 0)
+			float result = 0;
+			if (!policy::visitSimilarity<policy::DIMENSIONS>(similarity, policy::SquaredSQFD(signature0, signature1), result))
 			{
-				CV_Error(CV_StsBadArg, "Signature count must be greater than 0!");
+				result += computePartialSQFD(signature0, signature0, similarity);
+				result += computePartialSQFD(signature1, signature1, similarity);
+				result -= computePartialSQFD(signature0, signature1, similarity) * 2;
 			}
 
-			// compute sqfd
-			float result = 0;
-			result += computePartialSQFD(signature0, signature0, similarity);
-			result += computePartialSQFD(signature1, signature1, similarity);
-			result -= computePartialSQFD(signature0, signature1, similarity) * 2;
-
 			return sqrt(result);
 		}
 
+		float PCTSignatures::computeQuadraticFormDistance(const InputArray _signature0, const InputArray _signature1, const SQFDKernel &kernel)
+		{
+			if (_signature0.empty() || _signature1.empty())
+			{
+				CV_Error(CV_StsBadArg, "Empty signature!");
+			}
+
+			Mat signature0 = _signature0.getMat();
+			Mat signature1 = _signature1.getMat();
+			checkSignatures(signature0, signature1);
+
+			return sqrt(kernel.computeSquared(signature0, signature1));
+		}
+
 		void PCTSignatures::computeQuadraticFormDistances(const Mat &sourceSignature, const std::vector<Mat> &imageSignatures, std::vector<float> &distances,
 			const pct_signatures::Similarity &similarity)
 		{
-			parallel_for_(Range(0, static_cast<int>(imageSignatures.size())), Parallel_computeSQFDs(sourceSignature, imageSignatures, distances, similarity));
+			//MODIFIED the source signature and the image signatures are prepared once, not in each call of the parallel body
+			PreparedSignature preparedSource(sourceSignature, similarity);
+			std::vector<PreparedSignature> preparedImages;
+			prepareSignatures(imageSignatures, preparedImages, similarity);
+			computeQuadraticFormDistances(preparedSource, preparedImages, distances);
+		}
+
+		float PCTSignatures::computeQuadraticFormDistance(const PreparedSignature &signature0, const PreparedSignature &signature1)
+		{
+			if (signature0.empty() || signature1.empty())
+			{
+				CV_Error(CV_StsBadArg, "Empty signature!");
+			}
+
+			// the same order of the partial sums as the unprepared distance
+			float result = 0;
+			result += signature0.selfSimilarity();
+			result += signature1.selfSimilarity();
+			result -= signature0.computePartial(signature1) * 2;
+
+			return sqrt(result);
+		}
+
+		void PCTSignatures::prepareSignatures(const std::vector<Mat> &signatures, std::vector<PreparedSignature> &preparedSignatures, const Similarity &similarity)
+		{
+			parallel_for_(Range(0, static_cast<int>(signatures.size())), Parallel_prepareSignatures(signatures, preparedSignatures, similarity));
+		}
+
+		void PCTSignatures::computeQuadraticFormDistances(const PreparedSignature &sourceSignature, const std::vector<PreparedSignature> &imageSignatures,
+			std::vector<float> &distances)
+		{
+			distances.resize(imageSignatures.size());
+			if (imageSignatures.empty())
+			{
+				return;
+			}
+
+			Mat row(1, static_cast<int>(imageSignatures.size()), CV_32FC1, distances.data());
+			std::vector<PreparedSignature> sourceSignatures(1, sourceSignature);
+			parallel_for_(Range(0, static_cast<int>(imageSignatures.size())), Parallel_computePreparedSQFDs(sourceSignatures, imageSignatures, row));
+		}
+
+		void PCTSignatures::computeQuadraticFormDistances(const std::vector<PreparedSignature> &sourceSignatures, const std::vector<PreparedSignature> &imageSignatures,
+			Mat &distances)
+		{
+			distances.create(static_cast<int>(sourceSignatures.size()), static_cast<int>(imageSignatures.size()), CV_32FC1);
+			parallel_for_(Range(0, static_cast<int>(imageSignatures.size())), Parallel_computePreparedSQFDs(sourceSignatures, imageSignatures, distances));
 		}
 
 		float PCTSignatures::computePartialSQFD(const Mat &signature0, const Mat &signature1, const Similarity& similarity)
@@ -20,6 +20,8 @@
 #include "pct_sampler.hpp"
 #include "pct_clusterizer.hpp"
 #include "similarity.hpp"
+#include "prepared_signature.hpp"
+#include "sqfd_kernel.hpp"
 
 namespace cv
 {
@@ -80,14 +82,49 @@ namespace cv
 
 			CV_WRAP virtual void computeSignatures(const std::vector<Mat> &images, std::vector<Mat> &signatures) const = 0;
 
+			//ADDED: the two steps of computeSignature, e.g. for running them in separate pipeline stages;
+			//their stage times are added to times unless it is null
+			CV_WRAP virtual void computeSamples(InputArray image, OutputArray samples, pct_signatures::StageTimes *times) const = 0;
+
+			CV_WRAP virtual void computeSignatureFromSamples(InputArray samples, OutputArray signature, pct_signatures::StageTimes *times) const = 0;
+
+			CV_WRAP void computeSamples(InputArray image, OutputArray samples) const
+			{
+				computeSamples(image, samples, nullptr);
+			}
+
+			CV_WRAP void computeSignatureFromSamples(InputArray samples, OutputArray signature) const
+			{
+				computeSignatureFromSamples(samples, signature, nullptr);
+			}
+
 
 			CV_WRAP static void drawSignature(const cv::InputArray source, const cv::InputArray signature, cv::OutputArray result);
 
 			CV_WRAP static float computeQuadraticFormDistance(const cv::InputArray signature0, const cv::InputArray signature1, const pct_signatures::Similarity &similarity = pct_signatures::HeuristicSimilarity());
+
+			//ADDED SQFD with a kernel whose similarity is resolved once, for repeated distances; the kernel has to be supported
+			CV_WRAP static float computeQuadraticFormDistance(const cv::InputArray signature0, const cv::InputArray signature1, const pct_signatures::SQFDKernel &kernel);
 			
+			//MODIFIED the source and the image signatures are prepared once, see PreparedSignature
 			CV_WRAP static void computeQuadraticFormDistances(const cv::Mat &sourceSignature, const std::vector<Mat> &imageSignatures, 
 				std::vector<float> &distances, const pct_signatures::Similarity &similarity = pct_signatures::HeuristicSimilarity());
 
+			//ADDED SQFD of prepared signatures, only the cross term is computed
+			CV_WRAP static float computeQuadraticFormDistance(const pct_signatures::PreparedSignature &signature0, const pct_signatures::PreparedSignature &signature1);
+
+			//ADDED prepares signatures in parallel, the similarity has to outlive the prepared signatures
+			CV_WRAP static void prepareSignatures(const std::vector<Mat> &signatures, std::vector<pct_signatures::PreparedSignature> &preparedSignatures,
+				const pct_signatures::Similarity &similarity);
+
+			//ADDED 1 x N distances of prepared signatures
+			CV_WRAP static void computeQuadraticFormDistances(const pct_signatures::PreparedSignature &sourceSignature,
+				const std::vector<pct_signatures::PreparedSignature> &imageSignatures, std::vector<float> &distances);
+
+			//ADDED M x N distances of prepared signatures, row i holds the distances of source signature i (CV_32FC1)
+			CV_WRAP static void computeQuadraticFormDistances(const std::vector<pct_signatures::PreparedSignature> &sourceSignatures,
+				const std::vector<pct_signatures::PreparedSignature> &imageSignatures, Mat &distances);
+
 			CV_WRAP static void generateInitPoints(std::vector<Point2f> &initPoints, const size_t count, PCTSignatures::PointDistribution pointsDistribution);
 
 
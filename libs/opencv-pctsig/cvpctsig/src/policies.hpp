@@ -0,0 +1,360 @@
+/*
+* Policy counterparts of the Distance and Similarity functors of
+* distance.hpp and similarity.hpp. They work on raw signature rows
+* (const float*) with the number of compared dimensions known at
+* compile time, so that a loop instantiated over a policy has neither
+* virtual calls nor Mat::at lookups. The arithmetic is the same as in
+* the virtual functors.
+*/
+#ifndef PCT_SIGNATURES_POLICIES_HPP
+#define PCT_SIGNATURES_POLICIES_HPP
+
+#include "opencv2/core.hpp"
+#include "constants.hpp"
+#include "distance.hpp"
+#include "similarity.hpp"
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			namespace policy
+			{
+				/**
+				* \brief Compared dimensions of a signature row (all but the weight).
+				*/
+				const int DIMENSIONS = SIGNATURE_DIMENSION - 1;
+
+				enum LpNorm
+				{
+					L0_25,
+					L0_5,
+					L1,
+					L2,
+					L5,
+					LP
+				};
+
+
+				/**
+				* \brief L_p distance of the first DIMS values of two rows.
+				*/
+				template<LpNorm P, int DIMS = DIMENSIONS>
+				struct LpDistance;
+
+				template<int DIMS>
+				struct LpDistance<L0_25, DIMS>
+				{
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							result += std::sqrt(std::sqrt(std::abs(point1[d] - point2[d])));
+						}
+						result *= result;
+						return result * result;
+					}
+				};
+
+				template<int DIMS>
+				struct LpDistance<L0_5, DIMS>
+				{
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							result += std::sqrt(std::abs(point1[d] - point2[d]));
+						}
+						return result * result;
+					}
+				};
+
+				template<int DIMS>
+				struct LpDistance<L1, DIMS>
+				{
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							result += std::abs(point1[d] - point2[d]);
+						}
+						return result;
+					}
+				};
+
+				template<int DIMS>
+				struct LpDistance<L2, DIMS>
+				{
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							float difference = point1[d] - point2[d];
+							result += difference * difference;
+						}
+						return std::sqrt(result);
+					}
+				};
+
+				template<int DIMS>
+				struct LpDistance<L5, DIMS>
+				{
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							float difference = point1[d] - point2[d];
+							result += std::abs(difference) * difference * difference * difference * difference;
+						}
+						return std::pow(result, (float)0.2);
+					}
+				};
+
+				template<int DIMS>
+				struct LpDistance<LP, DIMS>
+				{
+					float mP;
+
+					explicit LpDistance(float p = 2.0f) : mP(p) {}
+
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float result = (float)0.0;
+						for (int d = 0; d < DIMS; ++d)
+						{
+							result += std::pow(std::abs(point1[d] - point2[d]), mP);
+						}
+						return std::pow(result, (float)1.0 / mP);
+					}
+				};
+
+
+				template<class Dist>
+				struct MinusSimilarity
+				{
+					Dist mDistance;
+
+					explicit MinusSimilarity(const Dist &distance = Dist()) : mDistance(distance) {}
+
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						return -mDistance(point1, point2);
+					}
+				};
+
+				template<class Dist>
+				struct HeuristicSimilarity
+				{
+					Dist mDistance;
+					float mAlpha;
+
+					explicit HeuristicSimilarity(const Dist &distance = Dist(), float alpha = 1.0f) : mDistance(distance), mAlpha(alpha) {}
+
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						return 1 / (mAlpha + mDistance(point1, point2));
+					}
+				};
+
+				template<class Dist>
+				struct GaussianSimilarity
+				{
+					Dist mDistance;
+					float mAlpha;
+
+					explicit GaussianSimilarity(const Dist &distance = Dist(), float alpha = 0.0f) : mDistance(distance), mAlpha(alpha) {}
+
+					inline float operator()(const float *point1, const float *point2) const
+					{
+						float distance = mDistance(point1, point2);
+						return exp(-mAlpha + distance * distance);
+					}
+				};
+
+
+				/**
+				* \brief Calls visitor(distance) with the LpDistance policy of the given p.
+				*		The Visitor defines result_type and a templated operator().
+				*/
+				template<int DIMS, class Visitor>
+				typename Visitor::result_type visitDistance(float Lp, const Visitor &visitor)
+				{
+					if (Lp == (float)0.25)
+						return visitor(LpDistance<L0_25, DIMS>());
+					else if (Lp == (float)0.5)
+						return visitor(LpDistance<L0_5, DIMS>());
+					else if (Lp == (float)1.0)
+						return visitor(LpDistance<L1, DIMS>());
+					else if (Lp == (float)2.0)
+						return visitor(LpDistance<L2, DIMS>());
+					else if (Lp == (float)5.0)
+						return visitor(LpDistance<L5, DIMS>());
+					else
+						return visitor(LpDistance<LP, DIMS>(Lp));
+				}
+
+				/**
+				* \brief Recovers p from an instance of distance.hpp.
+				* \return False for unknown subclasses of Distance.
+				*/
+				inline bool getLp(const Distance &distance, float &Lp)
+				{
+					if (dynamic_cast<const DistanceL0_25*>(&distance))
+						Lp = (float)0.25;
+					else if (dynamic_cast<const DistanceL0_5*>(&distance))
+						Lp = (float)0.5;
+					else if (dynamic_cast<const DistanceL1*>(&distance))
+						Lp = (float)1.0;
+					else if (dynamic_cast<const DistanceL2*>(&distance))
+						Lp = (float)2.0;
+					else if (dynamic_cast<const DistanceL5*>(&distance))
+						Lp = (float)5.0;
+					else if (const DistanceLp *lp = dynamic_cast<const DistanceLp*>(&distance))
+						Lp = lp->getP();
+					else
+						return false;
+					return true;
+				}
+
+				template<class Visitor, template<class> class Sim>
+				struct SimilarityVisitor
+				{
+					typedef typename Visitor::result_type result_type;
+
+					const Visitor &mVisitor;
+					float mAlpha;
+
+					SimilarityVisitor(const Visitor &visitor, float alpha) : mVisitor(visitor), mAlpha(alpha) {}
+
+					template<class Dist>
+					result_type operator()(const Dist &distance) const
+					{
+						return mVisitor(Sim<Dist>(distance, mAlpha));
+					}
+				};
+
+				template<class Visitor>
+				struct MinusSimilarityVisitor
+				{
+					typedef typename Visitor::result_type result_type;
+
+					const Visitor &mVisitor;
+
+					explicit MinusSimilarityVisitor(const Visitor &visitor) : mVisitor(visitor) {}
+
+					template<class Dist>
+					result_type operator()(const Dist &distance) const
+					{
+						return mVisitor(MinusSimilarity<Dist>(distance));
+					}
+				};
+
+				/**
+				* \brief Calls visitor(similarity) with the policy equivalent to an instance of similarity.hpp.
+				* \return False for unknown subclasses of Similarity, the visitor is not called then.
+				*/
+				template<int DIMS, class Visitor>
+				bool visitSimilarity(const Similarity &similarity, const Visitor &visitor, typename Visitor::result_type &result)
+				{
+					float Lp;
+
+					if (const pct_signatures::MinusSimilarity *minus = dynamic_cast<const pct_signatures::MinusSimilarity*>(&similarity))
+					{
+						if (!getLp(minus->getDistance(), Lp))
+							return false;
+						result = visitDistance<DIMS>(Lp, MinusSimilarityVisitor<Visitor>(visitor));
+					}
+					else if (const pct_signatures::HeuristicSimilarity *heuristic = dynamic_cast<const pct_signatures::HeuristicSimilarity*>(&similarity))
+					{
+						if (!getLp(heuristic->getDistance(), Lp))
+							return false;
+						result = visitDistance<DIMS>(Lp, SimilarityVisitor<Visitor, HeuristicSimilarity>(visitor, heuristic->getAlpha()));
+					}
+					else if (const pct_signatures::GaussianSimilarity *gaussian = dynamic_cast<const pct_signatures::GaussianSimilarity*>(&similarity))
+					{
+						if (!getLp(gaussian->getDistance(), Lp))
+							return false;
+						result = visitDistance<DIMS>(Lp, SimilarityVisitor<Visitor, GaussianSimilarity>(visitor, gaussian->getAlpha()));
+					}
+					else
+					{
+						return false;
+					}
+					return true;
+				}
+
+
+				/**
+				* \brief Partial SQFD of two signatures whose rows are compared by a similarity policy.
+				*		The weight is read from WEIGHT_IDX, the row length is given by the matrices.
+				*/
+				template<class Sim>
+				float computePartialSQFD(const Mat &signature0, const Mat &signature1, const Sim &similarity)
+				{
+					float result = 0;
+					for (int i = 0; i < signature0.rows; i++)
+					{
+						const float *row0 = signature0.ptr<float>(i);
+						for (int j = 0; j < signature1.rows; j++)
+						{
+							const float *row1 = signature1.ptr<float>(j);
+							result += row0[WEIGHT_IDX] * row1[WEIGHT_IDX] * similarity(row0, row1);
+						}
+					}
+					return result;
+				}
+
+				/**
+				* \brief Visitor computing one partial SQFD for a similarity policy.
+				*/
+				struct PartialSQFD
+				{
+					typedef float result_type;
+
+					const Mat &mSignature0;
+					const Mat &mSignature1;
+
+					PartialSQFD(const Mat &signature0, const Mat &signature1) : mSignature0(signature0), mSignature1(signature1) {}
+
+					template<class Sim>
+					float operator()(const Sim &similarity) const
+					{
+						return computePartialSQFD(mSignature0, mSignature1, similarity);
+					}
+				};
+
+				/**
+				* \brief Visitor computing the squared SQFD (all three partial sums) for a similarity policy.
+				*/
+				struct SquaredSQFD
+				{
+					typedef float result_type;
+
+					const Mat &mSignature0;
+					const Mat &mSignature1;
+
+					SquaredSQFD(const Mat &signature0, const Mat &signature1) : mSignature0(signature0), mSignature1(signature1) {}
+
+					template<class Sim>
+					float operator()(const Sim &similarity) const
+					{
+						float result = 0;
+						result += computePartialSQFD(mSignature0, mSignature0, similarity);
+						result += computePartialSQFD(mSignature1, mSignature1, similarity);
+						result -= computePartialSQFD(mSignature0, mSignature1, similarity) * 2;
+						return result;
+					}
+				};
+			}
+		}
+	}
+}
+
+#endif
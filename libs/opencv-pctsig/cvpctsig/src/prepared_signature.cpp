@@ -0,0 +1,86 @@
+#include "prepared_signature.hpp"
+#include "policies.hpp"
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			PreparedSignature::PreparedSignature()
+				: mSimilarity(nullptr), mSelfSimilarity(0), mResolved(false), mVectorized(false), mNorm(SQFD_NORM_L2), mType(SQFD_SIMILARITY_HEURISTIC), mAlpha(0)
+			{
+			}
+
+			PreparedSignature::PreparedSignature(const Mat &signature, const Similarity &similarity)
+				: PreparedSignature()
+			{
+				prepare(signature, similarity);
+			}
+
+			void PreparedSignature::prepare(const Mat &signature, const Similarity &similarity)
+			{
+				if (signature.empty())
+				{
+					CV_Error(CV_StsBadArg, "Empty signature!");
+				}
+				CV_Assert(signature.type() == CV_32FC1 && signature.cols > static_cast<int>(WEIGHT_IDX));
+
+				signature.copyTo(mSignature);
+				mSimilarity = &similarity;
+
+				// the same path as computeQuadraticFormDistance, so that the distances are equal
+				mResolved = SQFDKernel::resolve(similarity, mNorm, mType, mAlpha);
+				mVectorized = mResolved && signature.cols == SIGNATURE_DIMENSION;
+				if (mVectorized)
+				{
+					mBlock.assign(mSignature);
+				}
+				else
+				{
+					mBlock = SQFDBlock();
+				}
+
+				mSelfSimilarity = computePartial(*this);
+			}
+
+			float PreparedSignature::computePartial(const PreparedSignature &other) const
+			{
+				CV_Assert(mSignature.cols == other.mSignature.cols && isCompatible(other));
+
+				if (mVectorized)
+				{
+					return SQFDKernel::computePartial(mSignature, other.mBlock, mNorm, mType, mAlpha);
+				}
+
+				float result;
+				if (policy::visitSimilarity<policy::DIMENSIONS>(*mSimilarity, policy::PartialSQFD(mSignature, other.mSignature), result))
+				{
+					return result;
+				}
+
+				// unknown similarities are called virtually
+				result = 0;
+				for (int i = 0; i < mSignature.rows; i++)
+				{
+					for (int j = 0; j < other.mSignature.rows; j++)
+					{
+						result += mSignature.at<float>(i, WEIGHT_IDX) * other.mSignature.at<float>(j, WEIGHT_IDX) * (*mSimilarity)(mSignature, i, other.mSignature, j);
+					}
+				}
+				return result;
+			}
+
+			bool PreparedSignature::isCompatible(const PreparedSignature &other) const
+			{
+				if (mSimilarity == other.mSimilarity)
+				{
+					return true;
+				}
+
+				// equal parameters give equal similarities, whichever object the signatures were prepared with
+				return mResolved && other.mResolved && mNorm == other.mNorm && mType == other.mType && mAlpha == other.mAlpha;
+			}
+		}
+	}
+}
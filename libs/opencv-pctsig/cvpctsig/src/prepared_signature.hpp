@@ -0,0 +1,91 @@
+/*
+* Signature prepared for repeated SQFD computations. The rows are
+* packed into a continuous matrix and a structure-of-arrays block, and
+* the self-similarity (the partial SQFD of the signature with itself)
+* is computed once for a given similarity. The SQFD of two prepared
+* signatures then only computes the cross term, one of the three
+* partial sums.
+*/
+#ifndef PCT_SIGNATURES_PREPARED_SIGNATURE_HPP
+#define PCT_SIGNATURES_PREPARED_SIGNATURE_HPP
+
+#include "opencv2/core.hpp"
+#include "constants.hpp"
+#include "similarity.hpp"
+#include "sqfd_kernel.hpp"
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			/**
+			* \brief Signature with its packed rows, weights and self-similarity for one similarity.
+			*		The similarity is referenced, it has to outlive the prepared signature.
+			*/
+			class PreparedSignature
+			{
+			public:
+				PreparedSignature();
+
+				PreparedSignature(const Mat &signature, const Similarity &similarity);
+
+				/**
+				* \brief Packs the rows and computes the self-similarity.
+				*		Signatures with SIGNATURE_DIMENSION columns use the vectorized kernel if it supports the similarity,
+				*		other signatures (e.g. temporal ones) are compared by the similarity policies over their first dimensions.
+				*/
+				void prepare(const Mat &signature, const Similarity &similarity);
+
+				bool empty() const { return mSignature.empty(); }
+
+				int rows() const { return mSignature.rows; }
+
+				/**
+				* \brief Packed rows, continuous.
+				*/
+				const Mat& signature() const { return mSignature; }
+
+				/**
+				* \brief Rows in structure-of-arrays layout, the weights are the last array; empty if the kernel is not used.
+				*/
+				const SQFDBlock& block() const { return mBlock; }
+
+				const Similarity& similarity() const { return *mSimilarity; }
+
+				/**
+				* \brief Partial SQFD of the signature with itself.
+				*/
+				float selfSimilarity() const { return mSelfSimilarity; }
+
+				/**
+				* \brief Cross term of the SQFD, the partial SQFD of two signatures prepared for the same similarity.
+				*/
+				float computePartial(const PreparedSignature &other) const;
+
+				/**
+				* \brief Two signatures are prepared for the same similarity if their similarities resolve to the same kernel
+				*		parameters; unknown similarities have to be the same object.
+				*/
+				bool isCompatible(const PreparedSignature &other) const;
+
+			private:
+				Mat mSignature;
+				SQFDBlock mBlock;
+				const Similarity *mSimilarity;
+				float mSelfSimilarity;
+
+				// resolved kernel parameters, mResolved is false if the kernel does not support the similarity,
+				// mVectorized is false if the kernel is not used for the signature
+				bool mResolved;
+				bool mVectorized;
+				SQFDNorm mNorm;
+				SQFDSimilarity mType;
+				float mAlpha;
+			};
+		}
+	}
+}
+
+#endif
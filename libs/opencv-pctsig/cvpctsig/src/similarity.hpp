@@ -46,6 +46,12 @@ namespace cv
 					return -mDistance(points1, idx1, points2, idx2);
 				}
 
+				//ADDED accessor for the vectorized SQFD kernel
+				const Distance& getDistance() const
+				{
+					return mDistance;
+				}
+
 			};
 
 
@@ -63,6 +69,17 @@ namespace cv
 				{
 					return 1 / (mAlpha + mDistance(points1, idx1, points2, idx2));
 				}
+
+				//ADDED accessors for the vectorized SQFD kernel
+				const Distance& getDistance() const
+				{
+					return mDistance;
+				}
+
+				float getAlpha() const
+				{
+					return mAlpha;
+				}
 			};
 			
 			class GaussianSimilarity : public Similarity
@@ -87,6 +104,17 @@ namespace cv
 					this->mAlpha = alpha;
 				}
 
+				//ADDED accessors for the vectorized SQFD kernel
+				const Distance& getDistance() const
+				{
+					return mDistance;
+				}
+
+				float getAlpha() const
+				{
+					return mAlpha;
+				}
+
 			};
 		}
 	}
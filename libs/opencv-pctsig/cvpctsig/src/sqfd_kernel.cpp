@@ -0,0 +1,427 @@
+#include "sqfd_kernel.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PCT_SIGNATURES_SQFD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCT_SIGNATURES_SQFD_SSE2
+#endif
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			/**** vector types ****/
+
+			struct ScalarVector
+			{
+				typedef float type;
+				static const int WIDTH = 1;
+
+				static type load(const float *p)			{ return *p; }
+				static void store(float *p, type a)			{ *p = a; }
+				static type set1(float v)					{ return v; }
+				static type zero()							{ return 0.0f; }
+				static type add(type a, type b)				{ return a + b; }
+				static type sub(type a, type b)				{ return a - b; }
+				static type mul(type a, type b)				{ return a * b; }
+				static type div(type a, type b)				{ return a / b; }
+				static type sqrt(type a)					{ return std::sqrt(a); }
+				static type abs(type a)						{ return std::abs(a); }
+				static float sum(type a)					{ return a; }
+			};
+
+#if defined(PCT_SIGNATURES_SQFD_AVX2)
+			struct SIMDVector
+			{
+				typedef __m256 type;
+				static const int WIDTH = 8;
+
+				static type load(const float *p)			{ return _mm256_loadu_ps(p); }
+				static void store(float *p, type a)			{ _mm256_storeu_ps(p, a); }
+				static type set1(float v)					{ return _mm256_set1_ps(v); }
+				static type zero()							{ return _mm256_setzero_ps(); }
+				static type add(type a, type b)				{ return _mm256_add_ps(a, b); }
+				static type sub(type a, type b)				{ return _mm256_sub_ps(a, b); }
+				static type mul(type a, type b)				{ return _mm256_mul_ps(a, b); }
+				static type div(type a, type b)				{ return _mm256_div_ps(a, b); }
+				static type sqrt(type a)					{ return _mm256_sqrt_ps(a); }
+				static type abs(type a)						{ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+				static float sum(type a)
+				{
+					__m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+					s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+					s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+					return _mm_cvtss_f32(s);
+				}
+			};
+			static const char* INSTRUCTION_SET = "AVX2";
+#elif defined(PCT_SIGNATURES_SQFD_SSE2)
+			struct SIMDVector
+			{
+				typedef __m128 type;
+				static const int WIDTH = 4;
+
+				static type load(const float *p)			{ return _mm_loadu_ps(p); }
+				static void store(float *p, type a)			{ _mm_storeu_ps(p, a); }
+				static type set1(float v)					{ return _mm_set1_ps(v); }
+				static type zero()							{ return _mm_setzero_ps(); }
+				static type add(type a, type b)				{ return _mm_add_ps(a, b); }
+				static type sub(type a, type b)				{ return _mm_sub_ps(a, b); }
+				static type mul(type a, type b)				{ return _mm_mul_ps(a, b); }
+				static type div(type a, type b)				{ return _mm_div_ps(a, b); }
+				static type sqrt(type a)					{ return _mm_sqrt_ps(a); }
+				static type abs(type a)						{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+				static float sum(type a)
+				{
+					__m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+					s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+					return _mm_cvtss_f32(s);
+				}
+			};
+			static const char* INSTRUCTION_SET = "SSE2";
+#else
+			typedef ScalarVector SIMDVector;
+			static const char* INSTRUCTION_SET = "scalar";
+#endif
+
+
+			/**** Lp norms, same order of operations as in distance.hpp ****/
+
+			template<class V, SQFDNorm NORM> struct LpNorm;
+
+			template<class V> struct LpNorm<V, SQFD_NORM_L0_25>
+			{
+				static typename V::type accumulate(typename V::type result, typename V::type difference)
+				{
+					return V::add(result, V::sqrt(V::sqrt(V::abs(difference))));
+				}
+				static typename V::type finish(typename V::type result)
+				{
+					result = V::mul(result, result);
+					return V::mul(result, result);
+				}
+			};
+
+			template<class V> struct LpNorm<V, SQFD_NORM_L0_5>
+			{
+				static typename V::type accumulate(typename V::type result, typename V::type difference)
+				{
+					return V::add(result, V::sqrt(V::abs(difference)));
+				}
+				static typename V::type finish(typename V::type result)
+				{
+					return V::mul(result, result);
+				}
+			};
+
+			template<class V> struct LpNorm<V, SQFD_NORM_L1>
+			{
+				static typename V::type accumulate(typename V::type result, typename V::type difference)
+				{
+					return V::add(result, V::abs(difference));
+				}
+				static typename V::type finish(typename V::type result)
+				{
+					return result;
+				}
+			};
+
+			template<class V> struct LpNorm<V, SQFD_NORM_L2>
+			{
+				static typename V::type accumulate(typename V::type result, typename V::type difference)
+				{
+					return V::add(result, V::mul(difference, difference));
+				}
+				static typename V::type finish(typename V::type result)
+				{
+					return V::sqrt(result);
+				}
+			};
+
+
+			/**** similarities, same as in similarity.hpp ****/
+
+			template<class V, SQFDSimilarity TYPE> struct SimilarityOf;
+
+			template<class V> struct SimilarityOf<V, SQFD_SIMILARITY_MINUS>
+			{
+				static typename V::type compute(typename V::type distance, typename V::type)
+				{
+					return V::sub(V::zero(), distance);
+				}
+			};
+
+			template<class V> struct SimilarityOf<V, SQFD_SIMILARITY_HEURISTIC>
+			{
+				static typename V::type compute(typename V::type distance, typename V::type alpha)
+				{
+					return V::div(V::set1(1.0f), V::add(alpha, distance));
+				}
+			};
+
+
+			/**** kernel ****/
+
+			/**
+			* \brief Sum of w1[j] * similarity(row, j) for the block rows [begin, end), end - begin is a multiple of V::WIDTH.
+			*/
+			template<class V, SQFDNorm NORM, SQFDSimilarity TYPE>
+			static inline float weightedSimilarities(const typename V::type *row, const SQFDBlock &block, int begin, int end, typename V::type alpha)
+			{
+				typedef LpNorm<V, NORM> Norm;
+				typedef SimilarityOf<V, TYPE> Sim;
+
+				typename V::type result = V::zero();
+				for (int j = begin; j < end; j += V::WIDTH)
+				{
+					typename V::type distance = V::zero();
+					for (int d = 0; d < SIGNATURE_DIMENSION - 1; ++d)
+					{
+						distance = Norm::accumulate(distance, V::sub(row[d], V::load(block.dimension(d) + j)));
+					}
+					typename V::type similarity = Sim::compute(Norm::finish(distance), alpha);
+					result = V::add(result, V::mul(V::load(block.weights() + j), similarity));
+				}
+				return V::sum(result);
+			}
+
+			template<SQFDNorm NORM, SQFDSimilarity TYPE>
+			static float partialSQFD(const Mat &signature0, const SQFDBlock &block1, float alpha)
+			{
+				typedef SIMDVector V;
+				typedef ScalarVector S;
+
+				int rows1 = block1.rows();
+				int vectorized = rows1 - rows1 % V::WIDTH;
+
+				V::type alphaV = V::set1(alpha);
+				V::type rowV[SIGNATURE_DIMENSION - 1];
+				S::type rowS[SIGNATURE_DIMENSION - 1];
+
+				float result = 0;
+				for (int i = 0; i < signature0.rows; i++)
+				{
+					const float *row = signature0.ptr<float>(i);
+					for (int d = 0; d < SIGNATURE_DIMENSION - 1; ++d)
+					{
+						rowV[d] = V::set1(row[d]);
+						rowS[d] = row[d];
+					}
+
+					// full vectors, the tail is computed with scalars
+					float rowResult = weightedSimilarities<V, NORM, TYPE>(rowV, block1, 0, vectorized, alphaV);
+					rowResult += weightedSimilarities<S, NORM, TYPE>(rowS, block1, vectorized, rows1, alpha);
+
+					result += row[WEIGHT_IDX] * rowResult;
+				}
+				return result;
+			}
+
+			template<SQFDNorm NORM>
+			static float partialSQFD(const Mat &signature0, const SQFDBlock &block1, SQFDSimilarity type, float alpha)
+			{
+				switch (type)
+				{
+				case SQFD_SIMILARITY_MINUS:
+					return partialSQFD<NORM, SQFD_SIMILARITY_MINUS>(signature0, block1, alpha);
+				case SQFD_SIMILARITY_HEURISTIC:
+					return partialSQFD<NORM, SQFD_SIMILARITY_HEURISTIC>(signature0, block1, alpha);
+				}
+				CV_Error(CV_StsBadArg, "Unsupported similarity!");
+				return 0;
+			}
+
+
+			/**
+			* \brief Lp distances of a row to the block rows [begin, end), end - begin is a multiple of V::WIDTH.
+			*/
+			template<class V, SQFDNorm NORM>
+			static inline void lpDistances(const typename V::type *row, const SQFDBlock &block, int begin, int end, float *distances)
+			{
+				typedef LpNorm<V, NORM> Norm;
+
+				for (int j = begin; j < end; j += V::WIDTH)
+				{
+					typename V::type distance = V::zero();
+					for (int d = 0; d < SIGNATURE_DIMENSION - 1; ++d)
+					{
+						distance = Norm::accumulate(distance, V::sub(row[d], V::load(block.dimension(d) + j)));
+					}
+					V::store(distances + j, Norm::finish(distance));
+				}
+			}
+
+			template<SQFDNorm NORM>
+			static void lpDistances(const float *row, const SQFDBlock &block, float *distances)
+			{
+				typedef SIMDVector V;
+				typedef ScalarVector S;
+
+				int rows = block.rows();
+				int vectorized = rows - rows % V::WIDTH;
+
+				V::type rowV[SIGNATURE_DIMENSION - 1];
+				S::type rowS[SIGNATURE_DIMENSION - 1];
+				for (int d = 0; d < SIGNATURE_DIMENSION - 1; ++d)
+				{
+					rowV[d] = V::set1(row[d]);
+					rowS[d] = row[d];
+				}
+
+				lpDistances<V, NORM>(rowV, block, 0, vectorized, distances);
+				lpDistances<S, NORM>(rowS, block, vectorized, rows, distances);
+			}
+
+
+			void SQFDBlock::assign(const Mat &signature)
+			{
+				CV_Assert(signature.cols == SIGNATURE_DIMENSION && signature.type() == CV_32FC1);
+
+				mRows = signature.rows;
+				mStride = signature.rows;
+				mValues.resize(SIGNATURE_DIMENSION * mStride);
+
+				for (int i = 0; i < mRows; i++)
+				{
+					const float *row = signature.ptr<float>(i);
+					for (int d = 0; d < SIGNATURE_DIMENSION; ++d)
+					{
+						mValues[d * mStride + i] = row[d];
+					}
+				}
+			}
+
+
+			bool SQFDKernel::resolve(const Similarity &similarity, SQFDNorm &norm, SQFDSimilarity &type, float &alpha)
+			{
+				const Distance *distance = nullptr;
+
+				if (const MinusSimilarity *minus = dynamic_cast<const MinusSimilarity*>(&similarity))
+				{
+					type = SQFD_SIMILARITY_MINUS;
+					alpha = 0.0f;
+					distance = &minus->getDistance();
+				}
+				else if (const HeuristicSimilarity *heuristic = dynamic_cast<const HeuristicSimilarity*>(&similarity))
+				{
+					type = SQFD_SIMILARITY_HEURISTIC;
+					alpha = heuristic->getAlpha();
+					distance = &heuristic->getDistance();
+				}
+				else
+				{
+					return false;
+				}
+
+				if (dynamic_cast<const DistanceL0_25*>(distance))
+					norm = SQFD_NORM_L0_25;
+				else if (dynamic_cast<const DistanceL0_5*>(distance))
+					norm = SQFD_NORM_L0_5;
+				else if (dynamic_cast<const DistanceL1*>(distance))
+					norm = SQFD_NORM_L1;
+				else if (dynamic_cast<const DistanceL2*>(distance))
+					norm = SQFD_NORM_L2;
+				else
+					return false;
+
+				return true;
+			}
+
+			bool SQFDKernel::resolve(float Lp, SQFDNorm &norm)
+			{
+				if (Lp == (float)0.25)
+					norm = SQFD_NORM_L0_25;
+				else if (Lp == (float)0.5)
+					norm = SQFD_NORM_L0_5;
+				else if (Lp == (float)1.0)
+					norm = SQFD_NORM_L1;
+				else if (Lp == (float)2.0)
+					norm = SQFD_NORM_L2;
+				else
+					return false;
+
+				return true;
+			}
+
+			float SQFDKernel::computePartial(const Mat &signature0, const SQFDBlock &block1, SQFDNorm norm, SQFDSimilarity type, float alpha)
+			{
+				switch (norm)
+				{
+				case SQFD_NORM_L0_25:
+					return partialSQFD<SQFD_NORM_L0_25>(signature0, block1, type, alpha);
+				case SQFD_NORM_L0_5:
+					return partialSQFD<SQFD_NORM_L0_5>(signature0, block1, type, alpha);
+				case SQFD_NORM_L1:
+					return partialSQFD<SQFD_NORM_L1>(signature0, block1, type, alpha);
+				case SQFD_NORM_L2:
+					return partialSQFD<SQFD_NORM_L2>(signature0, block1, type, alpha);
+				}
+				CV_Error(CV_StsBadArg, "Unsupported Lp norm!");
+				return 0;
+			}
+
+			SQFDKernel::SQFDKernel(const Similarity &similarity)
+				: mNorm(SQFD_NORM_L2), mType(SQFD_SIMILARITY_HEURISTIC), mAlpha(0)
+			{
+				mSupported = resolve(similarity, mNorm, mType, mAlpha);
+			}
+
+			float SQFDKernel::computeSquared(const Mat &signature0, const Mat &signature1) const
+			{
+				CV_Assert(mSupported);
+
+				// the capacity of the blocks is kept between the calls of a thread
+				thread_local SQFDBlock block0, block1;
+				block0.assign(signature0);
+				block1.assign(signature1);
+
+				float result = 0;
+				result += computePartial(signature0, block0, mNorm, mType, mAlpha);
+				result += computePartial(signature1, block1, mNorm, mType, mAlpha);
+				result -= computePartial(signature0, block1, mNorm, mType, mAlpha) * 2;
+				return result;
+			}
+
+			bool SQFDKernel::computeSquared(const Mat &signature0, const Mat &signature1, const Similarity &similarity, float &result)
+			{
+				SQFDKernel kernel(similarity);
+				if (!kernel.isSupported())
+				{
+					return false;
+				}
+
+				result = kernel.computeSquared(signature0, signature1);
+				return true;
+			}
+
+			void SQFDKernel::computeDistances(const float *row, const SQFDBlock &block, SQFDNorm norm, float *distances)
+			{
+				switch (norm)
+				{
+				case SQFD_NORM_L0_25:
+					lpDistances<SQFD_NORM_L0_25>(row, block, distances);
+					return;
+				case SQFD_NORM_L0_5:
+					lpDistances<SQFD_NORM_L0_5>(row, block, distances);
+					return;
+				case SQFD_NORM_L1:
+					lpDistances<SQFD_NORM_L1>(row, block, distances);
+					return;
+				case SQFD_NORM_L2:
+					lpDistances<SQFD_NORM_L2>(row, block, distances);
+					return;
+				}
+				CV_Error(CV_StsBadArg, "Unsupported Lp norm!");
+			}
+
+			const char* SQFDKernel::getInstructionSet()
+			{
+				return INSTRUCTION_SET;
+			}
+		}
+	}
+}
@@ -0,0 +1,135 @@
+/*
+* Vectorized SQFD (Signature Quadratic Form Distance) for PCT signatures.
+* The second signature of each partial sum is transposed into a
+* structure-of-arrays block, so that the similarities of one row to
+* several rows are computed at once (AVX2, SSE2 or scalar, chosen at
+* compile time). The Lp norm and the similarity are template
+* parameters, so the inner loop has no indirect calls.
+*/
+#ifndef PCT_SIGNATURES_SQFD_KERNEL_HPP
+#define PCT_SIGNATURES_SQFD_KERNEL_HPP
+
+#include "opencv2/core.hpp"
+#include "constants.hpp"
+#include "similarity.hpp"
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			/**
+			* \brief Lp norms supported by the vectorized kernel.
+			*/
+			enum SQFDNorm
+			{
+				SQFD_NORM_L0_25,
+				SQFD_NORM_L0_5,
+				SQFD_NORM_L1,
+				SQFD_NORM_L2
+			};
+
+			/**
+			* \brief Similarities supported by the vectorized kernel.
+			*/
+			enum SQFDSimilarity
+			{
+				SQFD_SIMILARITY_MINUS,
+				SQFD_SIMILARITY_HEURISTIC
+			};
+
+			/**
+			* \brief Signature in structure-of-arrays layout: one array per dimension and one for the weights.
+			*/
+			class SQFDBlock
+			{
+			public:
+				SQFDBlock() : mRows(0) {}
+
+				/**
+				* \brief Transposes a signature (rows x SIGNATURE_DIMENSION).
+				*/
+				void assign(const Mat &signature);
+
+				int rows() const { return mRows; }
+
+				const float* dimension(int d) const { return mValues.data() + d * mStride; }
+
+				const float* weights() const { return mValues.data() + WEIGHT_IDX * mStride; }
+
+			private:
+				int mRows;
+				int mStride;
+				std::vector<float> mValues;
+			};
+
+			/**
+			* \brief Vectorized SQFD kernel for one combination of Lp norm and similarity.
+			*		An instance resolves the similarity once; use it for repeated distances.
+			*/
+			class SQFDKernel
+			{
+			public:
+				/**
+				* \brief Resolves the Lp norm and the type of a similarity, see isSupported.
+				*/
+				explicit SQFDKernel(const Similarity &similarity);
+
+				/**
+				* \brief False if the combination is not supported by the kernel (e.g. GaussianSimilarity or L5).
+				*/
+				bool isSupported() const { return mSupported; }
+
+				/**
+				* \brief Squared SQFD with the resolved similarity, the kernel has to be supported.
+				*		The blocks are kept per thread, so repeated calls do not allocate once they are large enough.
+				*/
+				float computeSquared(const Mat &signature0, const Mat &signature1) const;
+
+				/**
+				* \brief Resolves the Lp norm and the type of a similarity.
+				* \return False if the combination is not supported by the kernel (e.g. GaussianSimilarity or L5).
+				*/
+				static bool resolve(const Similarity &similarity, SQFDNorm &norm, SQFDSimilarity &type, float &alpha);
+
+				/**
+				* \brief Resolves the Lp norm of a p value.
+				* \return False if the norm is not supported by the kernel.
+				*/
+				static bool resolve(float Lp, SQFDNorm &norm);
+
+				/**
+				* \brief Computes the squared SQFD, i.e. the three partial sums of two signatures, in one pass.
+				*		The similarity is resolved on each call, see the instance computeSquared.
+				* \return False if the similarity is not supported, the result is not changed then.
+				*/
+				static bool computeSquared(const Mat &signature0, const Mat &signature1, const Similarity &similarity, float &result);
+
+				/**
+				* \brief Partial SQFD of the rows of signature0 to all rows of a block.
+				*/
+				static float computePartial(const Mat &signature0, const SQFDBlock &block1, SQFDNorm norm, SQFDSimilarity type, float alpha);
+
+				/**
+				* \brief Lp distances of a signature row to all rows of a block, only the dimensions without the weight are compared.
+				* \param distances Output array with one value per block row.
+				*/
+				static void computeDistances(const float *row, const SQFDBlock &block, SQFDNorm norm, float *distances);
+
+				/**
+				* \brief Name of the instruction set the kernel was compiled for.
+				*/
+				static const char* getInstructionSet();
+
+			private:
+				bool mSupported;
+				SQFDNorm mNorm;
+				SQFDSimilarity mType;
+				float mAlpha;
+			};
+		}
+	}
+}
+
+#endif
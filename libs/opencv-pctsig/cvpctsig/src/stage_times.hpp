@@ -0,0 +1,49 @@
+/*
+* Seconds spent in the stages of a signature extraction. The sampler
+* and the clusterizer add their stages if they get a StageTimes, the
+* temporal pipeline adds the decoding and the tracking. The times are
+* summed over all frames of a shot; concurrent stages are measured in
+* their own threads, so they may add up to more than the wall time.
+*/
+#ifndef PCT_SIGNATURES_STAGE_TIMES_HPP
+#define PCT_SIGNATURES_STAGE_TIMES_HPP
+
+namespace cv
+{
+	namespace xfeatures2d
+	{
+		namespace pct_signatures
+		{
+			struct StageTimes
+			{
+				double mDecoding;		///< reading the frames
+				double mBitmap;			///< GrayscaleBitmap construction
+				double mTexture;		///< contrast and entropy of the samples
+				double mSampling;		///< positions and Lab colors of the samples
+				double mClustering;		///< PCTClusterizer
+				double mTracking;		///< TPCTSignatures matching
+				int mFrames;
+				int mSamples;
+
+				StageTimes()
+					: mDecoding(0), mBitmap(0), mTexture(0), mSampling(0), mClustering(0), mTracking(0), mFrames(0), mSamples(0)
+				{
+				}
+
+				void add(const StageTimes &other)
+				{
+					mDecoding += other.mDecoding;
+					mBitmap += other.mBitmap;
+					mTexture += other.mTexture;
+					mSampling += other.mSampling;
+					mClustering += other.mClustering;
+					mTracking += other.mTracking;
+					mFrames += other.mFrames;
+					mSamples += other.mSamples;
+				}
+			};
+		}
+	}
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define __TFSIGNATURES__ALL_H__
 
 #include "../src/tpct_signatures.hpp"
+#include "../src/tpct_pipeline.hpp"
+#include "../src/tpct_frame_reader.hpp"
 #include "../src/constants.h"
 #include "../src/tf_signatures.h"
 
@@ -0,0 +1,179 @@
+#include "tpct_frame_reader.hpp"
+#include <cpluslogger.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace analysis::tpct_signatures;
+
+FrameReader::FrameReader(const std::string& file, int seekDistance)
+	: mCapture(file), mFile(file), mSeekDistance(seekDistance), mPosition(0), mSeeking(true), mNextFrame(0), mSeeks(0), mDecoded(0)
+{
+	if (!mCapture.isOpened())
+	{
+		LOG_ERROR("Video " << file << " cannot be opened");
+	}
+}
+
+bool FrameReader::isOpened() const
+{
+	return mCapture.isOpened();
+}
+
+int FrameReader::getFrameCount() const
+{
+	return int(mCapture.get(cv::CAP_PROP_FRAME_COUNT));
+}
+
+double FrameReader::getFps() const
+{
+	return mCapture.get(cv::CAP_PROP_FPS);
+}
+
+int FrameReader::getWidth() const
+{
+	return int(mCapture.get(cv::CAP_PROP_FRAME_WIDTH));
+}
+
+int FrameReader::getHeight() const
+{
+	return int(mCapture.get(cv::CAP_PROP_FRAME_HEIGHT));
+}
+
+std::vector<int> FrameReader::selectFrames(int frameCount, double fps, int maxFrames, bool perSecond)
+{
+	std::vector<int> frames;
+	if (frameCount <= 0 || maxFrames <= 0)
+	{
+		return frames;
+	}
+
+	if (!perSecond || fps <= 0)
+	{
+		int count = std::min(frameCount, maxFrames);
+		for (int i = 0; i < count; i++)
+		{
+			frames.push_back(int((i + 0.5) * frameCount / count));
+		}
+	}
+	else
+	{
+		double step = std::max(1.0, fps / maxFrames);
+		for (double position = 0; position < frameCount; position += step)
+		{
+			int frame = int(position + 0.5);
+			if (frame < frameCount && (frames.empty() || frame > frames.back()))
+			{
+				frames.push_back(frame);
+			}
+		}
+	}
+	return frames;
+}
+
+void FrameReader::setFrames(const std::vector<int>& frames)
+{
+	mFrames = frames;
+	mNextFrame = 0;
+}
+
+bool FrameReader::next(cv::Mat& image)
+{
+	if (mNextFrame >= mFrames.size())
+	{
+		return false;
+	}
+	return read(mFrames[mNextFrame++], image);
+}
+
+bool FrameReader::read(int frame, cv::Mat& image)
+{
+	if (frame < 0 || !mCapture.isOpened())
+	{
+		return false;
+	}
+
+	if (mSeeking && (frame < mPosition || frame - mPosition > mSeekDistance))
+	{
+		if (!seek(frame))
+		{
+			LOG_INFO("Seeking in " << mFile << " is inaccurate, the frames are read sequentially");
+			mSeeking = false;
+			if (!restart())
+			{
+				return false;
+			}
+		}
+	}
+	else if (frame < mPosition)
+	{
+		if (!restart())
+		{
+			return false;
+		}
+	}
+
+	// decode forward from the keyframe (or the current position) to the frame
+	while (mPosition < frame)
+	{
+		if (!mCapture.grab())
+		{
+			return false;
+		}
+		mPosition++;
+		mDecoded++;
+	}
+
+	if (!mCapture.read(image))
+	{
+		return false;
+	}
+	mPosition++;
+	mDecoded++;
+	return true;
+}
+
+bool FrameReader::seek(int frame)
+{
+	mSeeks++;
+	if (!mCapture.set(cv::CAP_PROP_POS_FRAMES, frame))
+	{
+		return false;
+	}
+
+	// the backend must report the requested position, otherwise the following frames would be shifted
+	double position = mCapture.get(cv::CAP_PROP_POS_FRAMES);
+	if (std::abs(position - frame) > 0.5)
+	{
+		return false;
+	}
+
+	mPosition = frame;
+	return true;
+}
+
+bool FrameReader::restart()
+{
+	mCapture.release();
+	if (!mCapture.open(mFile))
+	{
+		LOG_ERROR("Video " << mFile << " cannot be reopened");
+		return false;
+	}
+	mPosition = 0;
+	return true;
+}
+
+bool FrameReader::isSeeking() const
+{
+	return mSeeking;
+}
+
+int FrameReader::getSeekCount() const
+{
+	return mSeeks;
+}
+
+int FrameReader::getDecodedCount() const
+{
+	return mDecoded;
+}
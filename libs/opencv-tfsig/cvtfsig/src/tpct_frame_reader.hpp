@@ -0,0 +1,93 @@
+#ifndef __TPCTFRAMEREADER_H__
+#define __TPCTFRAMEREADER_H__
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+namespace analysis
+{
+	namespace tpct_signatures
+	{
+		/**
+		* \brief Reads selected frames of a video by seeking instead of decoding all frames before them.
+		*		A seek lets the backend jump to the keyframe before the frame and decode forward from there;
+		*		frames close behind the current position are reached by grabbing forward.
+		*		If the backend does not land on the requested frame, the reader falls back to sequential
+		*		reading for the rest of the video.
+		*/
+		class FrameReader
+		{
+		public:
+			/**
+			* \param file video file
+			* \param seekDistance frames up to this distance ahead are grabbed instead of seeking
+			*/
+			FrameReader(const std::string& file, int seekDistance = 32);
+
+			bool isOpened() const;
+
+			/**
+			* \brief Number of frames reported by the container (may be inaccurate or 0).
+			*/
+			int getFrameCount() const;
+
+			double getFps() const;
+
+			int getWidth() const;
+
+			int getHeight() const;
+
+			/**
+			* \brief Selects frame indices of a shot with frameCount frames.
+			* \param perSecond false: maxFrames frames in the centers of equal segments of the shot (FramesPerVideo),
+			*		true: maxFrames frames evenly spaced within every second (FramesPerSecond)
+			*/
+			static std::vector<int> selectFrames(int frameCount, double fps, int maxFrames, bool perSecond);
+
+			/**
+			* \brief Sets the ascending frame indices returned by next().
+			*/
+			void setFrames(const std::vector<int>& frames);
+
+			/**
+			* \brief Reads the next selected frame, usable as TPCTPipeline::FrameSource.
+			* \return false if all selected frames were read or the video ended
+			*/
+			bool next(cv::Mat& image);
+
+			/**
+			* \brief Reads the frame with the given index.
+			*/
+			bool read(int frame, cv::Mat& image);
+
+			/**
+			* \brief False after the reader fell back to sequential reading.
+			*/
+			bool isSeeking() const;
+
+			int getSeekCount() const;
+
+			int getDecodedCount() const;
+
+		private:
+			bool seek(int frame);
+			bool restart();
+
+			cv::VideoCapture mCapture;
+			std::string mFile;
+			int mSeekDistance;
+			int mPosition;		///< index of the frame returned by the next grab
+			bool mSeeking;
+
+			std::vector<int> mFrames;
+			size_t mNextFrame;
+
+			int mSeeks;
+			int mDecoded;
+		};
+	}
+}
+
+
+#endif //__TPCTFRAMEREADER_H__
@@ -0,0 +1,250 @@
+#include "tpct_pipeline.hpp"
+#include <cpluslogger.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <thread>
+#include <chrono>
+
+using namespace analysis::tpct_signatures;
+
+TPCTPipeline::TPCTPipeline(const cv::Ptr<cv::xfeatures2d::PCTSignatures>& signatures, int queueSize)
+	: mSignatures(signatures), mQueueSize(std::max(1, queueSize)), mFrames(nullptr), mSamples(nullptr), mStatics(nullptr), mAbort(false)
+{
+}
+
+TPCTPipeline::~TPCTPipeline()
+{
+	delete mFrames;
+	delete mSamples;
+	delete mStatics;
+}
+
+int TPCTPipeline::computeTemporalSignature(const FrameSource& source, cv::OutputArray _temporalsignature,
+	cv::xfeatures2d::pct_signatures::StageTimes* times)
+{
+	delete mFrames;
+	delete mSamples;
+	delete mStatics;
+	mFrames = new SPSCQueue<Item>(mQueueSize);
+	mSamples = new SPSCQueue<Item>(mQueueSize);
+	mStatics = new SPSCQueue<Item>(mQueueSize);
+
+	mAbort = false;
+	mError.clear();
+	mDecoderTimes = cv::xfeatures2d::pct_signatures::StageTimes();
+	mSamplerTimes = cv::xfeatures2d::pct_signatures::StageTimes();
+	mClusterizerTimes = cv::xfeatures2d::pct_signatures::StageTimes();
+
+	boost::thread decoder(boost::bind(&TPCTPipeline::decode, this, boost::cref(source)));
+	boost::thread sampler(boost::bind(&TPCTPipeline::sample, this));
+	boost::thread clusterizer(boost::bind(&TPCTPipeline::clusterize, this));
+
+	// tracking stage: the matching runs backwards from the last frame, so it starts when all static signatures are there
+	std::vector<cv::Mat> staticsignatures;
+	Item item;
+	while (pop(*mStatics, item) && !item.mLast)
+	{
+		staticsignatures.push_back(item.mData);
+		item.mData = cv::Mat();		// the signature is owned by the vector, it must not be recycled
+	}
+
+	decoder.join();
+	sampler.join();
+	clusterizer.join();
+
+	if (mAbort)
+	{
+		CV_Error_(CV_StsError, ("%s", mError.c_str()));
+	}
+
+	int64 trackingStart = cv::getTickCount();
+	mTracker.computeTemporalSignature(staticsignatures, _temporalsignature);
+
+	if (times != nullptr)
+	{
+		times->add(mDecoderTimes);
+		times->add(mSamplerTimes);
+		times->add(mClusterizerTimes);
+		times->mTracking += (cv::getTickCount() - trackingStart) / cv::getTickFrequency();
+	}
+	return int(staticsignatures.size());
+}
+
+int TPCTPipeline::computeTemporalSignatureSequential(const FrameSource& source, cv::OutputArray _temporalsignature,
+	cv::xfeatures2d::pct_signatures::StageTimes* times) const
+{
+	cv::xfeatures2d::pct_signatures::StageTimes stageTimes;
+	std::vector<cv::Mat> staticsignatures;
+	cv::Mat frame;
+	while (true)
+	{
+		int64 decodingStart = cv::getTickCount();
+		bool isRead = source(frame);
+		stageTimes.mDecoding += (cv::getTickCount() - decodingStart) / cv::getTickFrequency();
+		if (!isRead)
+		{
+			break;
+		}
+		stageTimes.mFrames++;
+
+		// the two steps of computeSignature, so that their times are measured
+		cv::Mat samples, signature;
+		if (!frame.empty())
+		{
+			mSignatures->computeSamples(frame, samples, &stageTimes);
+			mSignatures->computeSignatureFromSamples(samples, signature, &stageTimes);
+		}
+		staticsignatures.push_back(signature);
+	}
+
+	int64 trackingStart = cv::getTickCount();
+	mTracker.computeTemporalSignature(staticsignatures, _temporalsignature);
+	stageTimes.mTracking += (cv::getTickCount() - trackingStart) / cv::getTickFrequency();
+
+	if (times != nullptr)
+	{
+		times->add(stageTimes);
+	}
+	return int(staticsignatures.size());
+}
+
+void TPCTPipeline::decode(const FrameSource& source)
+{
+	try
+	{
+		// after a push the item holds a frame buffer returned by the sampler (or nothing yet)
+		Item frame;
+		while (true)
+		{
+			int64 decodingStart = cv::getTickCount();
+			bool last = !source(frame.mData);
+			mDecoderTimes.mDecoding += (cv::getTickCount() - decodingStart) / cv::getTickFrequency();
+			frame.mLast = last;
+			if (last)
+			{
+				frame.mData.release();
+			}
+			else
+			{
+				mDecoderTimes.mFrames++;
+			}
+
+			// the pushed item is swapped with the slot content, do not read frame afterwards
+			if (!push(*mFrames, frame) || last)
+			{
+				return;
+			}
+		}
+	}
+	catch (std::exception& e)
+	{
+		fail("decoder", e.what());
+	}
+}
+
+void TPCTPipeline::sample()
+{
+	try
+	{
+		Item frame, samples;
+		while (pop(*mFrames, frame))
+		{
+			samples.mLast = frame.mLast;
+			if (frame.mLast || frame.mData.empty())
+			{
+				samples.mData.release();		// an empty frame has an empty signature, as in computeSignature
+			}
+			else
+			{
+				mSignatures->computeSamples(frame.mData, samples.mData, &mSamplerTimes);
+			}
+
+			if (!push(*mSamples, samples) || frame.mLast)
+			{
+				return;
+			}
+		}
+	}
+	catch (std::exception& e)
+	{
+		fail("sampler", e.what());
+	}
+}
+
+void TPCTPipeline::clusterize()
+{
+	try
+	{
+		Item samples, signature;
+		while (pop(*mSamples, samples))
+		{
+			signature.mLast = samples.mLast;
+			signature.mData = cv::Mat();
+			if (!samples.mLast && !samples.mData.empty())
+			{
+				mSignatures->computeSignatureFromSamples(samples.mData, signature.mData, &mClusterizerTimes);
+			}
+
+			if (!push(*mStatics, signature) || samples.mLast)
+			{
+				return;
+			}
+		}
+	}
+	catch (std::exception& e)
+	{
+		fail("clusterizer", e.what());
+	}
+}
+
+bool TPCTPipeline::push(SPSCQueue<Item>& queue, Item& item)
+{
+	for (int spin = 0; !queue.tryPush(item); spin++)
+	{
+		if (mAbort)
+		{
+			return false;
+		}
+		if (spin < 64)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	return true;
+}
+
+bool TPCTPipeline::pop(SPSCQueue<Item>& queue, Item& item)
+{
+	for (int spin = 0; !queue.tryPop(item); spin++)
+	{
+		if (mAbort)
+		{
+			return false;
+		}
+		if (spin < 64)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	return true;
+}
+
+void TPCTPipeline::fail(const std::string& stage, const std::string& message)
+{
+	LOG_ERROR("Pipeline stage " << stage << " failed: " << message);
+
+	boost::mutex::scoped_lock lock(mErrorMutex);
+	if (!mAbort)
+	{
+		mError = stage + ": " + message;
+		mAbort = true;
+	}
+}
@@ -0,0 +1,147 @@
+#ifndef __TPCTPIPELINE_H__
+#define __TPCTPIPELINE_H__
+#include <opencv2/core.hpp>
+#include <cvpctsig.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "tpct_signatures.hpp"
+
+namespace analysis
+{
+	namespace tpct_signatures
+	{
+		/**
+		* \brief Bounded lock-free queue for exactly one producer and one consumer thread.
+		*		Items are swapped in and out, so the producer gets the previous content of a slot back
+		*		(e.g. a recycled cv::Mat buffer).
+		*/
+		template<class T>
+		class SPSCQueue
+		{
+		public:
+			explicit SPSCQueue(size_t capacity) : mBuffer(capacity + 1), mHead(0), mTail(0) {}
+
+			/**
+			* \brief Called by the producer only.
+			* \return False if the queue is full.
+			*/
+			bool tryPush(T& item)
+			{
+				size_t tail = mTail.load(std::memory_order_relaxed);
+				size_t next = (tail + 1) % mBuffer.size();
+				if (next == mHead.load(std::memory_order_acquire))
+				{
+					return false;
+				}
+				std::swap(mBuffer[tail], item);
+				mTail.store(next, std::memory_order_release);
+				return true;
+			}
+
+			/**
+			* \brief Called by the consumer only.
+			* \return False if the queue is empty.
+			*/
+			bool tryPop(T& item)
+			{
+				size_t head = mHead.load(std::memory_order_relaxed);
+				if (head == mTail.load(std::memory_order_acquire))
+				{
+					return false;
+				}
+				std::swap(mBuffer[head], item);
+				mHead.store((head + 1) % mBuffer.size(), std::memory_order_release);
+				return true;
+			}
+
+		private:
+			std::vector<T> mBuffer;
+			std::atomic<size_t> mHead;
+			std::atomic<size_t> mTail;
+		};
+
+		/**
+		* \brief Computes the temporal signature of a shot in four stages running concurrently:
+		*		decoding (given frame source) -> sampling -> clustering -> tracking.
+		*		The stages are connected by bounded SPSC queues, so frame N+1 is decoded while frame N
+		*		is sampled or clustered. A consumer swaps its finished item into the queue slot, thus frame
+		*		and sample buffers travel back to their producer and are reused for the next frames.
+		*		Every frame passes the same sampler and clusterizer as in PCTSignatures::computeSignature,
+		*		the tracking is TPCTSignatures::computeTemporalSignature, thus the result equals the sequential one.
+		*/
+		class TPCTPipeline
+		{
+		public:
+			/**
+			* \brief Reads the next frame into the given buffer (the buffer of an already processed frame).
+			*		Returns false if there are no more frames.
+			*/
+			typedef boost::function<bool(cv::Mat&)> FrameSource;
+
+			/**
+			* \param signatures configured static signature extractor
+			* \param queueSize capacity of the queues between the stages
+			*/
+			TPCTPipeline(const cv::Ptr<cv::xfeatures2d::PCTSignatures>& signatures, int queueSize = 4);
+			~TPCTPipeline();
+
+			/**
+			* \brief Runs the pipeline for all frames of the source.
+			* \param source called from the decoder thread
+			* \param _temporalsignature result of TPCTSignatures::computeTemporalSignature
+			* \param times optional, the busy time of each stage is added (waiting on the queues is not counted)
+			* \return number of processed frames
+			*/
+			int computeTemporalSignature(const FrameSource& source, cv::OutputArray _temporalsignature,
+				cv::xfeatures2d::pct_signatures::StageTimes* times = nullptr);
+
+			/**
+			* \brief Same result as computeTemporalSignature, but all stages run one after another in the calling thread.
+			*/
+			int computeTemporalSignatureSequential(const FrameSource& source, cv::OutputArray _temporalsignature,
+				cv::xfeatures2d::pct_signatures::StageTimes* times = nullptr) const;
+
+		private:
+			/**
+			* \brief Element passed between the stages; mLast marks the end of the shot.
+			*/
+			struct Item
+			{
+				cv::Mat mData;
+				bool mLast;
+
+				Item() : mLast(false) {}
+			};
+
+			void decode(const FrameSource& source);
+			void sample();
+			void clusterize();
+
+			bool push(SPSCQueue<Item>& queue, Item& item);
+			bool pop(SPSCQueue<Item>& queue, Item& item);
+			void fail(const std::string& stage, const std::string& message);
+
+			cv::Ptr<cv::xfeatures2d::PCTSignatures> mSignatures;
+			TPCTSignatures mTracker;
+			int mQueueSize;
+
+			SPSCQueue<Item>* mFrames;		///< decoder -> sampler
+			SPSCQueue<Item>* mSamples;		///< sampler -> clusterizer
+			SPSCQueue<Item>* mStatics;		///< clusterizer -> tracker
+
+			cv::xfeatures2d::pct_signatures::StageTimes mDecoderTimes;		///< written by the decoder thread only
+			cv::xfeatures2d::pct_signatures::StageTimes mSamplerTimes;		///< written by the sampler thread only
+			cv::xfeatures2d::pct_signatures::StageTimes mClusterizerTimes;	///< written by the clusterizer thread only
+
+			std::atomic<bool> mAbort;
+			std::string mError;
+			boost::mutex mErrorMutex;
+		};
+	}
+}
+
+
+#endif //__TPCTPIPELINE_H__
@@ -91,10 +91,16 @@ float TPCTSignatures::computeQuadraticFormDistance(const cv::InputArray _signatu
 	}
 
 	// compute sqfd
+	// the similarity is instantiated as policy over the rows, only unknown similarities are called virtually
+	namespace policy = cv::xfeatures2d::pct_signatures::policy;
+
 	float result = 0;
-	result += computePartialSQFD(signature0, signature0, similarity);
-	result += computePartialSQFD(signature1, signature1, similarity);
-	result -= computePartialSQFD(signature0, signature1, similarity) * 2;
+	if (!policy::visitSimilarity<policy::DIMENSIONS>(similarity, policy::SquaredSQFD(signature0, signature1), result))
+	{
+		result += computePartialSQFD(signature0, signature0, similarity);
+		result += computePartialSQFD(signature1, signature1, similarity);
+		result -= computePartialSQFD(signature0, signature1, similarity) * 2;
+	}
 
 	return sqrt(result);
 }
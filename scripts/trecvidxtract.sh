@@ -6,6 +6,8 @@
 # This script uses the descriptor extraction tool of the vretbox.
 #
 # @author skletz
+# @version 1.2 17/10/27 master shot mode for full videos and their msb files
+# @version 1.1 17/10/26 batch mode for directories and file lists
 # @version 1.0 09/06/17
 # -----------------------------------------------------------------------------
 # @TODO:
@@ -16,13 +18,23 @@ USAGE="A script for extracting content features from the TREVid dataset using vr
 Usage: `basename $0` [-infile] [-outfile] [-srv]
     -h    Shows help
     -i    Video-File <only tested with .MP4 files>
+    -d    Directory of Video-Files (batch mode, all shots are processed by one vretbox process)
+    -l    File with one Video-File per line (batch mode)
+    -j    Number of worker threads in batch mode (default: number of cores)
+    -m    MSB-File <vid>.csv of the full Video-File given by -i (master shot mode, the video is not split by divdeo.sh)
     -c    Config-File
     -o    The path to the output directory
     -s    Server-ID <s1,s2 ...> for the identification of the output files on different servers
  Examples:
-    bash `basename $0` -i ../testdata/shots/test.mp4 -c ../testdata/config/test.ini -o ../testdata/features -s s1"
+    bash `basename $0` -i ../testdata/shots/test.mp4 -c ../testdata/config/test.ini -o ../testdata/features -s s1
+    bash `basename $0` -d ../testdata/shots -c ../testdata/config/test.ini -o ../testdata/features -s s1 -j 4
+    bash `basename $0` -i ../testdata/videos/39238.mp4 -m ../testdata/msbs/39238.csv -c ../testdata/config/test.ini -o ../testdata/features -s s1"
 
 INFILE=""
+INDIR=""
+FILELIST=""
+MSBFILE=""
+THREADS=0
 CONFIGFILE=""
 OUTFILE=""
 SRV=""
@@ -33,11 +45,15 @@ if [ $# -eq 0 ]; then #  must be at least one arg
     exit 1
 fi
 
-while getopts i:c:o:s:h OPT; do
+while getopts i:d:l:m:j:c:o:s:h OPT; do
     case $OPT in
     h)  echo "$USAGE"
         exit 0 ;;
     i)  INFILE=$OPTARG ;;
+    d)  INDIR=$OPTARG ;;
+    l)  FILELIST=$OPTARG ;;
+    m)  MSBFILE=$OPTARG ;;
+    j)  THREADS=$OPTARG ;;
     c)  CONFIGFILE=$OPTARG ;;
     o)  OUTFILE=$OPTARG ;;
     s)  SRV=$OPTARG ;;
@@ -49,6 +65,9 @@ done
 shift `expr $OPTIND - 1`
 
 printf "%-20s %s\n" "input file :"  "$INFILE"
+printf "%-20s %s\n" "input directory :"  "$INDIR"
+printf "%-20s %s\n" "input list :"  "$FILELIST"
+printf "%-20s %s\n" "msb file :"  "$MSBFILE"
 printf "%-20s %s\n" "config file :"   "$CONFIGFILE"
 printf "%-20s %s\n" "output file :"   "$OUTFILE"
 printf "%-20s %s\n" "server id :"    "$SRV"
@@ -71,6 +90,26 @@ else
   PROG="vretbox.exe"
 fi
 
+# batch mode: one process with warm extractors for all master shots
+if [ -n "$INDIR" ]; then
+  echo -e "srvid:\t$SRV\t$BIN/$PROG --config $CONFIGFILE --indir "$INDIR" --General.threads $THREADS $OUTFILE"
+  $BIN/$PROG --config "$CONFIGFILE" --indir "$INDIR" --General.threads "$THREADS" "$OUTFILE"
+  exit $?
+fi
+
+if [ -n "$FILELIST" ]; then
+  echo -e "srvid:\t$SRV\t$BIN/$PROG --config $CONFIGFILE --filelist "$FILELIST" --General.threads $THREADS $OUTFILE"
+  $BIN/$PROG --config "$CONFIGFILE" --filelist "$FILELIST" --General.threads "$THREADS" "$OUTFILE"
+  exit $?
+fi
+
+# master shot mode: the full video is decoded once, one feature file per master shot
+if [ -n "$MSBFILE" ]; then
+  echo -e "srvid:\t$SRV\t$BIN/$PROG --config $CONFIGFILE -i "$INFILE" --msbfile "$MSBFILE" $OUTFILE"
+  $BIN/$PROG --config "$CONFIGFILE" -i "$INFILE" --msbfile "$MSBFILE" "$OUTFILE"
+  exit $?
+fi
+
 IN_NAME=$(basename "$INFILE")
 OUT_NAME=$(basename "$OUTFILE")
 
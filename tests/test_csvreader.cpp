@@ -0,0 +1,55 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <csvreader.hpp>
+#include <fstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace trecvid
+{
+	const std::string CSVFILE = "../../../../testdata/getint.csv";
+
+	TEST_CLASS(CSVReaderIntegers)
+	{
+	public:
+
+		TEST_METHOD(IntegersAreParsed)
+		{
+			{
+				std::ofstream csv(CSVFILE, std::ios::out | std::ios::trunc);
+				csv << "7, -42 ,+5,2147483647,-2147483648\n"
+					<< ",  ,-,+,x,4x\n"
+					<< "2147483648,-2147483649,99999999999999999999\n";
+			}
+
+			CSVReader reader;
+			Assert::IsTrue(reader.open(CSVFILE), L"Csv file could not be opened", LINE_INFO());
+			int value = 0;
+
+			Assert::IsTrue(reader.next(), L"First row is missing", LINE_INFO());
+			Assert::IsTrue(reader.getInt(0, value) && value == 7, L"Integer is not parsed", LINE_INFO());
+			Assert::IsTrue(reader.getInt(1, value) && value == -42, L"Negative integer with blanks is not parsed", LINE_INFO());
+			Assert::IsTrue(reader.getInt(2, value) && value == 5, L"Integer with sign is not parsed", LINE_INFO());
+			Assert::IsTrue(reader.getInt(3, value) && value == 2147483647, L"Largest integer is not parsed", LINE_INFO());
+			Assert::IsTrue(reader.getInt(4, value) && value == -2147483647 - 1, L"Smallest integer is not parsed", LINE_INFO());
+			Assert::IsFalse(reader.getInt(5, value), L"Missing field is parsed", LINE_INFO());
+
+			//empty and invalid fields leave the value unchanged
+			value = 11;
+			Assert::IsTrue(reader.next(), L"Second row is missing", LINE_INFO());
+			for (int iField = 0; iField < reader.size(); iField++)
+			{
+				Assert::IsFalse(reader.getInt(iField, value), L"Empty or invalid field is parsed", LINE_INFO());
+			}
+			Assert::AreEqual(11, value, L"Invalid field changes the value", LINE_INFO());
+
+			Assert::IsTrue(reader.next(), L"Third row is missing", LINE_INFO());
+			Assert::IsFalse(reader.getInt(0, value), L"Overflow is parsed", LINE_INFO());
+			Assert::IsFalse(reader.getInt(1, value), L"Negative overflow is parsed", LINE_INFO());
+			Assert::IsFalse(reader.getInt(2, value), L"Overflow of a long long is parsed", LINE_INFO());
+
+			reader.close();
+			std::remove(CSVFILE.c_str());
+		}
+	};
+}
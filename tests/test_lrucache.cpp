@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <lrucache.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace vretbox
+{
+	TEST_CLASS(LRUCacheEviction)
+	{
+	public:
+
+		TEST_METHOD(LeastRecentlyUsedEntryIsEvicted)
+		{
+			LRUCache<std::string, int> cache(2);
+			int value = 0;
+			cache.put("a", 1);
+			cache.put("b", 2);
+
+			//a is used again, so b is the least recently used entry
+			Assert::IsTrue(cache.get("a", value) && value == 1, L"Entry is not cached", LINE_INFO());
+			cache.put("c", 3);
+
+			Assert::AreEqual(size_t(2), cache.size(), L"Cache exceeds its capacity", LINE_INFO());
+			Assert::IsFalse(cache.get("b", value), L"Least recently used entry is not evicted", LINE_INFO());
+			Assert::IsTrue(cache.get("a", value) && value == 1, L"Recently used entry is evicted", LINE_INFO());
+			Assert::IsTrue(cache.get("c", value) && value == 3, L"New entry is not cached", LINE_INFO());
+		}
+
+		TEST_METHOD(ReplacedEntryIsMostRecentlyUsed)
+		{
+			LRUCache<std::string, int> cache(2);
+			int value = 0;
+			cache.put("a", 1);
+			cache.put("b", 2);
+			cache.put("a", 4);
+			cache.put("c", 3);
+
+			Assert::IsTrue(cache.get("a", value) && value == 4, L"Replaced entry is evicted", LINE_INFO());
+			Assert::IsFalse(cache.get("b", value), L"Least recently used entry is not evicted", LINE_INFO());
+		}
+
+		TEST_METHOD(ZeroCapacityCachesNothing)
+		{
+			LRUCache<std::string, int> cache(0);
+			int value = 0;
+			cache.put("a", 1);
+
+			Assert::AreEqual(size_t(0), cache.size(), L"Disabled cache has entries", LINE_INFO());
+			Assert::IsFalse(cache.get("a", value), L"Disabled cache returns an entry", LINE_INFO());
+			Assert::AreEqual(size_t(1), cache.getMisses(), L"Miss is not counted", LINE_INFO());
+		}
+	};
+}
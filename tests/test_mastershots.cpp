@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <defuse.hpp>
+#include <cvtfsig.h>
+#include <trecvidxtraction.hpp>
+#include <boost/bind.hpp>
+#include <cstdio>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace vretbox
+{
+	//the settings of DySig_5_FramesPerVideo_true_8000_40_5_2_0.01_0_random_5_4
+	const std::string MSB_SHOTS = "../../../../testdata/shots/";
+	const std::string MSB_SAMPLEPOINTDIR = "../../../../testdata/samplepoints/";
+	const int MSB_FRAMES = 5;
+	const int MSB_SAMPLEPOINTS = 8000;
+	const int MSB_CLUSTERS = 40;
+	const float MSB_EPSILON = 1e-4f;
+
+	void setArgument(boost::program_options::variables_map& _args, std::string _name, const boost::any& _value)
+	{
+		_args.erase(_name);
+		_args.insert(std::make_pair(_name, boost::program_options::variable_value(_value, false)));
+	}
+
+	boost::program_options::variables_map createArguments()
+	{
+		boost::program_options::variables_map args;
+		setArgument(args, "Cfg.ffs.distribution", std::string("random"));
+		setArgument(args, "Cfg.ffs.samplepointdir", MSB_SAMPLEPOINTDIR);
+		setArgument(args, "Cfg.ffs.resetTracking", true);
+		setArgument(args, "Cfg.ffs.initSeeds", MSB_SAMPLEPOINTS);
+		setArgument(args, "Cfg.ffs.initialCentroids", MSB_CLUSTERS);
+		setArgument(args, "Cfg.ffs.iterations", 5);
+		setArgument(args, "Cfg.ffs.minClusterSize", 2);
+		setArgument(args, "Cfg.ffs.minDistance", 0.01f);
+		setArgument(args, "Cfg.ffs.dropThreshold", 0.0f);
+		setArgument(args, "Cfg.ffs.grayscaleBits", 5);
+		setArgument(args, "Cfg.ffs.windowRadius", 4);
+		return args;
+	}
+
+	TEST_CLASS(MasterShots)
+	{
+	public:
+
+		TEST_METHOD(PipelineMatchesDYSIGXtractor)
+		{
+			cv::Ptr<cv::xfeatures2d::PCTSignatures> signatures = trecvid::TRECVidXtraction::createSignatures(createArguments());
+			Assert::IsFalse(signatures.empty(), L"Static signature extractor could not be created", LINE_INFO());
+			analysis::tpct_signatures::TPCTPipeline pipeline(signatures);
+
+			defuse::DYSIGXtractor* xtractor = new defuse::DYSIGXtractor(MSB_FRAMES, MSB_SAMPLEPOINTS, MSB_CLUSTERS, MSB_SAMPLEPOINTDIR,
+				defuse::SamplePoints::Distribution::RANDOM);
+
+			std::vector<std::string> shots = cplusutil::FileIO::getFileListFromDirectory(MSB_SHOTS, ".mp4");
+			Assert::IsFalse(shots.empty(), L"No test shots found", LINE_INFO());
+
+			for (int iShot = 0; iShot < shots.size(); iShot++)
+			{
+				File* videofile = new File(shots.at(iShot));
+				defuse::VideoBase* video = new defuse::VideoBase(videofile);
+				defuse::Features* expected = xtractor->xtract(video);
+				Assert::IsTrue(expected != nullptr, L"DYSIGXtractor returns no features", LINE_INFO());
+
+				//the frame count of a shot is given by its name, as the master shot boundaries in the master shot mode
+				int vid, sid, start, end;
+				Assert::AreEqual(4, std::sscanf(videofile->getFilename().c_str(), "%d_%d_%d-%d", &vid, &sid, &start, &end), L"Shot name is not parsed", LINE_INFO());
+
+				analysis::tpct_signatures::FrameReader reader(shots.at(iShot));
+				Assert::IsTrue(reader.isOpened(), L"Shot could not be opened", LINE_INFO());
+				reader.setFrames(analysis::tpct_signatures::FrameReader::selectFrames(end - start + 1, reader.getFps(), MSB_FRAMES, false));
+
+				cv::Mat actual;
+				pipeline.computeTemporalSignature(boost::bind(&analysis::tpct_signatures::FrameReader::next, &reader, _1), actual);
+
+				Assert::AreEqual(expected->mVectors.rows, actual.rows, L"Signatures have another number of centroids", LINE_INFO());
+				Assert::AreEqual(expected->mVectors.cols, actual.cols, L"Signatures have another dimension", LINE_INFO());
+				Assert::IsTrue(cv::norm(expected->mVectors, actual, cv::NORM_INF) <= MSB_EPSILON, L"Signatures differ from DYSIGXtractor", LINE_INFO());
+
+				delete expected;
+				delete video;
+				delete videofile;
+			}
+
+			delete xtractor;
+		}
+
+		TEST_METHOD(ResetTrackingIsRequired)
+		{
+			boost::program_options::variables_map args = createArguments();
+			setArgument(args, "Cfg.ffs.resetTracking", false);
+
+			Assert::IsTrue(trecvid::TRECVidXtraction::createSignatures(args).empty(), L"Tracking without reset is accepted", LINE_INFO());
+		}
+
+		TEST_METHOD(StoredSamplePointsAreRequired)
+		{
+			boost::program_options::variables_map args = createArguments();
+			setArgument(args, "Cfg.ffs.initSeeds", 123);
+
+			Assert::IsTrue(trecvid::TRECVidXtraction::createSignatures(args).empty(), L"Missing sample points are generated", LINE_INFO());
+		}
+	};
+}
@@ -0,0 +1,96 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <pivotindex.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace trecvid
+{
+	const int PIVOT_ELEMENTS = 200;
+	const int PIVOT_COUNT = 8;
+	const int PIVOT_K = 10;
+
+	void fillModel(SignatureStore& _model, cv::RNG& _rng)
+	{
+		for (int iElem = 0; iElem < PIVOT_ELEMENTS; iElem++)
+		{
+			cv::Mat signature(_rng.uniform(3, 20), cv::xfeatures2d::pct_signatures::SIGNATURE_DIMENSION, CV_32FC1);
+			_rng.fill(signature, cv::RNG::UNIFORM, 0.0f, 1.0f);
+			_model.add(signature, iElem, 0, 0, "");
+		}
+	}
+
+	/**
+	* \brief The ranking of a scan of the model, as TRECVidValuation::rankModel without an index
+	*/
+	std::vector<PivotIndex::Match> scan(const SignatureStore& _model, const SQFDistance& _distance, const cv::Mat& _queryCodes)
+	{
+		float querySelfSimilarity = _distance.computeSelfSimilarity(_model.getQuantizer(), _queryCodes);
+
+		std::vector<PivotIndex::Match> ranking;
+		for (int iElem = 0; iElem < _model.size(); iElem++)
+		{
+			cv::Mat codes = _model.getCodes(iElem);
+			float distance = _distance.compute(_model.getQuantizer(), _queryCodes, querySelfSimilarity, codes, _distance.computeSelfSimilarity(_model.getQuantizer(), codes));
+			ranking.push_back(PivotIndex::Match(distance, iElem));
+		}
+		std::sort(ranking.begin(), ranking.end());
+		ranking.resize(PIVOT_K);
+		return ranking;
+	}
+
+	void assertIndexMatchesScan(Quantizer::Encoding _encoding)
+	{
+		cv::RNG rng(17);
+		SignatureStore model;
+		fillModel(model, rng);
+		if (_encoding != Quantizer::FLOAT32)
+		{
+			Assert::IsTrue(model.quantize(_encoding), L"Model cannot be quantized", LINE_INFO());
+		}
+
+		SQFDistance distance(SQFDistance::HEURISTIC, 2.0f, 1.0f);
+		vretbox::WorkStealingPool pool(4);
+		PivotIndex index;
+		index.build(model, distance, PIVOT_COUNT, pool);
+
+		for (int iQuery = 0; iQuery < PIVOT_ELEMENTS; iQuery += 37)
+		{
+			cv::Mat queryCodes = model.getCodes(iQuery);
+			std::vector<PivotIndex::Match> expected = scan(model, distance, queryCodes);
+
+			std::vector<PivotIndex::Match> actual;
+			PivotIndex::Statistics statistics;
+			index.knn(queryCodes, PIVOT_K, 16, pool, actual, statistics);
+
+			Assert::AreEqual(int(expected.size()), int(actual.size()), L"Index returns another number of matches", LINE_INFO());
+			for (int iMatch = 0; iMatch < expected.size(); iMatch++)
+			{
+				Assert::AreEqual(expected[iMatch].second, actual[iMatch].second, L"Index ranks another element", LINE_INFO());
+				Assert::AreEqual(expected[iMatch].first, actual[iMatch].first, L"Index computes another distance", LINE_INFO());
+			}
+		}
+	}
+
+	TEST_CLASS(PivotIndexRanking)
+	{
+	public:
+
+		TEST_METHOD(FloatIndexMatchesScan)
+		{
+			assertIndexMatchesScan(Quantizer::FLOAT32);
+		}
+
+		TEST_METHOD(Float16IndexMatchesScan)
+		{
+			assertIndexMatchesScan(Quantizer::FLOAT16);
+		}
+
+		TEST_METHOD(Int8IndexMatchesScan)
+		{
+			assertIndexMatchesScan(Quantizer::INT8);
+		}
+	};
+}
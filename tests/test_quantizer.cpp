@@ -0,0 +1,163 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <quantizer.hpp>
+#include <featurecollection.hpp>
+#include <opencv2/opencv.hpp>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace trecvid
+{
+	const std::string COLLECTIONFILE = "../../../../testdata/collection.bin";
+	const int COLLECTION_SIGNATURES = 12;
+	const int COLLECTION_DIMENSION = 8;
+
+	float fromBits(uint32_t _bits)
+	{
+		float value;
+		std::memcpy(&value, &_bits, sizeof(value));
+		return value;
+	}
+
+	bool isNaNHalf(uint16_t _half)
+	{
+		return (_half & 0x7c00) == 0x7c00 && (_half & 0x3ff) != 0;
+	}
+
+	void fillStore(SignatureStore& _store)
+	{
+		cv::RNG rng(29);
+		for (int iSignature = 0; iSignature < COLLECTION_SIGNATURES; iSignature++)
+		{
+			cv::Mat signature(rng.uniform(1, 40), COLLECTION_DIMENSION, CV_32FC1);
+			rng.fill(signature, cv::RNG::UNIFORM, -1.0f, 1.0f);
+			_store.add(signature, 1000 + iSignature, iSignature, 0, std::to_string(1000 + iSignature) + "_" + std::to_string(iSignature) + "_shot.bin");
+		}
+	}
+
+	void assertCollectionRoundTrip(Quantizer::Encoding _encoding)
+	{
+		SignatureStore written;
+		fillStore(written);
+		if (_encoding != Quantizer::FLOAT32)
+		{
+			Assert::IsTrue(written.quantize(_encoding), L"Store cannot be quantized", LINE_INFO());
+		}
+		Assert::IsTrue(FeatureCollection::write(written, COLLECTIONFILE), L"Collection could not be written", LINE_INFO());
+
+		SignatureStore read;
+		FeatureCollection collection;
+		Assert::IsTrue(collection.open(COLLECTIONFILE, read), L"Collection could not be opened", LINE_INFO());
+
+		Assert::AreEqual(written.size(), read.size(), L"Collection has another number of signatures", LINE_INFO());
+		Assert::AreEqual(written.getDimension(), read.getDimension(), L"Collection has another dimension", LINE_INFO());
+		Assert::AreEqual(int(written.getQuantizer().getEncoding()), int(read.getQuantizer().getEncoding()), L"Collection has another encoding", LINE_INFO());
+		Assert::IsTrue(written.getQuantizer().getMinima() == read.getQuantizer().getMinima()
+			&& written.getQuantizer().getScales() == read.getQuantizer().getScales(), L"Collection has another quantization", LINE_INFO());
+
+		for (int iSignature = 0; iSignature < written.size(); iSignature++)
+		{
+			Assert::AreEqual(written.getVID(iSignature), read.getVID(iSignature), L"Signature has another video id", LINE_INFO());
+			Assert::AreEqual(written.getSID(iSignature), read.getSID(iSignature), L"Signature has another shot id", LINE_INFO());
+			Assert::IsTrue(written.getFilename(iSignature) == read.getFilename(iSignature), L"Signature has another filename", LINE_INFO());
+			Assert::AreEqual(written.getRows(iSignature), read.getRows(iSignature), L"Signature has another number of rows", LINE_INFO());
+
+			//the encoded rows are stored as they are, so they have to be equal bit by bit
+			cv::Mat writtenCodes = written.getCodes(iSignature), readCodes = read.getCodes(iSignature);
+			Assert::AreEqual(0, std::memcmp(writtenCodes.data, readCodes.data, written.getRows(iSignature) * written.getRowSize()),
+				L"Signature has other rows", LINE_INFO());
+		}
+
+		collection.close();
+		std::remove(COLLECTIONFILE.c_str());
+	}
+
+	TEST_CLASS(HalfConversion)
+	{
+	public:
+
+		TEST_METHOD(SubnormalsAreExact)
+		{
+			//2^-24 is the smallest, 1023 * 2^-24 the largest subnormal half
+			Assert::AreEqual(uint16_t(0x0001), Quantizer::toHalf(std::ldexp(1.0f, -24)), L"Smallest subnormal is not encoded", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x03ff), Quantizer::toHalf(std::ldexp(1023.0f, -24)), L"Largest subnormal is not encoded", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x8001), Quantizer::toHalf(-std::ldexp(1.0f, -24)), L"Negative subnormal is not encoded", LINE_INFO());
+
+			for (uint16_t half = 1; half < 0x400; half++)
+			{
+				Assert::AreEqual(std::ldexp(float(half), -24), Quantizer::fromHalf(half), L"Subnormal is not decoded", LINE_INFO());
+			}
+		}
+
+		TEST_METHOD(HalfwayValuesRoundToEven)
+		{
+			//1 + 2^-11 is halfway between 1 (0x3c00) and 1 + 2^-10 (0x3c01)
+			Assert::AreEqual(uint16_t(0x3c00), Quantizer::toHalf(1.0f + std::ldexp(1.0f, -11)), L"Halfway value is not rounded down to even", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x3c02), Quantizer::toHalf(1.0f + 3 * std::ldexp(1.0f, -11)), L"Halfway value is not rounded up to even", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x3c01), Quantizer::toHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)), L"Value above halfway is not rounded up", LINE_INFO());
+
+			//halfway between subnormals
+			Assert::AreEqual(uint16_t(0x0000), Quantizer::toHalf(std::ldexp(1.0f, -25)), L"Halfway subnormal is not rounded down to even", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x0002), Quantizer::toHalf(std::ldexp(3.0f, -25)), L"Halfway subnormal is not rounded up to even", LINE_INFO());
+
+			//the largest subnormal rounds up into the smallest normal half
+			Assert::AreEqual(uint16_t(0x0400), Quantizer::toHalf(std::ldexp(2047.0f, -25)), L"Rounding does not carry into the exponent", LINE_INFO());
+
+			//65520 is halfway between the largest half 65504 and 65536, which is infinite
+			Assert::AreEqual(uint16_t(0x7bff), Quantizer::toHalf(65504.0f), L"Largest half is not encoded", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x7c00), Quantizer::toHalf(65520.0f), L"Halfway value is not rounded up to infinity", LINE_INFO());
+		}
+
+		TEST_METHOD(InfinityAndNaNArePreserved)
+		{
+			float infinity = std::numeric_limits<float>::infinity();
+			Assert::AreEqual(uint16_t(0x7c00), Quantizer::toHalf(infinity), L"Infinity is not encoded", LINE_INFO());
+			Assert::AreEqual(uint16_t(0xfc00), Quantizer::toHalf(-infinity), L"Negative infinity is not encoded", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x7c00), Quantizer::toHalf(1e6f), L"Value beyond the half range is not infinite", LINE_INFO());
+			Assert::AreEqual(uint16_t(0x8000), Quantizer::toHalf(-0.0f), L"Negative zero is not encoded", LINE_INFO());
+
+			Assert::IsTrue(std::isinf(Quantizer::fromHalf(0x7c00)) && Quantizer::fromHalf(0x7c00) > 0, L"Infinity is not decoded", LINE_INFO());
+			Assert::IsTrue(std::isinf(Quantizer::fromHalf(0xfc00)) && Quantizer::fromHalf(0xfc00) < 0, L"Negative infinity is not decoded", LINE_INFO());
+
+			//a nan whose set mantissa bits are all shifted out stays a nan
+			Assert::IsTrue(isNaNHalf(Quantizer::toHalf(std::numeric_limits<float>::quiet_NaN())), L"Quiet nan is not encoded", LINE_INFO());
+			Assert::IsTrue(isNaNHalf(Quantizer::toHalf(fromBits(0x7f800001))), L"Signaling nan is not encoded", LINE_INFO());
+			Assert::IsTrue(std::isnan(Quantizer::fromHalf(0x7e00)), L"Nan is not decoded", LINE_INFO());
+		}
+
+		TEST_METHOD(AllHalvesRoundTrip)
+		{
+			for (uint32_t half = 0; half <= 0xffff; half++)
+			{
+				if (isNaNHalf(uint16_t(half)))
+				{
+					continue;
+				}
+				Assert::AreEqual(uint16_t(half), Quantizer::toHalf(Quantizer::fromHalf(uint16_t(half))), L"Half does not round trip", LINE_INFO());
+			}
+		}
+	};
+
+	TEST_CLASS(CollectionRoundTrip)
+	{
+	public:
+
+		TEST_METHOD(FloatCollectionIsReadAsWritten)
+		{
+			assertCollectionRoundTrip(Quantizer::FLOAT32);
+		}
+
+		TEST_METHOD(Float16CollectionIsReadAsWritten)
+		{
+			assertCollectionRoundTrip(Quantizer::FLOAT16);
+		}
+
+		TEST_METHOD(Int8CollectionIsReadAsWritten)
+		{
+			assertCollectionRoundTrip(Quantizer::INT8);
+		}
+	};
+}
@@ -0,0 +1,212 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cvpctsig.h>
+#include <opencv2/opencv.hpp>
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace cv::xfeatures2d::pct_signatures;
+
+namespace sqfd
+{
+	const float SQFD_NORMS[4] = { 0.25f, 0.5f, 1.0f, 2.0f };
+	//the vectorized kernel handles the tails of 8 (AVX2) and 4 (SSE2) rows with scalars
+	const int SQFD_ROWS[6] = { 1, 3, 8, 9, 17, 40 };
+
+	/**
+	* \brief Unknown to the kernel and the policies, thus always called virtually
+	*/
+	class VirtualSimilarity : public Similarity
+	{
+		const Similarity& mSimilarity;
+
+	public:
+		VirtualSimilarity(const Similarity& _similarity) : mSimilarity(_similarity) {}
+
+		float operator()(const cv::Mat &points1, int idx1, const cv::Mat &points2, int idx2) const override
+		{
+			return mSimilarity(points1, idx1, points2, idx2);
+		}
+	};
+
+	cv::Mat createSignature(int _rows, cv::RNG& _rng)
+	{
+		cv::Mat signature(_rows, SIGNATURE_DIMENSION, CV_32FC1);
+		_rng.fill(signature, cv::RNG::UNIFORM, 0.0f, 1.0f);
+		return signature;
+	}
+
+	/**
+	* \brief The loop of PCTSignatures::computePartialSQFD
+	*/
+	float computeVirtualPartial(const cv::Mat& _signature0, const cv::Mat& _signature1, const Similarity& _similarity)
+	{
+		float result = 0;
+		for (int i = 0; i < _signature0.rows; i++)
+		{
+			for (int j = 0; j < _signature1.rows; j++)
+			{
+				result += _signature0.at<float>(i, WEIGHT_IDX) * _signature1.at<float>(j, WEIGHT_IDX) * _similarity(_signature0, i, _signature1, j);
+			}
+		}
+		return result;
+	}
+
+	/**
+	* \brief Compares the kernel with the virtual functors; the sums are accumulated in another order,
+	*		so the squared distances may differ by the rounding of the partial sums
+	*/
+	void assertSquaredSQFD(const cv::Mat& _signature0, const cv::Mat& _signature1, const Similarity& _similarity, const SQFDKernel& _kernel)
+	{
+		float self0 = computeVirtualPartial(_signature0, _signature0, _similarity);
+		float self1 = computeVirtualPartial(_signature1, _signature1, _similarity);
+		float cross = computeVirtualPartial(_signature0, _signature1, _similarity);
+		float expected = self0 + self1 - cross * 2;
+
+		float tolerance = 1e-5f * (std::abs(self0) + std::abs(self1) + std::abs(cross) * 2);
+		Assert::AreEqual(expected, _kernel.computeSquared(_signature0, _signature1), tolerance, L"Kernel differs from the virtual similarity", LINE_INFO());
+	}
+
+	TEST_CLASS(SQFDKernelEquivalence)
+	{
+	public:
+
+		TEST_METHOD(MinusSimilarityMatchesVirtualFunctors)
+		{
+			cv::RNG rng(42);
+			for (int iNorm = 0; iNorm < 4; iNorm++)
+			{
+				MinusSimilarity similarity(SQFD_NORMS[iNorm]);
+				SQFDKernel kernel(similarity);
+				Assert::IsTrue(kernel.isSupported(), L"Minus similarity is not supported", LINE_INFO());
+
+				for (int iRows = 0; iRows < 6; iRows++)
+				{
+					assertSquaredSQFD(createSignature(SQFD_ROWS[iRows], rng), createSignature(SQFD_ROWS[5 - iRows], rng), similarity, kernel);
+				}
+			}
+		}
+
+		TEST_METHOD(HeuristicSimilarityMatchesVirtualFunctors)
+		{
+			cv::RNG rng(7);
+			for (int iNorm = 0; iNorm < 4; iNorm++)
+			{
+				HeuristicSimilarity similarity(SQFD_NORMS[iNorm], 1.0f);
+				SQFDKernel kernel(similarity);
+				Assert::IsTrue(kernel.isSupported(), L"Heuristic similarity is not supported", LINE_INFO());
+
+				for (int iRows = 0; iRows < 6; iRows++)
+				{
+					assertSquaredSQFD(createSignature(SQFD_ROWS[iRows], rng), createSignature(SQFD_ROWS[iRows], rng), similarity, kernel);
+				}
+			}
+		}
+
+		TEST_METHOD(ReusedBlocksGiveEqualDistances)
+		{
+			cv::RNG rng(3);
+			HeuristicSimilarity similarity;
+			SQFDKernel kernel(similarity);
+
+			cv::Mat small0 = createSignature(3, rng), small1 = createSignature(9, rng);
+			cv::Mat large0 = createSignature(40, rng), large1 = createSignature(17, rng);
+
+			//the blocks of the thread shrink and grow between the calls
+			float expected = kernel.computeSquared(small0, small1);
+			kernel.computeSquared(large0, large1);
+			Assert::AreEqual(expected, kernel.computeSquared(small0, small1), L"Reused blocks change the distance", LINE_INFO());
+
+			float oneShot = 0;
+			Assert::IsTrue(SQFDKernel::computeSquared(large0, large1, similarity, oneShot), L"One shot kernel is not supported", LINE_INFO());
+			Assert::AreEqual(kernel.computeSquared(large0, large1), oneShot, L"One shot kernel differs from the resolved kernel", LINE_INFO());
+		}
+
+		TEST_METHOD(UnsupportedSimilarityIsRejected)
+		{
+			GaussianSimilarity gaussian;
+			VirtualSimilarity unknown(gaussian);
+			Assert::IsFalse(SQFDKernel(gaussian).isSupported(), L"Gaussian similarity is supported", LINE_INFO());
+			Assert::IsFalse(SQFDKernel(unknown).isSupported(), L"Unknown similarity is supported", LINE_INFO());
+
+			cv::RNG rng(5);
+			float result = -1;
+			Assert::IsFalse(SQFDKernel::computeSquared(createSignature(3, rng), createSignature(3, rng), gaussian, result), L"Gaussian similarity is computed", LINE_INFO());
+			Assert::AreEqual(-1.0f, result, L"Result of an unsupported similarity is changed", LINE_INFO());
+		}
+
+		TEST_METHOD(DistancesMatchVirtualDistance)
+		{
+			cv::RNG rng(11);
+			cv::Mat row = createSignature(1, rng);
+			for (int iNorm = 0; iNorm < 4; iNorm++)
+			{
+				SQFDNorm norm;
+				Assert::IsTrue(SQFDKernel::resolve(SQFD_NORMS[iNorm], norm), L"Norm is not supported", LINE_INFO());
+
+				Distance* distance = createDistance(SQFD_NORMS[iNorm]);
+				for (int iRows = 0; iRows < 6; iRows++)
+				{
+					cv::Mat centroids = createSignature(SQFD_ROWS[iRows], rng);
+					SQFDBlock block;
+					block.assign(centroids);
+
+					std::vector<float> distances(centroids.rows);
+					SQFDKernel::computeDistances(row.ptr<float>(0), block, norm, distances.data());
+					for (int iCentroid = 0; iCentroid < centroids.rows; iCentroid++)
+					{
+						float expected = (*distance)(row, 0, centroids, iCentroid);
+						Assert::AreEqual(expected, distances[iCentroid], 1e-5f * expected, L"Kernel distance differs from the virtual distance", LINE_INFO());
+					}
+				}
+				delete distance;
+			}
+		}
+
+		TEST_METHOD(DistanceToItselfIsZero)
+		{
+			cv::RNG rng(13);
+			HeuristicSimilarity similarity;
+			SQFDKernel kernel(similarity);
+			for (int iRows = 0; iRows < 6; iRows++)
+			{
+				cv::Mat signature = createSignature(SQFD_ROWS[iRows], rng);
+				Assert::AreEqual(0.0f, kernel.computeSquared(signature, signature), L"Distance to itself is not 0", LINE_INFO());
+			}
+		}
+
+		TEST_METHOD(PreparedSignaturesOfEqualSimilaritiesAreCompatible)
+		{
+			cv::RNG rng(19);
+			HeuristicSimilarity similarity0(2.0f, 1.0f), similarity1(2.0f, 1.0f);
+			SQFDKernel kernel(similarity0);
+
+			for (int iRows = 0; iRows < 6; iRows++)
+			{
+				cv::Mat signature0 = createSignature(SQFD_ROWS[iRows], rng), signature1 = createSignature(SQFD_ROWS[5 - iRows], rng);
+				PreparedSignature prepared0(signature0, similarity0), prepared1(signature1, similarity1);
+				Assert::IsTrue(prepared0.isCompatible(prepared1), L"Equal similarities are not compatible", LINE_INFO());
+
+				float squared = prepared0.selfSimilarity() + prepared1.selfSimilarity() - prepared0.computePartial(prepared1) * 2;
+				float tolerance = 1e-5f * (prepared0.selfSimilarity() + prepared1.selfSimilarity() + std::abs(prepared0.computePartial(prepared1)) * 2);
+				Assert::AreEqual(kernel.computeSquared(signature0, signature1), squared, tolerance, L"Prepared signatures differ from the kernel", LINE_INFO());
+			}
+		}
+
+		TEST_METHOD(PreparedSignaturesOfOtherSimilaritiesAreRejected)
+		{
+			cv::RNG rng(23);
+			cv::Mat signature = createSignature(8, rng);
+			HeuristicSimilarity similarity0(2.0f, 1.0f), similarity1(2.0f, 2.0f);
+			Assert::IsFalse(PreparedSignature(signature, similarity0).isCompatible(PreparedSignature(signature, similarity1)),
+				L"Other alphas are compatible", LINE_INFO());
+
+			//unknown similarities cannot be compared by their parameters
+			GaussianSimilarity gaussian;
+			VirtualSimilarity unknown0(gaussian), unknown1(gaussian);
+			PreparedSignature prepared0(signature, unknown0);
+			Assert::IsTrue(prepared0.isCompatible(PreparedSignature(signature, unknown0)), L"The same unknown similarity is not compatible", LINE_INFO());
+			Assert::IsFalse(prepared0.isCompatible(PreparedSignature(signature, unknown1)), L"Other unknown similarities are compatible", LINE_INFO());
+		}
+	};
+}
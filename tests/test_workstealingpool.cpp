@@ -0,0 +1,103 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <workstealingpool.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <stdexcept>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace vretbox
+{
+	const int POOL_WORKERS = 4;
+	const int POOL_TASKS = 200;
+
+	TEST_CLASS(WorkStealing)
+	{
+	public:
+
+		TEST_METHOD(SpawnedTasksCompleteUnderStealing)
+		{
+			WorkStealingPool pool(POOL_WORKERS);
+			std::atomic<int> finished(0);
+
+			//all tasks are spawned onto the deque of one worker, the idle workers have to steal them
+			pool.submit([&pool, &finished](int _worker)
+			{
+				for (int iTask = 0; iTask < POOL_TASKS; iTask++)
+				{
+					pool.spawn(_worker, [&finished](int)
+					{
+						boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+						finished++;
+					});
+				}
+			});
+			pool.wait();
+
+			Assert::AreEqual(POOL_TASKS, finished.load(), L"Not all tasks are finished after wait", LINE_INFO());
+			Assert::IsTrue(pool.getStolenTasks() > 0, L"No task is stolen", LINE_INFO());
+		}
+
+		TEST_METHOD(NestedTasksCompleteBeforeWaitReturns)
+		{
+			WorkStealingPool pool(POOL_WORKERS);
+			std::atomic<int> finished(0);
+
+			//each task spawns two children until the depth is reached: 2^7 - 1 tasks
+			std::function<void(int, int)> split = [&pool, &finished, &split](int _worker, int _depth)
+			{
+				finished++;
+				if (_depth > 1)
+				{
+					pool.spawn(_worker, [&split, _depth](int _child) { split(_child, _depth - 1); });
+					pool.spawn(_worker, [&split, _depth](int _child) { split(_child, _depth - 1); });
+				}
+			};
+
+			for (int iRound = 0; iRound < 3; iRound++)
+			{
+				finished = 0;
+				pool.submit([&split](int _worker) { split(_worker, 7); });
+				pool.wait();
+				Assert::AreEqual(127, finished.load(), L"Not all nested tasks are finished after wait", LINE_INFO());
+			}
+		}
+
+		TEST_METHOD(TaskExceptionIsRethrownByWait)
+		{
+			WorkStealingPool pool(POOL_WORKERS);
+			std::atomic<int> finished(0);
+
+			for (int iTask = 0; iTask < POOL_TASKS; iTask++)
+			{
+				pool.submit([&finished, iTask](int)
+				{
+					if (iTask % 50 == 7)
+					{
+						throw std::runtime_error("malformed signature");
+					}
+					finished++;
+				});
+			}
+
+			bool thrown = false;
+			try
+			{
+				pool.wait();
+			}
+			catch (std::runtime_error&)
+			{
+				thrown = true;
+			}
+			Assert::IsTrue(thrown, L"Exception of a task is not rethrown by wait", LINE_INFO());
+			Assert::AreEqual(POOL_TASKS - 4, finished.load(), L"Other tasks are not finished after a failed task", LINE_INFO());
+
+			//the exception is collected once, the workers keep running
+			finished = 0;
+			pool.submit([&finished](int) { finished++; });
+			pool.wait();
+			Assert::AreEqual(1, finished.load(), L"Pool does not run tasks after a failed task", LINE_INFO());
+		}
+	};
+}
@@ -6,5 +6,8 @@
 #include "../src/trecvidxtraction.hpp"
 #include "../src/trecvidupdate.hpp"
 #include "../src/trecvidvaluation.hpp"
+#include "../src/trecvidpack.hpp"
+#include "../src/trecvidbenchmark.hpp"
+#include "../src/trecvidregression.hpp"
 
 #endif //_VRETBOX_HPP_
\ No newline at end of file
@@ -21,32 +21,39 @@
 #include <cpluslogger.hpp>
 #include <cplusutil.hpp>
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <functional>
+
+#include "src/workstealingpool.hpp"
 
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
-#include <boost/foreach.hpp>
 #include <boost/program_options.hpp>
-#include <boost/tokenizer.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <opencv2/opencv.hpp>
 
 static std::string prog = "MSBConverter";
 static std::string collectionFile = "";
 static std::string msbDirectory = "";
 static std::string outputDirectory = "";
+static int threads = 0;
 using boost::property_tree::ptree;
 
-int countFive = 0;
-int countTen = 0;
-int countTwenty = 0;
-int countThirty = 0;
-int sumShots = 0;
-int counts[30] = { 0 };;
-
-
-
 using namespace boost;
 namespace po = program_options;
 
+/**
+* \brief number of bytes of the collection that are read at once
+*/
+static const size_t CHUNK_SIZE = 1 << 20;
+
+/**
+* \brief number of video files that are converted or queued per worker, it bounds the memory
+*/
+static const int FILES_PER_WORKER = 4;
+
 struct MasterShotBoundary
 {
 	unsigned int start;
@@ -62,10 +69,32 @@ struct VideoFile
 	std::string use;
 	std::string source;
 	std::string filetype;
-	MasterShotBoundaries msbs;
 };
 
-typedef std::vector<VideoFile> VideoFileList;
+/**
+* \brief Shot length statistics, each worker counts its own and they are merged at the end
+*/
+struct ShotStatistics
+{
+	int counts[30];
+	int sumShots;
+	int files;
+
+	ShotStatistics() : sumShots(0), files(0)
+	{
+		std::fill(counts, counts + 30, 0);
+	}
+
+	void merge(const ShotStatistics& _other)
+	{
+		for (int iCount = 0; iCount < 30; iCount++)
+		{
+			counts[iCount] += _other.counts[iCount];
+		}
+		sumShots += _other.sumShots;
+		files += _other.files;
+	}
+};
 
 void showHelp(const po::options_description& desc)
 {
@@ -81,6 +110,7 @@ void processProgramOptions(const int argc, const char *const argv[])
 		("collection-file", po::value<std::string>(&collectionFile), "index file (XML)")
 		("msb-directory", po::value<std::string>(&msbDirectory), "directory containing master shot boundary files")
 		("output-directory", po::value<std::string>(&outputDirectory), "output directory")
+		("threads", po::value<int>(&threads)->default_value(0), "number of threads reading and writing the msb files (0 = number of cores)")
 		;
 
 	po::positional_options_description p;
@@ -129,33 +159,94 @@ void processProgramOptions(const int argc, const char *const argv[])
 
 }
 
-VideoFileList readCollection (std::istream &is)
+/**
+* \brief Finds the next <VideoFile> element in a buffer; <VideoFileList> is not a match
+* \return position of the element or std::string::npos
+*/
+size_t findVideoFile(const std::string& _buffer, size_t _position)
 {
-	// populate tree structure pt
-	ptree pt;
-	read_xml(is, pt);
+	static const std::string tag = "<VideoFile";
 
-	// traverse pt
-	VideoFileList ans;
-	int counter = 0;
-	int max = pt.get_child("VideoFileList").count("VideoFile");
-	BOOST_FOREACH(ptree::value_type const& v, pt.get_child("VideoFileList")) {
+	while ((_position = _buffer.find(tag, _position)) != std::string::npos)
+	{
+		size_t next = _position + tag.size();
+		if (next >= _buffer.size())
+		{
+			return std::string::npos;
+		}
+
+		char c = _buffer[next];
+		if (c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			return _position;
+		}
+		_position = next;
+	}
+	return std::string::npos;
+}
+
+/**
+* \brief Reads the collection incrementally and calls _process for each <VideoFile> element,
+* only the current chunk and the unfinished element are held in memory
+* \return number of video files
+*/
+int readCollection(std::istream &is, size_t _size, const std::function<void(const VideoFile&)>& _process)
+{
+	static const std::string endTag = "</VideoFile>";
+
+	std::string buffer;
+	std::vector<char> chunk(CHUNK_SIZE);
+	size_t consumed = 0;
+	int files = 0;
+
+	while (is)
+	{
+		is.read(chunk.data(), chunk.size());
+		buffer.append(chunk.data(), size_t(is.gcount()));
+
+		size_t position = 0;
+		size_t begin;
+		while ((begin = findVideoFile(buffer, position)) != std::string::npos)
+		{
+			size_t end = buffer.find(endTag, begin);
+			if (end == std::string::npos)
+			{
+				break;
+			}
+			end += endTag.size();
 
-		if (v.first == "VideoFile") {
+			//an element is small, it is parsed by itself
+			ptree pt;
+			std::istringstream element(buffer.substr(begin, end - begin));
+			read_xml(element, pt);
+
+			const ptree& v = pt.get_child("VideoFile");
 			VideoFile f;
-			f.id = v.second.get<int>("id");
-			f.filename = v.second.get<std::string>("filename");
-			f.use = v.second.get<std::string>("use");
-			f.source = v.second.get<std::string>("source");
-			f.filetype = v.second.get<std::string>("filetype");
-			ans.push_back(f);
+			f.id = v.get<int>("id");
+			f.filename = v.get<std::string>("filename");
+			f.use = v.get<std::string>("use");
+			f.source = v.get<std::string>("source");
+			f.filetype = v.get<std::string>("filetype");
+			_process(f);
+			files++;
+
+			position = end;
 		}
 
-		counter++;
-		cplusutil::Terminal::showProgress("Read in Video Files: ", counter, max);
+		//the text before an unfinished element is dropped
+		size_t keep = findVideoFile(buffer, position);
+		if (keep == std::string::npos)
+		{
+			//a tag may be split by the chunk border
+			keep = buffer.size() > 64 ? std::max(position, buffer.size() - 64) : position;
+		}
+		consumed += keep;
+		buffer.erase(0, keep);
 
+		cplusutil::Terminal::showProgress("Convert MSB Files: ", int(_size > 0 ? 1000 * std::min(consumed, _size) / _size : 1000), 1000);
 	}
-	return ans;
+
+	return files;
 }
 
 MasterShotBoundaries readMSB(std::istream &is)
@@ -167,8 +258,6 @@ MasterShotBoundaries readMSB(std::istream &is)
 	int skipLines = 2;
 	while (getline(is, line))
 	{
-		bool isInt = (line.find_first_not_of("0123456789") == std::string::npos);
-
 		if (skipLines != 0)
 		{
 			skipLines--;
@@ -194,104 +283,133 @@ MasterShotBoundaries readMSB(std::istream &is)
 	return shots;
 }
 
-void writeIndex(std::fstream &fs, VideoFile &videoFile)
+void writeIndex(std::fstream &fs, const VideoFile &videoFile, const MasterShotBoundaries& msbs, ShotStatistics& statistics)
 {
-	//cv::VideoCapture video("");
+	//the index is written at once
+	std::string index;
 
-	for (int iShot = 0; iShot < videoFile.msbs.size(); iShot++)
+	for (int iShot = 0; iShot < msbs.size(); iShot++)
 	{
-		int diff = videoFile.msbs.at(iShot).end - videoFile.msbs.at(iShot).start;
+		int diff = msbs.at(iShot).end - msbs.at(iShot).start;
 
-		if (diff < 30)
+		if (diff >= 0 && diff < 30)
 		{
-			counts[diff]++;
+			statistics.counts[diff]++;
 		}
 
 		if(diff == 0)
 		{
-			LOG_ERROR("One Frame Shot: ID\t" << videoFile.id << "; Source\t" << videoFile.source << "Shot Start: \t" << videoFile.msbs.at(iShot).start);
+			LOG_ERROR("One Frame Shot: ID\t" << videoFile.id << "; Source\t" << videoFile.source << "Shot Start: \t" << msbs.at(iShot).start);
 		}
 
-		sumShots++;
+		statistics.sumShots++;
 
-		fs << videoFile.msbs.at(iShot).start;
-		fs << ",";
-		fs << videoFile.msbs.at(iShot).end;
-		fs << '\n';
+		index += std::to_string(msbs.at(iShot).start);
+		index += ",";
+		index += std::to_string(msbs.at(iShot).end);
+		index += '\n';
 	}
 
+	fs.write(index.data(), index.size());
 	fs.flush();
 }
 
-VideoFileList processMSBoundaries(File* _collection, Directory* _msbs)
+/**
+* \brief Reads the master shot boundaries of one video and writes its index file
+*/
+void convertVideoFile(const VideoFile& _videoFile, Directory* _msbs, Directory* _index, ShotStatistics& _statistics)
 {
-		std::ifstream is(_collection->getFile());
+	File videomsb(_videoFile.filename);
+	videomsb.setPath(_msbs->getPath());
+	videomsb.setFileExtension(".msb");
+
+	std::ifstream is(videomsb.getFile());
 	if (!is.is_open())
 	{
-		exit(EXIT_FAILURE);
+		LOG_ERROR("MSB File for video : " << _videoFile.filename << " cannot be found with: " << videomsb.getFile());
 	}
 
-	VideoFileList videolist = readCollection(is);
-	is.close();
-
-	int maxFiles = videolist.size();
-	for (int iFile = 0; iFile < maxFiles; iFile++)
+	//a video without msb file gets an empty index like before
+	MasterShotBoundaries shots;
+	if (is.is_open())
 	{
-		File videomsb(videolist.at(iFile).filename);
-		videomsb.setPath(_msbs->getPath());
-		videomsb.setFileExtension(".msb");
-
-		is.open(videomsb.getFile());
-		if (!is.is_open())
+		shots = readMSB(is);
+		if (shots.size() == 0)
 		{
-			LOG_ERROR("MSB File for video : " << videolist.at(iFile).filename << " cannot be found with: " << videomsb.getFile());
+			LOG_INFO(_videoFile.filename << "has no shots");
 		}
-		else
-		{
-			MasterShotBoundaries shots = readMSB(is);
-			if (shots.size() == 0)
-			{
-				LOG_INFO(videolist.at(iFile).filename << "has no shots");
-			}
+	}
+	is.close();
 
-			videolist.at(iFile).msbs = shots;
-		}
-		is.close();
+	File idxFile(std::to_string(_videoFile.id) + ".csv");
+	idxFile.setPath(_index->getPath());
 
-		cplusutil::Terminal::showProgress("Read MSB Files: ", iFile, maxFiles);
+	std::fstream fs(idxFile.getFile(), std::fstream::out);
+	if (!fs.is_open())
+	{
+		LOG_ERROR("Index File for video : " << _videoFile.filename << " cannot be created with: " << idxFile.getFile());
+		return;
 	}
-	return videolist;
+
+	writeIndex(fs, _videoFile, shots, _statistics);
+	fs.close();
+	_statistics.files++;
 }
 
-void processMSBIndex(VideoFileList& _videoFileList, Directory* _index)
+/**
+* \brief Streams the collection and converts its video files with a pool; at most FILES_PER_WORKER files
+* per worker are in flight, so the memory does not grow with the collection
+*/
+ShotStatistics processMSBoundaries(File* _collection, Directory* _msbs, Directory* _index)
 {
-	std::string idxFileName = "";
-	std::fstream fs;
-	File* idxFile;
-
-	int maxFiles = _videoFileList.size();
-	for (int iFile = 0; iFile < maxFiles; iFile++)
+	std::ifstream is(_collection->getFile(), std::ios::in | std::ios::binary);
+	if (!is.is_open())
 	{
-		idxFileName = std::to_string(_videoFileList.at(iFile).id) + ".csv";
-		idxFile = new File(idxFileName);
-		idxFile->setPath(_index->getPath());
+		exit(EXIT_FAILURE);
+	}
+
+	is.seekg(0, std::ios::end);
+	size_t size = size_t(is.tellg());
+	is.seekg(0, std::ios::beg);
 
-		fs.open(idxFile->getFile(), std::fstream::out);
+	vretbox::WorkStealingPool pool(threads);
+	std::vector<ShotStatistics> statistics(pool.size());
 
-		if (!fs.is_open())
+	boost::mutex mutex;
+	boost::condition_variable finished;
+	int inFlight = 0;
+	int limit = FILES_PER_WORKER * pool.size();
+
+	int files = readCollection(is, size, [&](const VideoFile& _videoFile)
+	{
 		{
-			LOG_ERROR("Index File for video : " << _videoFileList.at(iFile).filename << " cannot be created with: " << idxFile->getFile());
+			boost::mutex::scoped_lock lock(mutex);
+			while (inFlight >= limit)
+			{
+				finished.wait(lock);
+			}
+			inFlight++;
 		}
-		else
+
+		pool.submit([&, _videoFile](int _worker)
 		{
-			writeIndex(fs, _videoFileList.at(iFile));
-		}
+			convertVideoFile(_videoFile, _msbs, _index, statistics[_worker]);
 
-		cplusutil::Terminal::showProgress("Write Index File: ", iFile, maxFiles);
-		fs.close();
-		delete idxFile;
+			boost::mutex::scoped_lock lock(mutex);
+			inFlight--;
+			finished.notify_one();
+		});
+	});
+	pool.wait();
 
+	ShotStatistics total;
+	for (int iWorker = 0; iWorker < statistics.size(); iWorker++)
+	{
+		total.merge(statistics[iWorker]);
 	}
+
+	LOG_INFO("Converted " << total.files << " of " << files << " video files with " << pool.size() << " workers");
+	return total;
 }
 
 int main(int argc, char const *argv[]) {
@@ -310,12 +428,14 @@ int main(int argc, char const *argv[]) {
 	Directory* index = new Directory(outputDirectory);
 
 
-	VideoFileList videoFileList = processMSBoundaries(collection, msb);
-	processMSBIndex(videoFileList, index);
+	ShotStatistics statistics = processMSBoundaries(collection, msb, index);
+	const int* counts = statistics.counts;
+	int sumShots = statistics.sumShots;
 
 
 	delete collection;
 	delete msb;
+	delete index;
 	float mult = 100.0f / float(sumShots);
 
 	float lessThan30Frames = 0;
@@ -15,6 +15,11 @@ namespace trecvid {
 
 		int mSID;
 
+		/**
+		 * \brief encoded rows of the signature if the model is quantized, see SignatureStore::getCodes
+		 */
+		cv::Mat mCodes;
+
 		AVSFeatures() {};
 
 		AVSFeatures(int _vid, int _sid, int _qid = 0);
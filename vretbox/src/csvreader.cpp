@@ -0,0 +1,172 @@
+#include "csvreader.hpp"
+#include <cpluslogger.hpp>
+#include <boost/filesystem.hpp>
+#include <cstring>
+
+trecvid::CSVReader::CSVReader()
+	: mFile(nullptr), mRegion(nullptr), mPosition(nullptr), mEnd(nullptr), mLine(0)
+{
+}
+
+trecvid::CSVReader::~CSVReader()
+{
+	close();
+}
+
+bool trecvid::CSVReader::open(std::string _file)
+{
+	close();
+
+	boost::system::error_code error;
+	uintmax_t size = boost::filesystem::file_size(_file, error);
+	if (error)
+	{
+		LOG_ERROR("CSV file " << _file << " cannot be opened: " << error.message());
+		return false;
+	}
+
+	//an empty file cannot be mapped
+	if (size == 0)
+	{
+		return true;
+	}
+
+	try
+	{
+		mFile = new boost::interprocess::file_mapping(_file.c_str(), boost::interprocess::read_only);
+		mRegion = new boost::interprocess::mapped_region(*mFile, boost::interprocess::read_only);
+	}
+	catch (boost::interprocess::interprocess_exception& e)
+	{
+		LOG_ERROR("CSV file " << _file << " cannot be mapped. Exception: " << e.what());
+		close();
+		return false;
+	}
+
+	mRegion->advise(boost::interprocess::mapped_region::advice_sequential);
+	mPosition = static_cast<const char*>(mRegion->get_address());
+	mEnd = mPosition + mRegion->get_size();
+	return true;
+}
+
+void trecvid::CSVReader::close()
+{
+	delete mRegion;
+	mRegion = nullptr;
+
+	delete mFile;
+	mFile = nullptr;
+
+	mPosition = nullptr;
+	mEnd = nullptr;
+	mFields.clear();
+	mLine = 0;
+}
+
+bool trecvid::CSVReader::next()
+{
+	mFields.clear();
+
+	while (mPosition < mEnd)
+	{
+		const char* begin = mPosition;
+		const char* end = static_cast<const char*>(std::memchr(begin, '\n', mEnd - begin));
+		if (end == nullptr)
+		{
+			end = mEnd;
+		}
+		mPosition = end < mEnd ? end + 1 : mEnd;
+		mLine++;
+
+		if (end > begin && *(end - 1) == '\r')
+		{
+			end--;
+		}
+		if (end == begin)
+		{
+			continue;
+		}
+
+		const char* field = begin;
+		for (const char* iChar = begin; iChar <= end; iChar++)
+		{
+			if (iChar == end || *iChar == ',')
+			{
+				Field entry = { field, size_t(iChar - field) };
+				mFields.push_back(entry);
+				field = iChar + 1;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+int trecvid::CSVReader::size() const
+{
+	return int(mFields.size());
+}
+
+int trecvid::CSVReader::getLine() const
+{
+	return mLine;
+}
+
+const trecvid::CSVReader::Field& trecvid::CSVReader::getField(int _field) const
+{
+	return mFields[_field];
+}
+
+std::string trecvid::CSVReader::getString(int _field) const
+{
+	return std::string(mFields[_field].mBegin, mFields[_field].mLength);
+}
+
+bool trecvid::CSVReader::getInt(int _field, int& _value) const
+{
+	if (_field < 0 || _field >= size())
+	{
+		return false;
+	}
+
+	const char* iChar = mFields[_field].mBegin;
+	const char* end = iChar + mFields[_field].mLength;
+	while (iChar < end && (*iChar == ' ' || *iChar == '\t'))
+	{
+		iChar++;
+	}
+	while (end > iChar && (*(end - 1) == ' ' || *(end - 1) == '\t'))
+	{
+		end--;
+	}
+
+	bool isNegative = iChar < end && *iChar == '-';
+	if (iChar < end && (*iChar == '-' || *iChar == '+'))
+	{
+		iChar++;
+	}
+	if (iChar == end)
+	{
+		return false;
+	}
+
+	long long value = 0;
+	for (; iChar < end; iChar++)
+	{
+		if (*iChar < '0' || *iChar > '9' || value > 2147483648LL)
+		{
+			return false;
+		}
+		value = value * 10 + (*iChar - '0');
+	}
+
+	value = isNegative ? -value : value;
+	if (value < -2147483648LL || value > 2147483647LL)
+	{
+		return false;
+	}
+
+	_value = int(value);
+	return true;
+}
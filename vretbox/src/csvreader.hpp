@@ -0,0 +1,106 @@
+#ifndef _CSVREADER_HPP_
+#define  _CSVREADER_HPP_
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Reader of comma separated files without quoting.
+	* The file is mapped read-only and the rows are split in place, a field is a pointer into the mapping
+	* and its length, so that no line or field is copied. Empty lines are skipped, \r\n line endings are accepted.
+	*/
+	class CSVReader
+	{
+	public:
+
+		/**
+		 * \brief a field of the current row, not null terminated
+		 */
+		struct Field
+		{
+			const char* mBegin;
+
+			size_t mLength;
+		};
+
+	private:
+
+		boost::interprocess::file_mapping* mFile;
+
+		boost::interprocess::mapped_region* mRegion;
+
+		const char* mPosition;
+
+		const char* mEnd;
+
+		std::vector<Field> mFields;
+
+		int mLine;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		CSVReader();
+
+		/**
+		 * \brief Unmaps the file
+		 */
+		~CSVReader();
+
+		/**
+		 * \brief Maps a file, an empty file has no rows
+		 * \param _file
+		 * \return true if the file is mapped, otherwise false
+		 */
+		bool open(std::string _file);
+
+		/**
+		 * \brief Unmaps the file
+		 */
+		void close();
+
+		/**
+		 * \brief Splits the next row into its fields
+		 * \return false at the end of the file
+		 */
+		bool next();
+
+		/**
+		 * \brief
+		 * \return number of fields of the current row
+		 */
+		int size() const;
+
+		/**
+		 * \brief
+		 * \return line number of the current row, starting with 1
+		 */
+		int getLine() const;
+
+		const Field& getField(int _field) const;
+
+		/**
+		 * \brief
+		 * \param _field
+		 * \return copy of a field of the current row
+		 */
+		std::string getString(int _field) const;
+
+		/**
+		 * \brief Parses a decimal integer, blanks around the digits are ignored
+		 * \param _field
+		 * \param _value
+		 * \return false if the field is missing or is not an integer
+		 */
+		bool getInt(int _field, int& _value) const;
+	};
+}
+
+#endif //_CSVREADER_HPP_
@@ -0,0 +1,325 @@
+#include "distancematrix.hpp"
+#include "xtractioncache.hpp"
+#include <cplusutil.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+#include <fstream>
+#include <cstring>
+
+const char trecvid::DistanceMatrix::MAGIC[8] = { 'V', 'R', 'B', 'X', 'D', 'M', 'X', '\0' };
+
+trecvid::DistanceMatrix::DistanceMatrix()
+	: mFile(nullptr), mRegion(nullptr), mDistances(nullptr), mTimes(nullptr), mColumns(0)
+{
+}
+
+trecvid::DistanceMatrix::~DistanceMatrix()
+{
+	close();
+}
+
+bool trecvid::DistanceMatrix::compute(std::string _file, const std::string& _tag, uint64_t _modelHash, const std::vector<int>& _queries, int _columns,
+	bool _symmetric, int _tileColumns, vretbox::WorkStealingPool& _pool, const Loader& _load, const Distance& _distance)
+{
+	int rows = _queries.size();
+
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+	header.mVersion = VERSION;
+	header.mSymmetric = _symmetric ? 1 : 0;
+	header.mRows = rows;
+	header.mColumns = _columns;
+	header.mModelHash = _modelHash;
+	header.mTagLength = _tag.size();
+	header.mTagOffset = sizeof(Header);
+	header.mQueryOffset = ((header.mTagOffset + header.mTagLength + sizeof(int32_t) - 1) / sizeof(int32_t)) * sizeof(int32_t);
+	header.mTimeOffset = ((header.mQueryOffset + rows * sizeof(int32_t) + sizeof(double) - 1) / sizeof(double)) * sizeof(double);
+	header.mPayloadOffset = ((header.mTimeOffset + rows * sizeof(double) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+	header.mFileSize = header.mPayloadOffset + header.mRows * header.mColumns * sizeof(float);
+
+	{
+		std::ofstream out(_file, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			LOG_ERROR("Distance matrix " << _file << " cannot be created");
+			return false;
+		}
+
+		//the magic is written after the last distance, so an interrupted computation leaves an invalid file
+		Header pending = header;
+		std::memset(pending.mMagic, 0, sizeof(MAGIC));
+
+		std::vector<int32_t> queries(_queries.begin(), _queries.end());
+		out.write(reinterpret_cast<const char*>(&pending), sizeof(Header));
+		out.write(_tag.data(), _tag.size());
+		std::vector<char> padding(header.mQueryOffset - header.mTagOffset - header.mTagLength, 0);
+		if (!padding.empty())
+		{
+			out.write(padding.data(), padding.size());
+		}
+		if (rows > 0)
+		{
+			out.write(reinterpret_cast<const char*>(queries.data()), rows * sizeof(int32_t));
+		}
+
+		out.close();
+		if (out.fail())
+		{
+			LOG_ERROR("Distance matrix " << _file << " cannot be written");
+			return false;
+		}
+	}
+
+	//the payload is written through a mapping, so the matrix does not have to fit into memory
+	boost::system::error_code error;
+	boost::filesystem::resize_file(_file, header.mFileSize, error);
+	if (error)
+	{
+		LOG_ERROR("Distance matrix " << _file << " cannot be resized: " << error.message());
+		return false;
+	}
+
+	boost::interprocess::file_mapping* file = nullptr;
+	boost::interprocess::mapped_region* region = nullptr;
+	try
+	{
+		file = new boost::interprocess::file_mapping(_file.c_str(), boost::interprocess::read_write);
+		region = new boost::interprocess::mapped_region(*file, boost::interprocess::read_write);
+	}
+	catch (boost::interprocess::interprocess_exception& e)
+	{
+		LOG_ERROR("Distance matrix " << _file << " cannot be mapped. Exception: " << e.what());
+		delete region;
+		delete file;
+		return false;
+	}
+
+	char* data = static_cast<char*>(region->get_address());
+	float* distances = reinterpret_cast<float*>(data + header.mPayloadOffset);
+
+	std::vector<int> rowOfElement(_columns, -1);
+	for (int iRow = 0; iRow < rows; iRow++)
+	{
+		rowOfElement[_queries[iRow]] = iRow;
+	}
+
+	std::vector<double> times(rows, 0.0);
+	std::vector<int> counts(rows, 0);
+	boost::mutex timesMutex;
+	double tickFrequency = double(cv::getTickFrequency());
+
+	int tileColumns = std::max(1, _tileColumns);
+	for (int iRowBegin = 0; iRowBegin < rows; iRowBegin += TILE_ROWS)
+	{
+		for (int iColumnBegin = 0; iColumnBegin < _columns; iColumnBegin += tileColumns)
+		{
+			int rowEnd = std::min(iRowBegin + TILE_ROWS, rows);
+			int columnEnd = std::min(iColumnBegin + tileColumns, _columns);
+
+			_pool.submit([&, iRowBegin, rowEnd, iColumnBegin, columnEnd](int _worker)
+			{
+				double tileTimes[TILE_ROWS] = { 0.0 };
+				int tileCounts[TILE_ROWS] = { 0 };
+
+				for (int iRow = iRowBegin; iRow < rowEnd; iRow++)
+				{
+					_load(_worker, iRow - iRowBegin, _queries[iRow]);
+				}
+
+				//an element is loaded once and compared with all queries of the tile before the next element is loaded
+				for (int iElem = iColumnBegin; iElem < columnEnd; iElem++)
+				{
+					int elementRow = rowOfElement[iElem];
+					bool isLoaded = false;
+
+					for (int iRow = iRowBegin; iRow < rowEnd; iRow++)
+					{
+						//the distance of two queries is computed by the row of the first one
+						if (_symmetric && elementRow >= 0 && elementRow < iRow)
+						{
+							continue;
+						}
+
+						if (!isLoaded)
+						{
+							_load(_worker, ELEMENT_SLOT, iElem);
+							isLoaded = true;
+						}
+
+						//the time excludes the loading, as the time of a distance computed during the evaluation
+						double start = double(cv::getTickCount());
+						float distance = _distance(_worker, iRow - iRowBegin, _queries[iRow], iElem);
+						tileTimes[iRow - iRowBegin] += (double(cv::getTickCount()) - start) / tickFrequency;
+						tileCounts[iRow - iRowBegin]++;
+
+						distances[uint64_t(iRow) * _columns + iElem] = distance;
+						if (_symmetric && elementRow > iRow)
+						{
+							distances[uint64_t(elementRow) * _columns + _queries[iRow]] = distance;
+						}
+					}
+				}
+
+				boost::mutex::scoped_lock lock(timesMutex);
+				for (int iRow = iRowBegin; iRow < rowEnd; iRow++)
+				{
+					times[iRow] += tileTimes[iRow - iRowBegin];
+					counts[iRow] += tileCounts[iRow - iRowBegin];
+				}
+			});
+		}
+	}
+	_pool.wait();
+
+	//the mirrored distances of a symmetric matrix took the time of the computed ones
+	for (int iRow = 0; iRow < rows; iRow++)
+	{
+		times[iRow] = counts[iRow] > 0 ? times[iRow] / counts[iRow] : 0.0;
+	}
+
+	if (rows > 0)
+	{
+		std::memcpy(data + header.mTimeOffset, times.data(), rows * sizeof(double));
+	}
+	std::memcpy(data, MAGIC, sizeof(MAGIC));
+
+	bool isFlushed = region->flush();
+	delete region;
+	delete file;
+
+	if (!isFlushed)
+	{
+		LOG_ERROR("Distance matrix " << _file << " cannot be flushed");
+		return false;
+	}
+
+	return true;
+}
+
+bool trecvid::DistanceMatrix::open(std::string _file, const std::string& _tag, uint64_t _modelHash, int _columns)
+{
+	close();
+
+	if (!boost::filesystem::is_regular_file(_file))
+	{
+		return false;
+	}
+
+	try
+	{
+		mFile = new boost::interprocess::file_mapping(_file.c_str(), boost::interprocess::read_only);
+		mRegion = new boost::interprocess::mapped_region(*mFile, boost::interprocess::read_only);
+	}
+	catch (boost::interprocess::interprocess_exception& e)
+	{
+		LOG_ERROR("Distance matrix " << _file << " cannot be mapped. Exception: " << e.what());
+		close();
+		return false;
+	}
+
+	const char* data = static_cast<const char*>(mRegion->get_address());
+	uint64_t size = mRegion->get_size();
+
+	Header header;
+	if (size < sizeof(Header))
+	{
+		LOG_ERROR("Distance matrix " << _file << " is too small");
+		close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(Header));
+
+	if (std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) != 0 || header.mVersion != VERSION)
+	{
+		LOG_ERROR("File " << _file << " is not a distance matrix of version " << VERSION);
+		close();
+		return false;
+	}
+
+	if (header.mFileSize != size || header.mPayloadOffset % ALIGNMENT != 0
+		|| header.mQueryOffset % sizeof(int32_t) != 0 || header.mTimeOffset % sizeof(double) != 0
+		|| header.mTagOffset + header.mTagLength > header.mQueryOffset
+		|| header.mQueryOffset + header.mRows * sizeof(int32_t) > header.mTimeOffset
+		|| header.mTimeOffset + header.mRows * sizeof(double) > header.mPayloadOffset
+		|| header.mPayloadOffset + header.mRows * header.mColumns * sizeof(float) > size)
+	{
+		LOG_ERROR("Distance matrix " << _file << " is truncated or corrupted");
+		close();
+		return false;
+	}
+
+	//a matrix of other features, distance parameters or model order is stale
+	if (header.mColumns != uint64_t(_columns) || header.mModelHash != _modelHash
+		|| std::string(data + header.mTagOffset, header.mTagLength) != _tag)
+	{
+		LOG_INFO("Distance matrix " << _file << " does not belong to this model and distance");
+		close();
+		return false;
+	}
+
+	const int32_t* queries = reinterpret_cast<const int32_t*>(data + header.mQueryOffset);
+	mRows.assign(_columns, -1);
+	for (uint64_t iRow = 0; iRow < header.mRows; iRow++)
+	{
+		if (queries[iRow] < 0 || queries[iRow] >= _columns)
+		{
+			LOG_ERROR("Distance matrix " << _file << " has an invalid query " << iRow);
+			close();
+			return false;
+		}
+		mRows[queries[iRow]] = int(iRow);
+	}
+
+	mColumns = header.mColumns;
+	mTimes = reinterpret_cast<const double*>(data + header.mTimeOffset);
+	mDistances = reinterpret_cast<const float*>(data + header.mPayloadOffset);
+
+	return true;
+}
+
+void trecvid::DistanceMatrix::close()
+{
+	delete mRegion;
+	mRegion = nullptr;
+
+	delete mFile;
+	mFile = nullptr;
+
+	mDistances = nullptr;
+	mTimes = nullptr;
+	mColumns = 0;
+	mRows.clear();
+}
+
+bool trecvid::DistanceMatrix::isOpen() const
+{
+	return mDistances != nullptr;
+}
+
+int trecvid::DistanceMatrix::getRow(int _element) const
+{
+	return _element < mRows.size() ? mRows[_element] : -1;
+}
+
+float trecvid::DistanceMatrix::get(int _row, int _element) const
+{
+	return mDistances[uint64_t(_row) * mColumns + _element];
+}
+
+double trecvid::DistanceMatrix::getTime(int _row) const
+{
+	return mTimes[_row];
+}
+
+uint64_t trecvid::DistanceMatrix::hashModel(const SignatureStore& _store)
+{
+	uint64_t hash = XtractionCache::hash(nullptr, 0);
+	for (int iElem = 0; iElem < _store.size(); iElem++)
+	{
+		int32_t ids[3] = { _store.getVID(iElem), _store.getSID(iElem), _store.getRows(iElem) };
+		hash = XtractionCache::hash(reinterpret_cast<const char*>(ids), sizeof(ids), hash);
+		hash = XtractionCache::hash(reinterpret_cast<const char*>(_store.getCodeData(iElem)), _store.getRows(iElem) * _store.getRowSize(), hash);
+	}
+	return hash;
+}
@@ -0,0 +1,164 @@
+#ifndef _DISTANCEMATRIX_HPP_
+#define  _DISTANCEMATRIX_HPP_
+
+#include "signaturestore.hpp"
+#include "workstealingpool.hpp"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <functional>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Persistent query-by-model distance matrix of an evaluation.
+	* Layout: Header | tag | query indices | mean computation time of a distance per query | padding | float distances (64 byte aligned).
+	* The tag describes the feature set and the distance parameters, the model hash the order of the model;
+	* a matrix is only used if both match. Row i holds the distances of query i to all model elements.
+	*/
+	class DistanceMatrix
+	{
+	public:
+
+		static const char MAGIC[8];
+
+		static const uint32_t VERSION = 1;
+
+		static const uint64_t ALIGNMENT = 64;
+
+		/**
+		 * \brief number of queries of a tile, their signatures are loaded once and stay in the cache while the tile columns are scanned
+		 */
+		static const int TILE_ROWS = 16;
+
+		/**
+		 * \brief slot of the element that is compared with the queries of a tile, the queries have the slots 0 to TILE_ROWS - 1
+		 */
+		static const int ELEMENT_SLOT = TILE_ROWS;
+
+		struct Header
+		{
+			char mMagic[8];
+			uint32_t mVersion;
+			uint32_t mSymmetric;
+			uint64_t mRows;
+			uint64_t mColumns;
+			uint64_t mModelHash;
+			uint64_t mTagLength;
+			uint64_t mTagOffset;
+			uint64_t mQueryOffset;
+			uint64_t mTimeOffset;
+			uint64_t mPayloadOffset;
+			uint64_t mFileSize;
+		};
+
+		/**
+		 * \brief Loads the signature of a model element into a slot of a worker: Loader(worker, slot, element).
+		 * A worker computes one tile at a time, so its TILE_ROWS + 1 slots are not shared.
+		 */
+		typedef std::function<void(int, int, int)> Loader;
+
+		/**
+		 * \brief Distance of the query in a slot to the element in ELEMENT_SLOT of a worker: Distance(worker, slot, query, element),
+		 * query and element are the model indices of the loaded signatures
+		 */
+		typedef std::function<float(int, int, int, int)> Distance;
+
+	private:
+
+		boost::interprocess::file_mapping* mFile;
+
+		boost::interprocess::mapped_region* mRegion;
+
+		const float* mDistances;
+
+		const double* mTimes;
+
+		uint64_t mColumns;
+
+		/**
+		 * \brief row of each model element, -1 if it is not a query
+		 */
+		std::vector<int> mRows;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		DistanceMatrix();
+
+		/**
+		 * \brief Unmaps the file
+		 */
+		~DistanceMatrix();
+
+		/**
+		 * \brief Computes the matrix tile by tile with the pool and writes it to a file. The queries of a tile are loaded
+		 * once per tile, each element once per tile and compared with all its queries.
+		 * If the distance is symmetric, the distance of two queries is computed once and mirrored.
+		 * \param _file output file
+		 * \param _tag feature set and distance parameters
+		 * \param _modelHash see hashModel
+		 * \param _queries model indices of the queries, one row each
+		 * \param _columns size of the model
+		 * \param _symmetric true if distance(a, b) == distance(b, a)
+		 * \param _tileColumns number of model elements of a tile
+		 * \param _pool
+		 * \param _load
+		 * \param _distance
+		 * \return true if the file was written, otherwise false
+		 */
+		static bool compute(std::string _file, const std::string& _tag, uint64_t _modelHash, const std::vector<int>& _queries, int _columns,
+			bool _symmetric, int _tileColumns, vretbox::WorkStealingPool& _pool, const Loader& _load, const Distance& _distance);
+
+		/**
+		 * \brief Maps a matrix file read-only
+		 * \param _file matrix file
+		 * \param _tag expected feature set and distance parameters
+		 * \param _modelHash expected order of the model
+		 * \param _columns expected size of the model
+		 * \return true if the file is a valid matrix of the model, otherwise false
+		 */
+		bool open(std::string _file, const std::string& _tag, uint64_t _modelHash, int _columns);
+
+		/**
+		 * \brief Unmaps the file
+		 */
+		void close();
+
+		bool isOpen() const;
+
+		/**
+		 * \brief
+		 * \param _element model index
+		 * \return the row of a query or -1 if the element is not a query of the matrix
+		 */
+		int getRow(int _element) const;
+
+		/**
+		 * \brief
+		 * \param _row row of a query
+		 * \param _element model index
+		 * \return
+		 */
+		float get(int _row, int _element) const;
+
+		/**
+		 * \brief
+		 * \param _row row of a query
+		 * \return mean time in seconds of one computed distance of the row
+		 */
+		double getTime(int _row) const;
+
+		/**
+		 * \brief Hash of the ids and signatures of all model elements in their order; the signatures are hashed
+		 * as stored, so a quantized model has another hash than its float model
+		 * \param _store
+		 * \return
+		 */
+		static uint64_t hashModel(const SignatureStore& _store);
+	};
+}
+
+#endif //_DISTANCEMATRIX_HPP_
@@ -0,0 +1,242 @@
+#include "featurecollection.hpp"
+#include <cplusutil.hpp>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+
+const char trecvid::FeatureCollection::MAGIC[8] = { 'V', 'R', 'B', 'X', 'C', 'O', 'L', '\0' };
+
+trecvid::FeatureCollection::FeatureCollection()
+	: mFile(nullptr), mRegion(nullptr)
+{
+}
+
+trecvid::FeatureCollection::~FeatureCollection()
+{
+	close();
+}
+
+bool trecvid::FeatureCollection::write(const SignatureStore& _store, std::string _file)
+{
+	int signatures = _store.size();
+
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+	header.mVersion = VERSION;
+	header.mDimension = _store.getDimension();
+	header.mSignatures = signatures;
+	header.mRows = _store.getRowCount();
+	header.mEncoding = _store.getQuantizer().getEncoding();
+	header.mEntryOffset = sizeof(Header);
+	header.mNameOffset = header.mEntryOffset + signatures * sizeof(Entry);
+
+	std::vector<Entry> entries(signatures);
+	uint64_t rowOffset = 0;
+	uint64_t nameOffset = 0;
+	for (int iSignature = 0; iSignature < signatures; iSignature++)
+	{
+		Entry& entry = entries[iSignature];
+		std::memset(&entry, 0, sizeof(Entry));
+		entry.mVID = _store.getVID(iSignature);
+		entry.mSID = _store.getSID(iSignature);
+		entry.mRows = _store.getRows(iSignature);
+		entry.mNameLength = _store.getFilename(iSignature).size();
+		entry.mRowOffset = rowOffset;
+		entry.mNameOffset = nameOffset;
+
+		rowOffset += entry.mRows;
+		nameOffset += entry.mNameLength;
+	}
+
+	//the minima and scales of the columns of an int8 collection
+	std::vector<float> quantization(_store.getQuantizer().getMinima());
+	quantization.insert(quantization.end(), _store.getQuantizer().getScales().begin(), _store.getQuantizer().getScales().end());
+
+	header.mQuantizationOffset = ((header.mNameOffset + nameOffset + sizeof(float) - 1) / sizeof(float)) * sizeof(float);
+	uint64_t quantizationEnd = header.mQuantizationOffset + quantization.size() * sizeof(float);
+	header.mPayloadOffset = ((quantizationEnd + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+	header.mFileSize = header.mPayloadOffset + header.mRows * _store.getRowSize();
+
+	std::ofstream out(_file, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		LOG_ERROR("Collection file " << _file << " cannot be created");
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	if (signatures > 0)
+	{
+		out.write(reinterpret_cast<const char*>(entries.data()), signatures * sizeof(Entry));
+	}
+
+	for (int iSignature = 0; iSignature < signatures; iSignature++)
+	{
+		const std::string& name = _store.getFilename(iSignature);
+		out.write(name.data(), name.size());
+	}
+
+	std::vector<char> padding(header.mQuantizationOffset - (header.mNameOffset + nameOffset), 0);
+	if (!padding.empty())
+	{
+		out.write(padding.data(), padding.size());
+	}
+	if (!quantization.empty())
+	{
+		out.write(reinterpret_cast<const char*>(quantization.data()), quantization.size() * sizeof(float));
+	}
+
+	padding.assign(header.mPayloadOffset - quantizationEnd, 0);
+	if (!padding.empty())
+	{
+		out.write(padding.data(), padding.size());
+	}
+
+	for (int iSignature = 0; iSignature < signatures; iSignature++)
+	{
+		out.write(reinterpret_cast<const char*>(_store.getCodeData(iSignature)), _store.getRows(iSignature) * _store.getRowSize());
+	}
+
+	out.close();
+	if (out.fail())
+	{
+		LOG_ERROR("Collection file " << _file << " cannot be written");
+		return false;
+	}
+
+	return true;
+}
+
+bool trecvid::FeatureCollection::open(std::string _file, SignatureStore& _store)
+{
+	close();
+
+	try
+	{
+		mFile = new boost::interprocess::file_mapping(_file.c_str(), boost::interprocess::read_only);
+		mRegion = new boost::interprocess::mapped_region(*mFile, boost::interprocess::read_only);
+	}
+	catch (boost::interprocess::interprocess_exception& e)
+	{
+		LOG_ERROR("Collection file " << _file << " cannot be mapped. Exception: " << e.what());
+		close();
+		return false;
+	}
+
+	const char* data = static_cast<const char*>(mRegion->get_address());
+	uint64_t size = mRegion->get_size();
+
+	if (size < offsetof(Header, mEncoding))
+	{
+		LOG_ERROR("Collection file " << _file << " is too small");
+		close();
+		return false;
+	}
+
+	//the header of version 1 ends before the encoding, its rows are floats
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(&header, data, offsetof(Header, mEncoding));
+
+	if (std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		LOG_ERROR("File " << _file << " is not a collection file");
+		close();
+		return false;
+	}
+
+	if (header.mVersion == 0 || header.mVersion > VERSION)
+	{
+		LOG_ERROR("Collection file " << _file << " has version " << header.mVersion << ", supported are versions 1 to " << VERSION);
+		close();
+		return false;
+	}
+
+	if (header.mVersion >= 2)
+	{
+		if (size < sizeof(Header))
+		{
+			LOG_ERROR("Collection file " << _file << " is too small");
+			close();
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(Header));
+	}
+
+	Quantizer quantizer;
+	if (header.mEncoding != Quantizer::FLOAT32 && header.mEncoding != Quantizer::FLOAT16 && header.mEncoding != Quantizer::INT8)
+	{
+		LOG_ERROR("Collection file " << _file << " has an unknown encoding " << header.mEncoding);
+		close();
+		return false;
+	}
+	quantizer.setParameters(Quantizer::Encoding(header.mEncoding), header.mDimension, std::vector<float>(), std::vector<float>());
+	uint64_t quantizationSize = header.mEncoding == Quantizer::INT8 ? 2 * header.mDimension * sizeof(float) : 0;
+
+	if (header.mFileSize != size || header.mPayloadOffset % ALIGNMENT != 0
+		|| header.mEntryOffset + header.mSignatures * sizeof(Entry) > header.mNameOffset
+		|| (quantizationSize > 0 && (header.mQuantizationOffset % sizeof(float) != 0
+			|| header.mQuantizationOffset < header.mNameOffset
+			|| header.mQuantizationOffset + quantizationSize > header.mPayloadOffset))
+		|| header.mPayloadOffset + header.mRows * header.mDimension * quantizer.getValueSize() > size)
+	{
+		LOG_ERROR("Collection file " << _file << " is truncated or corrupted");
+		close();
+		return false;
+	}
+
+	const Entry* entries = reinterpret_cast<const Entry*>(data + header.mEntryOffset);
+	const char* names = data + header.mNameOffset;
+
+	int signatures = header.mSignatures;
+	std::vector<size_t> offsets(signatures + 1, 0);
+	std::vector<int> vids(signatures), sids(signatures);
+	std::vector<std::string> filenames(signatures);
+
+	for (int iSignature = 0; iSignature < signatures; iSignature++)
+	{
+		const Entry& entry = entries[iSignature];
+
+		if (entry.mRowOffset != offsets[iSignature]
+			|| header.mNameOffset + entry.mNameOffset + entry.mNameLength > header.mPayloadOffset)
+		{
+			LOG_ERROR("Collection file " << _file << " has an invalid entry " << iSignature);
+			close();
+			return false;
+		}
+
+		offsets[iSignature + 1] = entry.mRowOffset + entry.mRows;
+		vids[iSignature] = entry.mVID;
+		sids[iSignature] = entry.mSID;
+		filenames[iSignature].assign(names + entry.mNameOffset, entry.mNameLength);
+	}
+
+	if (offsets[signatures] != header.mRows)
+	{
+		LOG_ERROR("Collection file " << _file << " has an invalid number of rows");
+		close();
+		return false;
+	}
+
+	if (quantizationSize > 0)
+	{
+		const float* quantization = reinterpret_cast<const float*>(data + header.mQuantizationOffset);
+		quantizer.setParameters(Quantizer::INT8, header.mDimension,
+			std::vector<float>(quantization, quantization + header.mDimension),
+			std::vector<float>(quantization + header.mDimension, quantization + 2 * header.mDimension));
+	}
+
+	_store.attach(data + header.mPayloadOffset, quantizer, offsets, vids, sids, filenames);
+
+	return true;
+}
+
+void trecvid::FeatureCollection::close()
+{
+	delete mRegion;
+	mRegion = nullptr;
+
+	delete mFile;
+	mFile = nullptr;
+}
@@ -0,0 +1,97 @@
+#ifndef _FEATURECOLLECTION_HPP_
+#define  _FEATURECOLLECTION_HPP_
+
+#include "signaturestore.hpp"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Collection file of a feature directory.
+	* Layout: Header | Entry per signature | filenames | quantization | padding | payload (64 byte aligned).
+	* All signatures share the number of columns; their rows are stored one after the other in the payload,
+	* encoded as in the store that was written (see Quantizer). The quantization holds the minima and the scales
+	* of the columns of an INT8 collection. Files of version 1 have no encoding and hold float rows.
+	* The loader maps the file read-only and attaches a SignatureStore directly to the mapped payload.
+	*/
+	class FeatureCollection
+	{
+	public:
+
+		static const char MAGIC[8];
+
+		static const uint32_t VERSION = 2;
+
+		static const uint64_t ALIGNMENT = 64;
+
+		struct Header
+		{
+			char mMagic[8];
+			uint32_t mVersion;
+			uint32_t mDimension;
+			uint64_t mSignatures;
+			uint64_t mRows;
+			uint64_t mEntryOffset;
+			uint64_t mNameOffset;
+			uint64_t mPayloadOffset;
+			uint64_t mFileSize;
+			//version 2
+			uint32_t mEncoding;
+			uint32_t mReserved;
+			uint64_t mQuantizationOffset;
+		};
+
+		struct Entry
+		{
+			int32_t mVID;
+			int32_t mSID;
+			uint32_t mRows;
+			uint32_t mNameLength;
+			uint64_t mRowOffset;
+			uint64_t mNameOffset;
+		};
+
+	private:
+
+		boost::interprocess::file_mapping* mFile;
+
+		boost::interprocess::mapped_region* mRegion;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		FeatureCollection();
+
+		/**
+		 * \brief Unmaps the file; stores attached to the collection are invalid afterwards
+		 */
+		~FeatureCollection();
+
+		/**
+		 * \brief Writes all signatures of a store into a collection file in the encoding of the store
+		 * \param _store
+		 * \param _file output file
+		 * \return true if the file was written, otherwise false
+		 */
+		static bool write(const SignatureStore& _store, std::string _file);
+
+		/**
+		 * \brief Maps a collection file and attaches the store to its payload without copying it
+		 * \param _file collection file
+		 * \param _store
+		 * \return true if the file is a valid collection, otherwise false
+		 */
+		bool open(std::string _file, SignatureStore& _store);
+
+		/**
+		 * \brief Unmaps the file
+		 */
+		void close();
+	};
+}
+
+#endif //_FEATURECOLLECTION_HPP_
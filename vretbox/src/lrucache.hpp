@@ -0,0 +1,129 @@
+#ifndef _LRUCACHE_HPP_
+#define  _LRUCACHE_HPP_
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace vretbox {
+
+	/**
+	* \brief Bounded cache that evicts the least recently used entry.
+	* The entries are kept in a list ordered by their last use (most recent first),
+	* the map points from a key to its list entry. Not thread-safe.
+	*/
+	template<class Key, class Value>
+	class LRUCache
+	{
+		typedef std::list<std::pair<Key, Value>> Entries;
+
+		/**
+		 * \brief maximal number of entries, 0 = caching is disabled
+		 */
+		size_t mCapacity;
+
+		Entries mEntries;
+
+		std::unordered_map<Key, typename Entries::iterator> mIndex;
+
+		size_t mHits;
+
+		size_t mMisses;
+
+	public:
+
+		/**
+		 * \brief
+		 * \param _capacity maximal number of entries, 0 = caching is disabled
+		 */
+		explicit LRUCache(size_t _capacity = 0) : mCapacity(_capacity), mHits(0), mMisses(0) {}
+
+		/**
+		 * \brief Looks up a key and marks its entry as most recently used
+		 * \param _key
+		 * \param _value the cached value if the key is found
+		 * \return true if the key is found, otherwise false
+		 */
+		bool get(const Key& _key, Value& _value)
+		{
+			typename std::unordered_map<Key, typename Entries::iterator>::iterator entry = mIndex.find(_key);
+			if (entry == mIndex.end())
+			{
+				mMisses++;
+				return false;
+			}
+
+			mEntries.splice(mEntries.begin(), mEntries, entry->second);
+			_value = entry->second->second;
+			mHits++;
+			return true;
+		}
+
+		/**
+		 * \brief Adds or replaces an entry; the least recently used entry is evicted if the cache is full
+		 * \param _key
+		 * \param _value
+		 */
+		void put(const Key& _key, const Value& _value)
+		{
+			if (mCapacity == 0)
+			{
+				return;
+			}
+
+			typename std::unordered_map<Key, typename Entries::iterator>::iterator entry = mIndex.find(_key);
+			if (entry != mIndex.end())
+			{
+				entry->second->second = _value;
+				mEntries.splice(mEntries.begin(), mEntries, entry->second);
+				return;
+			}
+
+			if (mEntries.size() == mCapacity)
+			{
+				mIndex.erase(mEntries.back().first);
+				mEntries.pop_back();
+			}
+
+			mEntries.push_front(std::make_pair(_key, _value));
+			mIndex[_key] = mEntries.begin();
+		}
+
+		/**
+		 * \brief Changes the maximal number of entries and removes all entries
+		 * \param _capacity maximal number of entries, 0 = caching is disabled
+		 */
+		void setCapacity(size_t _capacity)
+		{
+			clear();
+			mCapacity = _capacity;
+		}
+
+		/**
+		 * \brief Removes all entries
+		 */
+		void clear()
+		{
+			mEntries.clear();
+			mIndex.clear();
+		}
+
+		size_t size() const
+		{
+			return mEntries.size();
+		}
+
+		size_t getHits() const
+		{
+			return mHits;
+		}
+
+		size_t getMisses() const
+		{
+			return mMisses;
+		}
+	};
+}
+
+#endif //_LRUCACHE_HPP_
@@ -1,9 +1,32 @@
 #include "mastershot.hpp"
+#include <cstdlib>
 
 trecvid::MasterShot::MasterShot(File* _file)
 	: VideoBase(_file), mVid(0), mSid(0), mStart(0), mEnd(0), mFps(0), mWidth(0), mHeight(0)
 {
 	mVideoFileName = _file->getFilename() + _file->getFileExtension();
+
+	//master shot files are named <vid>_<sid>_<start>-<end>_<fps>_<width>x<height>
+	std::vector<std::string> strings = cplusutil::String::split(_file->getFilename().c_str(), '_');
+	if (strings.size() == 5)
+	{
+		std::vector<std::string> range = cplusutil::String::split(strings.at(2).c_str(), '-');
+		std::vector<std::string> size = cplusutil::String::split(strings.at(4).c_str(), 'x');
+
+		mVid = cplusutil::String::extractIntFromString(strings.at(0));
+		mSid = cplusutil::String::extractIntFromString(strings.at(1));
+		if (range.size() == 2)
+		{
+			mStart = std::atoi(range.at(0).c_str());
+			mEnd = std::atoi(range.at(1).c_str());
+		}
+		mFps = float(std::atof(strings.at(3).c_str()));
+		if (size.size() == 2)
+		{
+			mWidth = std::atoi(size.at(0).c_str());
+			mHeight = std::atoi(size.at(1).c_str());
+		}
+	}
 }
 
 trecvid::MasterShot::MasterShot(int _vid, int _sid, int _start, int _end, float _fps, int _width, int _height)
@@ -0,0 +1,364 @@
+#include "pivotindex.hpp"
+#include <cpluslogger.hpp>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+const char trecvid::PivotIndex::MAGIC[8] = { 'V', 'R', 'B', 'X', 'P', 'V', 'T', '\0' };
+
+const float trecvid::PivotIndex::TOLERANCE = 1e-3f;
+
+double trecvid::PivotIndex::Statistics::getAvoidedFraction() const
+{
+	return mComputed + mAvoided > 0 ? double(mAvoided) / double(mComputed + mAvoided) : 0.0;
+}
+
+trecvid::PivotIndex::PivotIndex()
+	: mModel(nullptr), mDistance(nullptr)
+{
+}
+
+void trecvid::PivotIndex::build(const SignatureStore& _model, const SQFDistance& _distance, int _pivots, vretbox::WorkStealingPool& _pool)
+{
+	mModel = &_model;
+	mDistance = &_distance;
+
+	int elements = _model.size();
+	int pivots = std::max(0, std::min(_pivots, elements));
+	int batchSize = std::max(64, elements / (4 * std::max(1, _pool.size())));
+
+	mPivots.clear();
+	mSelfSimilarities.assign(elements, 0);
+	mNorms.assign(elements, 0);
+	mTable.assign(uint64_t(elements) * pivots, 0);
+
+	//the stored rows are read in place, an element of a quantized model is not decoded
+	for (int iBegin = 0; iBegin < elements; iBegin += batchSize)
+	{
+		int end = std::min(iBegin + batchSize, elements);
+		_pool.submit([this, iBegin, end](int)
+		{
+			for (int iElem = iBegin; iElem < end; iElem++)
+			{
+				float selfSimilarity = mDistance->computeSelfSimilarity(mModel->getQuantizer(), mModel->getCodes(iElem));
+				mSelfSimilarities[iElem] = selfSimilarity;
+				mNorms[iElem] = selfSimilarity > 0 ? std::sqrt(selfSimilarity) : 0;
+			}
+		});
+	}
+	_pool.wait();
+
+	//sum of the distances to the selected pivots, -1 marks a pivot
+	std::vector<double> sums(elements, 0.0);
+	int pivot = 0;
+
+	for (int iPivot = 0; iPivot < pivots; iPivot++)
+	{
+		mPivots.push_back(pivot);
+		sums[pivot] = -1.0;
+
+		cv::Mat codes = _model.getCodes(pivot);
+		float selfSimilarity = mSelfSimilarities[pivot];
+		for (int iBegin = 0; iBegin < elements; iBegin += batchSize)
+		{
+			int end = std::min(iBegin + batchSize, elements);
+			_pool.submit([this, &codes, selfSimilarity, iPivot, pivots, iBegin, end](int)
+			{
+				for (int iElem = iBegin; iElem < end; iElem++)
+				{
+					mTable[uint64_t(iElem) * pivots + iPivot] = computeDistance(codes, selfSimilarity, iElem);
+				}
+			});
+		}
+		_pool.wait();
+
+		//the next pivot is the element farthest from all selected ones
+		double farthest = -1.0;
+		for (int iElem = 0; iElem < elements; iElem++)
+		{
+			if (sums[iElem] < 0)
+			{
+				continue;
+			}
+
+			sums[iElem] += mTable[uint64_t(iElem) * pivots + iPivot];
+			if (sums[iElem] > farthest)
+			{
+				farthest = sums[iElem];
+				pivot = iElem;
+			}
+		}
+	}
+}
+
+bool trecvid::PivotIndex::save(std::string _file, const std::string& _tag, uint64_t _modelHash) const
+{
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+	header.mVersion = VERSION;
+	header.mPivots = mPivots.size();
+	header.mElements = mNorms.size();
+	header.mModelHash = _modelHash;
+	header.mTagLength = _tag.size();
+
+	std::ofstream out(_file, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		LOG_ERROR("Pivot index " << _file << " cannot be created");
+		return false;
+	}
+
+	std::vector<int32_t> pivots(mPivots.begin(), mPivots.end());
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	out.write(_tag.data(), _tag.size());
+	out.write(reinterpret_cast<const char*>(pivots.data()), pivots.size() * sizeof(int32_t));
+	out.write(reinterpret_cast<const char*>(mSelfSimilarities.data()), mSelfSimilarities.size() * sizeof(float));
+	out.write(reinterpret_cast<const char*>(mTable.data()), mTable.size() * sizeof(float));
+
+	out.close();
+	if (out.fail())
+	{
+		LOG_ERROR("Pivot index " << _file << " cannot be written");
+		return false;
+	}
+
+	return true;
+}
+
+bool trecvid::PivotIndex::load(std::string _file, const std::string& _tag, uint64_t _modelHash, const SignatureStore& _model, const SQFDistance& _distance)
+{
+	std::ifstream in(_file, std::ios::in | std::ios::binary);
+	if (!in.is_open())
+	{
+		return false;
+	}
+
+	Header header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(Header))
+		|| std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) != 0 || header.mVersion != VERSION)
+	{
+		LOG_ERROR("File " << _file << " is not a pivot index of version " << VERSION);
+		return false;
+	}
+
+	std::string tag(header.mTagLength < (1 << 16) ? header.mTagLength : 0, '\0');
+	in.read(&tag[0], tag.size());
+
+	//an index of other features, distance parameters or model order is stale
+	if (header.mElements != uint64_t(_model.size()) || header.mModelHash != _modelHash || tag != _tag || header.mPivots > header.mElements)
+	{
+		LOG_INFO("Pivot index " << _file << " does not belong to this model and distance");
+		return false;
+	}
+
+	std::vector<int32_t> pivots(header.mPivots);
+	std::vector<float> selfSimilarities(header.mElements);
+	std::vector<float> table(header.mElements * header.mPivots);
+	in.read(reinterpret_cast<char*>(pivots.data()), pivots.size() * sizeof(int32_t));
+	in.read(reinterpret_cast<char*>(selfSimilarities.data()), selfSimilarities.size() * sizeof(float));
+	in.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(float));
+
+	if (!in || in.peek() != std::ifstream::traits_type::eof())
+	{
+		LOG_ERROR("Pivot index " << _file << " is truncated or corrupted");
+		return false;
+	}
+
+	for (int iPivot = 0; iPivot < pivots.size(); iPivot++)
+	{
+		if (pivots[iPivot] < 0 || pivots[iPivot] >= _model.size())
+		{
+			LOG_ERROR("Pivot index " << _file << " has an invalid pivot " << iPivot);
+			return false;
+		}
+	}
+
+	mModel = &_model;
+	mDistance = &_distance;
+	mPivots.assign(pivots.begin(), pivots.end());
+	mSelfSimilarities.swap(selfSimilarities);
+	mTable.swap(table);
+
+	mNorms.resize(mSelfSimilarities.size());
+	for (int iElem = 0; iElem < mSelfSimilarities.size(); iElem++)
+	{
+		mNorms[iElem] = mSelfSimilarities[iElem] > 0 ? std::sqrt(mSelfSimilarities[iElem]) : 0;
+	}
+
+	return true;
+}
+
+bool trecvid::PivotIndex::isEmpty() const
+{
+	return mModel == nullptr;
+}
+
+int trecvid::PivotIndex::getPivotCount() const
+{
+	return mPivots.size();
+}
+
+const std::vector<float>& trecvid::PivotIndex::getNorms() const
+{
+	return mNorms;
+}
+
+const float* trecvid::PivotIndex::getPivotDistances(int _element) const
+{
+	return mTable.data() + uint64_t(_element) * mPivots.size();
+}
+
+void trecvid::PivotIndex::computePivotDistances(const cv::Mat& _queryCodes, float _querySelfSimilarity, std::vector<float>& _distances) const
+{
+	_distances.resize(mPivots.size());
+	for (int iPivot = 0; iPivot < mPivots.size(); iPivot++)
+	{
+		_distances[iPivot] = computeDistance(_queryCodes, _querySelfSimilarity, mPivots[iPivot]);
+	}
+}
+
+float trecvid::PivotIndex::computeDistance(const cv::Mat& _codes, float _selfSimilarity, int _element) const
+{
+	//the same distance as the scan of the model, see TRECVidValuation::computeDistance
+	return mDistance->compute(mModel->getQuantizer(), _codes, _selfSimilarity, mModel->getCodes(_element), mSelfSimilarities[_element]);
+}
+
+float trecvid::PivotIndex::lowerBound(const float* _queryPivots, float _queryNorm, int _element) const
+{
+	const float* pivots = getPivotDistances(_element);
+
+	float bound = 0;
+	for (int iPivot = 0; iPivot < mPivots.size(); iPivot++)
+	{
+		bound = std::max(bound, std::abs(_queryPivots[iPivot] - pivots[iPivot]));
+	}
+	bound -= TOLERANCE * (_queryNorm + mNorms[_element]);
+
+	//the difference of the norms is a bound as well
+	return std::max(bound, SQFDistance::lowerBound(_queryNorm, mNorms[_element]));
+}
+
+void trecvid::PivotIndex::orderByLowerBound(const cv::Mat& _queryCodes, float _querySelfSimilarity, std::vector<Match>& _candidates, Statistics& _statistics) const
+{
+	std::vector<float> queryPivots;
+	computePivotDistances(_queryCodes, _querySelfSimilarity, queryPivots);
+	float queryNorm = _querySelfSimilarity > 0 ? std::sqrt(_querySelfSimilarity) : 0;
+	_statistics.mComputed += queryPivots.size();
+
+	_candidates.resize(mNorms.size());
+	for (int iElem = 0; iElem < mNorms.size(); iElem++)
+	{
+		_candidates[iElem] = Match(lowerBound(queryPivots.data(), queryNorm, iElem), iElem);
+	}
+	std::sort(_candidates.begin(), _candidates.end());
+}
+
+void trecvid::PivotIndex::computeBatch(const cv::Mat& _queryCodes, float _querySelfSimilarity, const std::vector<Match>& _candidates, int _begin, int _end,
+	vretbox::WorkStealingPool& _pool, std::vector<float>& _distances) const
+{
+	_distances.resize(_end - _begin);
+
+	int parts = std::max(1, _pool.size());
+	int partSize = (_end - _begin + parts - 1) / parts;
+	for (int iBegin = _begin; iBegin < _end; iBegin += partSize)
+	{
+		int end = std::min(iBegin + partSize, _end);
+		_pool.submit([this, &_queryCodes, _querySelfSimilarity, &_candidates, &_distances, _begin, iBegin, end](int)
+		{
+			for (int iCandidate = iBegin; iCandidate < end; iCandidate++)
+			{
+				_distances[iCandidate - _begin] = computeDistance(_queryCodes, _querySelfSimilarity, _candidates[iCandidate].second);
+			}
+		});
+	}
+	_pool.wait();
+}
+
+void trecvid::PivotIndex::knn(const cv::Mat& _queryCodes, int _k, int _batchSize, vretbox::WorkStealingPool& _pool, std::vector<Match>& _result, Statistics& _statistics) const
+{
+	_result.clear();
+	if (_k <= 0 || isEmpty())
+	{
+		return;
+	}
+
+	float querySelfSimilarity = mDistance->computeSelfSimilarity(mModel->getQuantizer(), _queryCodes);
+	std::vector<Match> candidates;
+	orderByLowerBound(_queryCodes, querySelfSimilarity, candidates, _statistics);
+
+	int batchSize = std::max(1, _batchSize);
+	int begin = 0;
+	std::vector<float> distances;
+	while (begin < candidates.size())
+	{
+		//the candidates are ordered by their bound, none of the remaining ones can enter the top k
+		if (_result.size() == _k && candidates[begin].first > _result.front().first)
+		{
+			break;
+		}
+
+		int end = std::min(begin + batchSize, int(candidates.size()));
+		computeBatch(_queryCodes, querySelfSimilarity, candidates, begin, end, _pool, distances);
+		_statistics.mComputed += end - begin;
+
+		//max heap of the best k matches
+		for (int iCandidate = begin; iCandidate < end; iCandidate++)
+		{
+			Match match(distances[iCandidate - begin], candidates[iCandidate].second);
+			if (_result.size() < _k)
+			{
+				_result.push_back(match);
+				std::push_heap(_result.begin(), _result.end());
+			}
+			else if (match < _result.front())
+			{
+				std::pop_heap(_result.begin(), _result.end());
+				_result.back() = match;
+				std::push_heap(_result.begin(), _result.end());
+			}
+		}
+
+		begin = end;
+	}
+	_statistics.mAvoided += candidates.size() - begin;
+
+	std::sort_heap(_result.begin(), _result.end());
+}
+
+void trecvid::PivotIndex::range(const cv::Mat& _queryCodes, float _radius, int _batchSize, vretbox::WorkStealingPool& _pool, std::vector<Match>& _result, Statistics& _statistics) const
+{
+	_result.clear();
+	if (isEmpty())
+	{
+		return;
+	}
+
+	float querySelfSimilarity = mDistance->computeSelfSimilarity(mModel->getQuantizer(), _queryCodes);
+	std::vector<Match> candidates;
+	orderByLowerBound(_queryCodes, querySelfSimilarity, candidates, _statistics);
+
+	int batchSize = std::max(1, _batchSize);
+	int begin = 0;
+	std::vector<float> distances;
+	while (begin < candidates.size() && candidates[begin].first <= _radius)
+	{
+		int end = std::min(begin + batchSize, int(candidates.size()));
+		computeBatch(_queryCodes, querySelfSimilarity, candidates, begin, end, _pool, distances);
+		_statistics.mComputed += end - begin;
+
+		for (int iCandidate = begin; iCandidate < end; iCandidate++)
+		{
+			if (distances[iCandidate - begin] <= _radius)
+			{
+				_result.push_back(Match(distances[iCandidate - begin], candidates[iCandidate].second));
+			}
+		}
+
+		begin = end;
+	}
+	_statistics.mAvoided += candidates.size() - begin;
+
+	std::sort(_result.begin(), _result.end());
+}
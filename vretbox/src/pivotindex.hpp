@@ -0,0 +1,205 @@
+#ifndef _PIVOTINDEX_HPP_
+#define  _PIVOTINDEX_HPP_
+
+#include "signaturestore.hpp"
+#include "sqfdistance.hpp"
+#include "workstealingpool.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Pivot-based metric index (LAESA) of the signatures of a model.
+	* The distances of all signatures to a few pivot signatures are computed once; by the triangle inequality
+	* max_p |d(q, p) - d(x, p)| is a lower bound of d(q, x), so that range and knn queries only compute
+	* the distances of elements whose bound does not exclude them. The results are exact.
+	* All distances are computed on the stored rows of the model (see SignatureStore::getCodes) with the self-similarities
+	* of the scan, so a query ranked by the index gets the same distances as a scan of a float or quantized model.
+	* File layout: Header | tag | pivot indices | self-similarities | pivot distances, element by element.
+	*/
+	class PivotIndex
+	{
+	public:
+
+		static const char MAGIC[8];
+
+		static const uint32_t VERSION = 2;
+
+		/**
+		 * \brief tolerance of the lower bound relative to the norms of the signatures, it absorbs the rounding of the three distances
+		 */
+		static const float TOLERANCE;
+
+		struct Header
+		{
+			char mMagic[8];
+			uint32_t mVersion;
+			uint32_t mPivots;
+			uint64_t mElements;
+			uint64_t mModelHash;
+			uint64_t mTagLength;
+		};
+
+		/**
+		 * \brief distance and model index of a result
+		 */
+		typedef std::pair<float, int> Match;
+
+		/**
+		 * \brief Number of computed distances (including the pivots of the query) and of avoided ones
+		 */
+		struct Statistics
+		{
+			long long mComputed;
+
+			long long mAvoided;
+
+			Statistics() : mComputed(0), mAvoided(0) {}
+
+			/**
+			 * \brief
+			 * \return fraction of the distances that were not computed
+			 */
+			double getAvoidedFraction() const;
+		};
+
+	private:
+
+		const SignatureStore* mModel;
+
+		const SQFDistance* mDistance;
+
+		/**
+		 * \brief model indices of the pivots
+		 */
+		std::vector<int> mPivots;
+
+		/**
+		 * \brief self-similarity of each element, see SQFDistance::computeSelfSimilarity
+		 */
+		std::vector<float> mSelfSimilarities;
+
+		/**
+		 * \brief norm of each element in the feature space of the sqfd, the square root of its self-similarity
+		 */
+		std::vector<float> mNorms;
+
+		/**
+		 * \brief distances of element i to all pivots at i * pivots
+		 */
+		std::vector<float> mTable;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		PivotIndex();
+
+		/**
+		 * \brief Selects the pivots and computes the distances of all elements to them with the pool.
+		 * The first pivot is the first element, each further pivot is the element with the largest sum of
+		 * distances to the selected ones (LAESA selection)
+		 * \param _model
+		 * \param _distance metric sqfd, see SQFDistance::hasLowerBound
+		 * \param _pivots number of pivots
+		 * \param _pool
+		 */
+		void build(const SignatureStore& _model, const SQFDistance& _distance, int _pivots, vretbox::WorkStealingPool& _pool);
+
+		/**
+		 * \brief
+		 * \param _file
+		 * \param _tag feature set and distance parameters
+		 * \param _modelHash see DistanceMatrix::hashModel
+		 * \return true if the index is written, otherwise false
+		 */
+		bool save(std::string _file, const std::string& _tag, uint64_t _modelHash) const;
+
+		/**
+		 * \brief Reads an index and attaches it to the model
+		 * \param _file
+		 * \param _tag expected feature set and distance parameters
+		 * \param _modelHash expected order of the model
+		 * \param _model
+		 * \param _distance
+		 * \return true if the file is a valid index of the model, otherwise false
+		 */
+		bool load(std::string _file, const std::string& _tag, uint64_t _modelHash, const SignatureStore& _model, const SQFDistance& _distance);
+
+		bool isEmpty() const;
+
+		int getPivotCount() const;
+
+		const std::vector<float>& getNorms() const;
+
+		/**
+		 * \brief
+		 * \param _element model index
+		 * \return distances of an element to all pivots
+		 */
+		const float* getPivotDistances(int _element) const;
+
+		/**
+		 * \brief
+		 * \param _queryCodes query encoded like the model, see SignatureStore::encode
+		 * \param _querySelfSimilarity self-similarity of the encoded query
+		 * \param _distances filled with the distances of the query to all pivots
+		 */
+		void computePivotDistances(const cv::Mat& _queryCodes, float _querySelfSimilarity, std::vector<float>& _distances) const;
+
+		/**
+		 * \brief
+		 * \param _queryPivots distances of the query to all pivots
+		 * \param _queryNorm norm of the query
+		 * \param _element model index
+		 * \return lower bound of the distance of the query to the element
+		 */
+		float lowerBound(const float* _queryPivots, float _queryNorm, int _element) const;
+
+		/**
+		 * \brief Exact k nearest neighbors; the elements are visited by ascending lower bound in batches
+		 * whose distances are computed by the pool, until the bound exceeds the k-th distance
+		 * \param _queryCodes query encoded like the model, see SignatureStore::encode
+		 * \param _k
+		 * \param _batchSize number of elements of a batch
+		 * \param _pool
+		 * \param _result the _k nearest elements, ordered by distance and index
+		 * \param _statistics
+		 */
+		void knn(const cv::Mat& _queryCodes, int _k, int _batchSize, vretbox::WorkStealingPool& _pool, std::vector<Match>& _result, Statistics& _statistics) const;
+
+		/**
+		 * \brief All elements within a radius
+		 * \param _queryCodes query encoded like the model, see SignatureStore::encode
+		 * \param _radius
+		 * \param _batchSize number of elements of a batch
+		 * \param _pool
+		 * \param _result the elements with a distance of at most _radius, ordered by distance and index
+		 * \param _statistics
+		 */
+		void range(const cv::Mat& _queryCodes, float _radius, int _batchSize, vretbox::WorkStealingPool& _pool, std::vector<Match>& _result, Statistics& _statistics) const;
+
+	private:
+
+		/**
+		 * \brief Distance of an encoded signature to an element, the rows of the element are not copied
+		 */
+		float computeDistance(const cv::Mat& _codes, float _selfSimilarity, int _element) const;
+
+		/**
+		 * \brief Computes the pivot distances and the bounds of all elements and orders the elements by their bound
+		 */
+		void orderByLowerBound(const cv::Mat& _queryCodes, float _querySelfSimilarity, std::vector<Match>& _candidates, Statistics& _statistics) const;
+
+		/**
+		 * \brief Computes the distances of the candidates [_begin, _end) with the pool
+		 */
+		void computeBatch(const cv::Mat& _queryCodes, float _querySelfSimilarity, const std::vector<Match>& _candidates, int _begin, int _end,
+			vretbox::WorkStealingPool& _pool, std::vector<float>& _distances) const;
+	};
+}
+
+#endif //_PIVOTINDEX_HPP_
@@ -0,0 +1,281 @@
+#include "quantizer.hpp"
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+trecvid::Quantizer::Quantizer()
+	: mEncoding(FLOAT32), mDimension(0)
+{
+}
+
+void trecvid::Quantizer::fit(Encoding _encoding, const float* _values, size_t _rows, int _dimension)
+{
+	mEncoding = _encoding;
+	mDimension = _dimension;
+	mMinima.clear();
+	mScales.clear();
+
+	if (mEncoding != INT8)
+	{
+		return;
+	}
+
+	std::vector<float> maxima(_dimension, -std::numeric_limits<float>::infinity());
+	mMinima.assign(_dimension, std::numeric_limits<float>::infinity());
+	for (size_t iRow = 0; iRow < _rows; iRow++)
+	{
+		const float* row = _values + iRow * _dimension;
+		for (int iCol = 0; iCol < _dimension; iCol++)
+		{
+			mMinima[iCol] = std::min(mMinima[iCol], row[iCol]);
+			maxima[iCol] = std::max(maxima[iCol], row[iCol]);
+		}
+	}
+
+	//a constant column is encoded by its minimum alone
+	mScales.assign(_dimension, 0);
+	for (int iCol = 0; iCol < _dimension; iCol++)
+	{
+		if (_rows == 0)
+		{
+			mMinima[iCol] = 0;
+			continue;
+		}
+		mScales[iCol] = (maxima[iCol] - mMinima[iCol]) / 255.0f;
+	}
+}
+
+void trecvid::Quantizer::setParameters(Encoding _encoding, int _dimension, const std::vector<float>& _minima, const std::vector<float>& _scales)
+{
+	mEncoding = _encoding;
+	mDimension = _dimension;
+	mMinima = _minima;
+	mScales = _scales;
+}
+
+trecvid::Quantizer::Encoding trecvid::Quantizer::getEncoding() const
+{
+	return mEncoding;
+}
+
+bool trecvid::Quantizer::isQuantized() const
+{
+	return mEncoding != FLOAT32;
+}
+
+int trecvid::Quantizer::getDimension() const
+{
+	return mDimension;
+}
+
+const std::vector<float>& trecvid::Quantizer::getMinima() const
+{
+	return mMinima;
+}
+
+const std::vector<float>& trecvid::Quantizer::getScales() const
+{
+	return mScales;
+}
+
+size_t trecvid::Quantizer::getValueSize() const
+{
+	switch (mEncoding)
+	{
+	case FLOAT16:
+		return sizeof(uint16_t);
+	case INT8:
+		return sizeof(uint8_t);
+	default:
+		return sizeof(float);
+	}
+}
+
+int trecvid::Quantizer::getType() const
+{
+	switch (mEncoding)
+	{
+	case FLOAT16:
+		return CV_16UC1;
+	case INT8:
+		return CV_8UC1;
+	default:
+		return CV_32FC1;
+	}
+}
+
+void trecvid::Quantizer::encode(const float* _values, size_t _rows, void* _codes) const
+{
+	size_t values = _rows * mDimension;
+
+	if (mEncoding == FLOAT16)
+	{
+		uint16_t* halves = static_cast<uint16_t*>(_codes);
+		for (size_t iValue = 0; iValue < values; iValue++)
+		{
+			halves[iValue] = toHalf(_values[iValue]);
+		}
+	}
+	else if (mEncoding == INT8)
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(_codes);
+		for (size_t iValue = 0; iValue < values; iValue++)
+		{
+			int iCol = int(iValue % mDimension);
+			float step = mScales[iCol] > 0 ? std::round((_values[iValue] - mMinima[iCol]) / mScales[iCol]) : 0;
+			bytes[iValue] = uint8_t(std::min(255.0f, std::max(0.0f, step)));
+		}
+	}
+	else
+	{
+		std::memcpy(_codes, _values, values * sizeof(float));
+	}
+}
+
+void trecvid::Quantizer::decode(const void* _codes, size_t _rows, float* _values) const
+{
+	size_t values = _rows * mDimension;
+
+	if (mEncoding == FLOAT16)
+	{
+		const uint16_t* halves = static_cast<const uint16_t*>(_codes);
+		for (size_t iValue = 0; iValue < values; iValue++)
+		{
+			_values[iValue] = fromHalf(halves[iValue]);
+		}
+	}
+	else if (mEncoding == INT8)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(_codes);
+		for (size_t iValue = 0; iValue < values; iValue++)
+		{
+			int iCol = int(iValue % mDimension);
+			_values[iValue] = mMinima[iCol] + mScales[iCol] * float(bytes[iValue]);
+		}
+	}
+	else
+	{
+		std::memcpy(_values, _codes, values * sizeof(float));
+	}
+}
+
+uint16_t trecvid::Quantizer::toHalf(float _value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &_value, sizeof(bits));
+
+	uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	//infinity and nan, a nan keeps a set mantissa bit
+	if (exponent == 0xff)
+	{
+		return uint16_t(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	int halfExponent = int(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+	{
+		return uint16_t(sign | 0x7c00);
+	}
+
+	if (halfExponent <= 0)
+	{
+		//subnormal half or zero
+		if (halfExponent < -10)
+		{
+			return sign;
+		}
+		mantissa |= 0x800000;
+		int shift = 14 - halfExponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return uint16_t(sign | half);
+	}
+
+	//a carry of the rounding into the exponent is correct, up to infinity
+	uint32_t half = (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return uint16_t(sign | half);
+}
+
+float trecvid::Quantizer::fromHalf(uint16_t _half)
+{
+	uint32_t sign = uint32_t(_half & 0x8000) << 16;
+	uint32_t exponent = (_half >> 10) & 0x1f;
+	uint32_t mantissa = _half & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		//a subnormal half is a normal float
+		int shift = 0;
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			shift++;
+		}
+		bits = sign | (uint32_t(127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+	}
+
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+bool trecvid::Quantizer::parse(std::string _name, Encoding& _encoding)
+{
+	if (_name == "float")
+	{
+		_encoding = FLOAT32;
+	}
+	else if (_name == "fp16")
+	{
+		_encoding = FLOAT16;
+	}
+	else if (_name == "int8")
+	{
+		_encoding = INT8;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+std::string trecvid::Quantizer::toString(Encoding _encoding)
+{
+	switch (_encoding)
+	{
+	case FLOAT16:
+		return "fp16";
+	case INT8:
+		return "int8";
+	default:
+		return "float";
+	}
+}
@@ -0,0 +1,128 @@
+#ifndef _QUANTIZER_HPP_
+#define  _QUANTIZER_HPP_
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Encoding of the signature rows of a model.
+	* FLOAT16 stores each value as IEEE half (CV_16UC1 codes), INT8 maps each column affinely
+	* onto 0..255 with the minimum and the range of the column in the model (CV_8UC1 codes),
+	* so that the difference of two values is the difference of their codes times the scale of the column.
+	*/
+	class Quantizer
+	{
+	public:
+
+		enum Encoding
+		{
+			FLOAT32 = 0,
+			FLOAT16 = 1,
+			INT8 = 2
+		};
+
+	private:
+
+		Encoding mEncoding;
+
+		int mDimension;
+
+		/**
+		 * \brief minimum of each column (INT8 only)
+		 */
+		std::vector<float> mMinima;
+
+		/**
+		 * \brief value of one step of each column (INT8 only)
+		 */
+		std::vector<float> mScales;
+
+	public:
+
+		/**
+		 * \brief FLOAT32, the rows are not encoded
+		 */
+		Quantizer();
+
+		/**
+		 * \brief Determines the parameters of an encoding from the rows of a model
+		 * \param _encoding
+		 * \param _values all rows, row-major
+		 * \param _rows number of rows
+		 * \param _dimension number of columns of each row
+		 */
+		void fit(Encoding _encoding, const float* _values, size_t _rows, int _dimension);
+
+		/**
+		 * \brief Uses known parameters, e.g. of a collection file
+		 * \param _encoding
+		 * \param _dimension
+		 * \param _minima minimum of each column (INT8 only)
+		 * \param _scales step of each column (INT8 only)
+		 */
+		void setParameters(Encoding _encoding, int _dimension, const std::vector<float>& _minima, const std::vector<float>& _scales);
+
+		Encoding getEncoding() const;
+
+		bool isQuantized() const;
+
+		int getDimension() const;
+
+		const std::vector<float>& getMinima() const;
+
+		const std::vector<float>& getScales() const;
+
+		/**
+		 * \brief
+		 * \return bytes of one encoded value
+		 */
+		size_t getValueSize() const;
+
+		/**
+		 * \brief
+		 * \return OpenCV type of the encoded rows
+		 */
+		int getType() const;
+
+		/**
+		 * \brief Encodes rows, values outside of the range of an INT8 column are clamped
+		 * \param _values rows, row-major
+		 * \param _rows
+		 * \param _codes getValueSize() * _rows * dimension bytes
+		 */
+		void encode(const float* _values, size_t _rows, void* _codes) const;
+
+		/**
+		 * \brief
+		 * \param _codes encoded rows
+		 * \param _rows
+		 * \param _values _rows * dimension floats
+		 */
+		void decode(const void* _codes, size_t _rows, float* _values) const;
+
+		/**
+		 * \brief Round to nearest even, values beyond the half range become infinite
+		 * \param _value
+		 * \return
+		 */
+		static uint16_t toHalf(float _value);
+
+		static float fromHalf(uint16_t _half);
+
+		/**
+		 * \brief
+		 * \param _name float, fp16 or int8
+		 * \param _encoding
+		 * \return false for unknown names
+		 */
+		static bool parse(std::string _name, Encoding& _encoding);
+
+		static std::string toString(Encoding _encoding);
+	};
+}
+
+#endif //_QUANTIZER_HPP_
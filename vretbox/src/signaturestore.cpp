@@ -0,0 +1,273 @@
+#include "signaturestore.hpp"
+#include "avsfeatures.hpp"
+#include <cplusutil.hpp>
+
+trecvid::SignatureStore::SignatureStore()
+{
+	mDimension = 0;
+	mData = nullptr;
+	mCodeData = nullptr;
+	mOffsets.push_back(0);
+}
+
+void trecvid::SignatureStore::reserve(size_t _signatures, size_t _rows, int _dimension)
+{
+	mValues.reserve(_rows * _dimension);
+	mOffsets.reserve(_signatures + 1);
+	mVIDs.reserve(_signatures);
+	mSIDs.reserve(_signatures);
+	mQIDs.reserve(_signatures);
+	mFilenames.reserve(_signatures);
+}
+
+int trecvid::SignatureStore::add(const cv::Mat& _signature, int _vid, int _sid, int _qid, std::string _filename)
+{
+	if (_signature.type() != CV_32FC1)
+	{
+		LOG_FATAL("Signature " << _filename << " is not a single channel float matrix");
+		return -1;
+	}
+
+	if (mDimension == 0)
+	{
+		mDimension = _signature.cols;
+	}
+	else if (_signature.cols != mDimension)
+	{
+		LOG_FATAL("Signature " << _filename << " has " << _signature.cols << " columns, expected are " << mDimension);
+		return -1;
+	}
+
+	if (mData != nullptr && mData != mValues.data())
+	{
+		LOG_FATAL("Signature " << _filename << " cannot be added to an attached store");
+		return -1;
+	}
+
+	if (isQuantized())
+	{
+		LOG_FATAL("Signature " << _filename << " cannot be added to a quantized store");
+		return -1;
+	}
+
+	for (int iRow = 0; iRow < _signature.rows; iRow++)
+	{
+		const float* row = _signature.ptr<float>(iRow);
+		mValues.insert(mValues.end(), row, row + mDimension);
+	}
+	mData = mValues.data();
+
+	mOffsets.push_back(mOffsets.back() + _signature.rows);
+	mVIDs.push_back(_vid);
+	mSIDs.push_back(_sid);
+	mQIDs.push_back(_qid);
+	mFilenames.push_back(_filename);
+
+	return int(mVIDs.size()) - 1;
+}
+
+int trecvid::SignatureStore::load(std::string _file)
+{
+	AVSFeatures features;
+	features.deserialize(_file);
+
+	if (features.mVectors.empty())
+	{
+		LOG_ERROR("Feature file " << _file << " cannot be deserialized.");
+		return -1;
+	}
+
+	return add(features.mVectors, features.mVID, features.mSID, 0, features.mVideoFileName);
+}
+
+void trecvid::SignatureStore::attach(const float* _values, int _dimension, const std::vector<size_t>& _offsets,
+	const std::vector<int>& _vids, const std::vector<int>& _sids, const std::vector<std::string>& _filenames)
+{
+	clear();
+
+	mData = _values;
+	mDimension = _dimension;
+	mOffsets = _offsets;
+	mVIDs = _vids;
+	mSIDs = _sids;
+	mQIDs.assign(_vids.size(), 0);
+	mFilenames = _filenames;
+}
+
+void trecvid::SignatureStore::attach(const void* _codes, const Quantizer& _quantizer, const std::vector<size_t>& _offsets,
+	const std::vector<int>& _vids, const std::vector<int>& _sids, const std::vector<std::string>& _filenames)
+{
+	if (!_quantizer.isQuantized())
+	{
+		attach(static_cast<const float*>(_codes), _quantizer.getDimension(), _offsets, _vids, _sids, _filenames);
+		return;
+	}
+
+	attach(nullptr, _quantizer.getDimension(), _offsets, _vids, _sids, _filenames);
+	mQuantizer = _quantizer;
+	mCodeData = static_cast<const uint8_t*>(_codes);
+}
+
+bool trecvid::SignatureStore::quantize(Quantizer::Encoding _encoding)
+{
+	if (isQuantized())
+	{
+		LOG_ERROR("The store is already encoded as " << Quantizer::toString(mQuantizer.getEncoding()));
+		return false;
+	}
+
+	size_t rows = getRowCount();
+	mQuantizer.fit(_encoding, mData, rows, mDimension);
+	if (!isQuantized())
+	{
+		return true;
+	}
+
+	mCodes.resize(rows * getRowSize());
+	mQuantizer.encode(mData, rows, mCodes.data());
+	mCodeData = mCodes.data();
+
+	mData = nullptr;
+	std::vector<float>().swap(mValues);
+
+	return true;
+}
+
+void trecvid::SignatureStore::clear()
+{
+	mDimension = 0;
+	mData = nullptr;
+	mCodeData = nullptr;
+	mQuantizer = Quantizer();
+	std::vector<float>().swap(mValues);
+	std::vector<uint8_t>().swap(mCodes);
+	std::vector<size_t>(1, 0).swap(mOffsets);
+	std::vector<int>().swap(mVIDs);
+	std::vector<int>().swap(mSIDs);
+	std::vector<int>().swap(mQIDs);
+	std::vector<std::string>().swap(mFilenames);
+}
+
+int trecvid::SignatureStore::size() const
+{
+	return int(mVIDs.size());
+}
+
+size_t trecvid::SignatureStore::getRowCount() const
+{
+	return mOffsets.back();
+}
+
+int trecvid::SignatureStore::getDimension() const
+{
+	return mDimension;
+}
+
+bool trecvid::SignatureStore::isQuantized() const
+{
+	return mQuantizer.isQuantized();
+}
+
+const trecvid::Quantizer& trecvid::SignatureStore::getQuantizer() const
+{
+	return mQuantizer;
+}
+
+size_t trecvid::SignatureStore::getMemorySize() const
+{
+	return getRowCount() * getRowSize();
+}
+
+cv::Mat trecvid::SignatureStore::getSignature(int _index) const
+{
+	if (isQuantized())
+	{
+		return decode(getCodes(_index));
+	}
+
+	return cv::Mat(getRows(_index), mDimension, CV_32FC1, const_cast<float*>(getData(_index)));
+}
+
+cv::Mat trecvid::SignatureStore::getCodes(int _index) const
+{
+	return cv::Mat(getRows(_index), mDimension, isQuantized() ? mQuantizer.getType() : CV_32FC1, const_cast<uint8_t*>(getCodeData(_index)));
+}
+
+cv::Mat trecvid::SignatureStore::encode(const cv::Mat& _signature) const
+{
+	cv::Mat signature = _signature.isContinuous() ? _signature : _signature.clone();
+	cv::Mat codes(signature.rows, mDimension, isQuantized() ? mQuantizer.getType() : CV_32FC1);
+	if (isQuantized())
+	{
+		mQuantizer.encode(signature.ptr<float>(), signature.rows, codes.data);
+	}
+	else
+	{
+		signature.copyTo(codes);
+	}
+	return codes;
+}
+
+cv::Mat trecvid::SignatureStore::decode(const cv::Mat& _codes) const
+{
+	cv::Mat signature(_codes.rows, mDimension, CV_32FC1);
+	if (isQuantized())
+	{
+		mQuantizer.decode(_codes.data, _codes.rows, signature.ptr<float>());
+	}
+	else
+	{
+		_codes.copyTo(signature);
+	}
+	return signature;
+}
+
+int trecvid::SignatureStore::getRows(int _index) const
+{
+	return int(mOffsets[_index + 1] - mOffsets[_index]);
+}
+
+const float* trecvid::SignatureStore::getData(int _index) const
+{
+	return mData != nullptr ? mData + mOffsets[_index] * mDimension : nullptr;
+}
+
+const uint8_t* trecvid::SignatureStore::getCodeData(int _index) const
+{
+	if (isQuantized())
+	{
+		return mCodeData + mOffsets[_index] * getRowSize();
+	}
+
+	return reinterpret_cast<const uint8_t*>(getData(_index));
+}
+
+size_t trecvid::SignatureStore::getRowSize() const
+{
+	return mDimension * (isQuantized() ? mQuantizer.getValueSize() : sizeof(float));
+}
+
+int trecvid::SignatureStore::getVID(int _index) const
+{
+	return mVIDs[_index];
+}
+
+int trecvid::SignatureStore::getSID(int _index) const
+{
+	return mSIDs[_index];
+}
+
+int trecvid::SignatureStore::getQID(int _index) const
+{
+	return mQIDs[_index];
+}
+
+void trecvid::SignatureStore::setQID(int _index, int _qid)
+{
+	mQIDs[_index] = _qid;
+}
+
+const std::string& trecvid::SignatureStore::getFilename(int _index) const
+{
+	return mFilenames[_index];
+}
@@ -0,0 +1,217 @@
+#ifndef _SIGNATURESTORE_HPP_
+#define  _SIGNATURESTORE_HPP_
+
+#include "quantizer.hpp"
+#include <opencv2/core.hpp>
+#include <vector>
+#include <string>
+
+namespace trecvid {
+
+	/**
+	* \brief Structure-of-arrays store of the evaluation model.
+	* The rows of all signatures (centroids and weights) are packed one after the other into one float arena,
+	* a signature is described by its row offset and its number of rows. The ids and filenames of the shots
+	* are held in side arrays, so that a scan over the model touches contiguous memory only.
+	* A quantized store keeps the encoded rows only (see Quantizer), its signatures are decoded on access.
+	*/
+	class SignatureStore
+	{
+		/**
+		 * \brief number of columns of each signature row
+		 */
+		int mDimension;
+
+		/**
+		 * \brief all signature rows, row-major (empty if the store is attached to external memory)
+		 */
+		std::vector<float> mValues;
+
+		/**
+		 * \brief begin of the arena, either mValues or an attached memory region
+		 */
+		const float* mData;
+
+		Quantizer mQuantizer;
+
+		/**
+		 * \brief all encoded signature rows of a quantized store (empty if it is attached to external memory)
+		 */
+		std::vector<uint8_t> mCodes;
+
+		/**
+		 * \brief begin of the encoded arena, either mCodes or an attached memory region
+		 */
+		const uint8_t* mCodeData;
+
+		/**
+		 * \brief row offset of each signature, the last entry is the total number of rows
+		 */
+		std::vector<size_t> mOffsets;
+
+		std::vector<int> mVIDs;
+
+		std::vector<int> mSIDs;
+
+		std::vector<int> mQIDs;
+
+		std::vector<std::string> mFilenames;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		SignatureStore();
+
+		/**
+		 * \brief Reserves memory for the expected size of the model
+		 * \param _signatures number of signatures
+		 * \param _rows total number of rows
+		 * \param _dimension number of columns of each row
+		 */
+		void reserve(size_t _signatures, size_t _rows, int _dimension);
+
+		/**
+		 * \brief Copies a signature into the arena
+		 * \param _signature single channel float matrix, each row is a centroid with its weight
+		 * \param _vid video id
+		 * \param _sid shot id
+		 * \param _qid query id
+		 * \param _filename feature file of the signature
+		 * \return the index of the signature
+		 */
+		int add(const cv::Mat& _signature, int _vid, int _sid, int _qid, std::string _filename);
+
+		/**
+		 * \brief Reads a feature file (<vid>_<sid>_*.bin) and copies its signature into the arena
+		 * \param _file feature file
+		 * \return the index of the signature or -1 if the file cannot be read
+		 */
+		int load(std::string _file);
+
+		/**
+		 * \brief Uses an external arena without copying it, e.g. a mapped collection file;
+		 * the memory has to outlive the store
+		 * \param _values all signature rows, row-major
+		 * \param _dimension number of columns of each row
+		 * \param _offsets row offset of each signature and the total number of rows as last entry
+		 * \param _vids video ids
+		 * \param _sids shot ids
+		 * \param _filenames feature files of the signatures
+		 */
+		void attach(const float* _values, int _dimension, const std::vector<size_t>& _offsets,
+			const std::vector<int>& _vids, const std::vector<int>& _sids, const std::vector<std::string>& _filenames);
+
+		/**
+		 * \brief Uses an external encoded arena without copying it, see attach
+		 * \param _codes all encoded signature rows, row-major
+		 * \param _quantizer encoding of the rows
+		 * \param _offsets row offset of each signature and the total number of rows as last entry
+		 * \param _vids video ids
+		 * \param _sids shot ids
+		 * \param _filenames feature files of the signatures
+		 */
+		void attach(const void* _codes, const Quantizer& _quantizer, const std::vector<size_t>& _offsets,
+			const std::vector<int>& _vids, const std::vector<int>& _sids, const std::vector<std::string>& _filenames);
+
+		/**
+		 * \brief Encodes all rows and frees the float arena; an attached arena is no longer read afterwards
+		 * \param _encoding FLOAT16 or INT8, whose column ranges are taken from the model
+		 * \return false if the store is already quantized
+		 */
+		bool quantize(Quantizer::Encoding _encoding);
+
+		/**
+		 * \brief Frees all signatures
+		 */
+		void clear();
+
+		/**
+		 * \brief
+		 * \return number of signatures
+		 */
+		int size() const;
+
+		/**
+		 * \brief
+		 * \return total number of rows of all signatures
+		 */
+		size_t getRowCount() const;
+
+		int getDimension() const;
+
+		bool isQuantized() const;
+
+		const Quantizer& getQuantizer() const;
+
+		/**
+		 * \brief
+		 * \return bytes of the signature rows in memory
+		 */
+		size_t getMemorySize() const;
+
+		/**
+		 * \brief A matrix header over the arena; the data is not copied and is valid
+		 * as long as no signature is added to the store. The signature of a quantized store is a decoded copy.
+		 * \param _index index of the signature
+		 * \return
+		 */
+		cv::Mat getSignature(int _index) const;
+
+		/**
+		 * \brief A matrix header over the encoded rows of a signature, CV_32FC1 for a store that is not quantized
+		 * \param _index index of the signature
+		 * \return
+		 */
+		cv::Mat getCodes(int _index) const;
+
+		/**
+		 * \brief Encodes a signature like the rows of the store, e.g. a query that is not part of the model
+		 * \param _signature
+		 * \return encoded copy of the signature
+		 */
+		cv::Mat encode(const cv::Mat& _signature) const;
+
+		/**
+		 * \brief
+		 * \param _codes encoded rows, see getCodes and encode
+		 * \return decoded copy of the rows
+		 */
+		cv::Mat decode(const cv::Mat& _codes) const;
+
+		int getRows(int _index) const;
+
+		/**
+		 * \brief
+		 * \param _index index of the signature
+		 * \return the float rows of the signature, nullptr if the store is quantized
+		 */
+		const float* getData(int _index) const;
+
+		/**
+		 * \brief
+		 * \param _index index of the signature
+		 * \return the encoded rows of the signature, see getRowSize
+		 */
+		const uint8_t* getCodeData(int _index) const;
+
+		/**
+		 * \brief
+		 * \return bytes of an encoded row
+		 */
+		size_t getRowSize() const;
+
+		int getVID(int _index) const;
+
+		int getSID(int _index) const;
+
+		int getQID(int _index) const;
+
+		void setQID(int _index, int _qid);
+
+		const std::string& getFilename(int _index) const;
+	};
+}
+
+#endif //_SIGNATURESTORE_HPP_
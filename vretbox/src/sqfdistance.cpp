@@ -0,0 +1,252 @@
+#include "sqfdistance.hpp"
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+namespace policy = cv::xfeatures2d::pct_signatures::policy;
+
+const float trecvid::SQFDistance::LOWER_BOUND_TOLERANCE = 1e-4f;
+
+namespace
+{
+	/**
+	 * \brief Instantiates a visitor over the similarity policy of the settings
+	 */
+	template<class Visitor>
+	float visit(trecvid::SQFDistance::SimilarityType _type, float _Lp, float _alpha, const Visitor& _visitor)
+	{
+		if (_type == trecvid::SQFDistance::MINUS)
+		{
+			return policy::visitDistance<policy::DIMENSIONS>(_Lp, policy::MinusSimilarityVisitor<Visitor>(_visitor));
+		}
+
+		return policy::visitDistance<policy::DIMENSIONS>(_Lp, policy::SimilarityVisitor<Visitor, policy::HeuristicSimilarity>(_visitor, _alpha));
+	}
+
+	/**
+	 * \brief L1 distance of two int8 rows, the code differences are weighted by the scales of the columns
+	 */
+	struct QuantizedL1
+	{
+		const float* mScales;
+
+		inline float operator()(const uint8_t* _row0, const uint8_t* _row1) const
+		{
+			float result = 0;
+			for (int d = 0; d < policy::DIMENSIONS; d++)
+			{
+				result += mScales[d] * float(std::abs(int(_row0[d]) - int(_row1[d])));
+			}
+			return result;
+		}
+	};
+
+	/**
+	 * \brief L2 distance of two int8 rows, the squared code differences are weighted by the squared scales
+	 */
+	struct QuantizedL2
+	{
+		const float* mSquaredScales;
+
+		inline float operator()(const uint8_t* _row0, const uint8_t* _row1) const
+		{
+			float result = 0;
+			for (int d = 0; d < policy::DIMENSIONS; d++)
+			{
+				int difference = int(_row0[d]) - int(_row1[d]);
+				result += mSquaredScales[d] * float(difference * difference);
+			}
+			return std::sqrt(result);
+		}
+	};
+
+	struct QuantizedLp
+	{
+		const float* mScales;
+
+		float mP;
+
+		inline float operator()(const uint8_t* _row0, const uint8_t* _row1) const
+		{
+			float result = 0;
+			for (int d = 0; d < policy::DIMENSIONS; d++)
+			{
+				result += std::pow(mScales[d] * float(std::abs(int(_row0[d]) - int(_row1[d]))), mP);
+			}
+			return std::pow(result, 1.0f / mP);
+		}
+	};
+
+	struct QuantizedHeuristic
+	{
+		float mAlpha;
+
+		inline float operator()(float _distance) const
+		{
+			return 1 / (mAlpha + _distance);
+		}
+	};
+
+	struct QuantizedMinus
+	{
+		inline float operator()(float _distance) const
+		{
+			return -_distance;
+		}
+	};
+
+	/**
+	 * \brief Partial SQFD of two int8 signatures in the order of policy::computePartialSQFD
+	 */
+	template<class Dist, class Sim>
+	float computeQuantizedPartial(const cv::Mat& _codes0, const cv::Mat& _codes1, const Dist& _distance, const Sim& _similarity,
+		float _weightMinimum, float _weightScale)
+	{
+		const int weightIdx = cv::xfeatures2d::pct_signatures::WEIGHT_IDX;
+
+		float result = 0;
+		for (int i = 0; i < _codes0.rows; i++)
+		{
+			const uint8_t* row0 = _codes0.ptr<uint8_t>(i);
+			float weight0 = _weightMinimum + _weightScale * float(row0[weightIdx]);
+			for (int j = 0; j < _codes1.rows; j++)
+			{
+				const uint8_t* row1 = _codes1.ptr<uint8_t>(j);
+				float weight1 = _weightMinimum + _weightScale * float(row1[weightIdx]);
+				result += weight0 * weight1 * _similarity(_distance(row0, row1));
+			}
+		}
+		return result;
+	}
+
+	template<class Dist>
+	float computeQuantizedPartial(trecvid::SQFDistance::SimilarityType _type, float _alpha, const cv::Mat& _codes0, const cv::Mat& _codes1,
+		const Dist& _distance, float _weightMinimum, float _weightScale)
+	{
+		if (_type == trecvid::SQFDistance::MINUS)
+		{
+			return computeQuantizedPartial(_codes0, _codes1, _distance, QuantizedMinus(), _weightMinimum, _weightScale);
+		}
+
+		QuantizedHeuristic similarity = { _alpha };
+		return computeQuantizedPartial(_codes0, _codes1, _distance, similarity, _weightMinimum, _weightScale);
+	}
+}
+
+trecvid::SQFDistance::SQFDistance(SimilarityType _type, float _Lp, float _alpha)
+	: mType(_type), mLp(_Lp), mAlpha(_alpha)
+{
+}
+
+float trecvid::SQFDistance::compute(const cv::Mat& _signature0, const cv::Mat& _signature1) const
+{
+	float result = visit(mType, mLp, mAlpha, policy::SquaredSQFD(_signature0, _signature1));
+
+	//the squared distance may be slightly negative because of the rounding of the float sums
+	return result > 0 ? std::sqrt(result) : 0;
+}
+
+float trecvid::SQFDistance::compute(const cv::Mat& _signature0, float _selfSimilarity0, const cv::Mat& _signature1, float _selfSimilarity1) const
+{
+	//the same order of the partial sums as policy::SquaredSQFD, so that the distances are equal
+	float result = 0;
+	result += _selfSimilarity0;
+	result += _selfSimilarity1;
+	result -= visit(mType, mLp, mAlpha, policy::PartialSQFD(_signature0, _signature1)) * 2;
+
+	return result > 0 ? std::sqrt(result) : 0;
+}
+
+float trecvid::SQFDistance::compute(const Quantizer& _quantizer, const cv::Mat& _codes0, float _selfSimilarity0, const cv::Mat& _codes1, float _selfSimilarity1) const
+{
+	float result = 0;
+	result += _selfSimilarity0;
+	result += _selfSimilarity1;
+	result -= computePartial(_quantizer, _codes0, _codes1) * 2;
+
+	return result > 0 ? std::sqrt(result) : 0;
+}
+
+float trecvid::SQFDistance::computeSelfSimilarity(const cv::Mat& _signature) const
+{
+	return visit(mType, mLp, mAlpha, policy::PartialSQFD(_signature, _signature));
+}
+
+float trecvid::SQFDistance::computeSelfSimilarity(const Quantizer& _quantizer, const cv::Mat& _codes) const
+{
+	return computePartial(_quantizer, _codes, _codes);
+}
+
+float trecvid::SQFDistance::computePartial(const Quantizer& _quantizer, const cv::Mat& _codes0, const cv::Mat& _codes1) const
+{
+	if (_quantizer.getEncoding() == Quantizer::INT8)
+	{
+		const std::vector<float>& scales = _quantizer.getScales();
+		const std::vector<float>& minima = _quantizer.getMinima();
+		float weightMinimum = minima[cv::xfeatures2d::pct_signatures::WEIGHT_IDX];
+		float weightScale = scales[cv::xfeatures2d::pct_signatures::WEIGHT_IDX];
+
+		if (mLp == 1.0f)
+		{
+			QuantizedL1 distance = { scales.data() };
+			return computeQuantizedPartial(mType, mAlpha, _codes0, _codes1, distance, weightMinimum, weightScale);
+		}
+		if (mLp == 2.0f)
+		{
+			float squaredScales[policy::DIMENSIONS];
+			for (int d = 0; d < policy::DIMENSIONS; d++)
+			{
+				squaredScales[d] = scales[d] * scales[d];
+			}
+			QuantizedL2 distance = { squaredScales };
+			return computeQuantizedPartial(mType, mAlpha, _codes0, _codes1, distance, weightMinimum, weightScale);
+		}
+		QuantizedLp distance = { scales.data(), mLp };
+		return computeQuantizedPartial(mType, mAlpha, _codes0, _codes1, distance, weightMinimum, weightScale);
+	}
+
+	if (_quantizer.getEncoding() == Quantizer::FLOAT16)
+	{
+		//the rows are widened once, the pairs of rows are compared by the float policies
+		thread_local std::vector<float> values0, values1;
+		values0.resize(_codes0.total());
+		values1.resize(_codes1.total());
+		_quantizer.decode(_codes0.data, _codes0.rows, values0.data());
+		_quantizer.decode(_codes1.data, _codes1.rows, values1.data());
+
+		cv::Mat signature0(_codes0.rows, _codes0.cols, CV_32FC1, values0.data());
+		cv::Mat signature1(_codes1.rows, _codes1.cols, CV_32FC1, values1.data());
+		return visit(mType, mLp, mAlpha, policy::PartialSQFD(signature0, signature1));
+	}
+
+	return visit(mType, mLp, mAlpha, policy::PartialSQFD(_codes0, _codes1));
+}
+
+float trecvid::SQFDistance::computeNorm(const cv::Mat& _signature) const
+{
+	float result = computeSelfSimilarity(_signature);
+	return result > 0 ? std::sqrt(result) : 0;
+}
+
+bool trecvid::SQFDistance::hasLowerBound() const
+{
+	return mType == HEURISTIC && mAlpha > 0 && (mLp == 1.0f || mLp == 2.0f);
+}
+
+float trecvid::SQFDistance::lowerBound(float _norm0, float _norm1)
+{
+	float difference = _norm0 - _norm1;
+	float bound = difference * difference - LOWER_BOUND_TOLERANCE * (_norm0 * _norm0 + _norm1 * _norm1);
+	return bound > 0 ? std::sqrt(bound) : 0;
+}
+
+std::string trecvid::SQFDistance::toString() const
+{
+	std::stringstream settings;
+	settings << "SQFD_" << (mType == MINUS ? "minus" : "heuristic") << "_L" << mLp;
+	if (mType == HEURISTIC)
+	{
+		settings << "_" << mAlpha;
+	}
+	return settings.str();
+}
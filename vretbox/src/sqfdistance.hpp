@@ -0,0 +1,136 @@
+#ifndef _SQFDISTANCE_HPP_
+#define  _SQFDISTANCE_HPP_
+
+#include "quantizer.hpp"
+#include <opencv2/core.hpp>
+#include <cvpctsig.h>
+#include <string>
+
+namespace trecvid {
+
+	/**
+	* \brief Signature Quadratic Form Distance of the evaluation, computed with the similarity policies of cvpctsig.
+	* The weight is read from column WEIGHT_IDX, the first WEIGHT_IDX columns are compared by the ground distance;
+	* further columns (e.g. the motion of temporal signatures) are ignored.
+	*
+	* If the similarity is positive definite, the SQFD is the distance of the signatures in the feature space
+	* of the similarity, thus the difference of their norms is a lower bound of the distance.
+	*/
+	class SQFDistance
+	{
+	public:
+
+		enum SimilarityType
+		{
+			MINUS,
+			HEURISTIC
+		};
+
+		/**
+		 * \brief tolerance of the lower bound relative to the squared norms, it absorbs the rounding of the float sums
+		 */
+		static const float LOWER_BOUND_TOLERANCE;
+
+	private:
+
+		SimilarityType mType;
+
+		float mLp;
+
+		float mAlpha;
+
+	public:
+
+		/**
+		 * \brief
+		 * \param _type similarity of two centroids
+		 * \param _Lp p of the ground distance
+		 * \param _alpha alpha of the heuristic similarity 1 / (alpha + distance)
+		 */
+		SQFDistance(SimilarityType _type, float _Lp, float _alpha);
+
+		/**
+		 * \brief
+		 * \param _signature0
+		 * \param _signature1
+		 * \return SQFD of two signatures
+		 */
+		float compute(const cv::Mat& _signature0, const cv::Mat& _signature1) const;
+
+		/**
+		 * \brief SQFD of two signatures whose self-similarities are known, only the cross term is computed
+		 * \param _signature0
+		 * \param _selfSimilarity0 see computeSelfSimilarity
+		 * \param _signature1
+		 * \param _selfSimilarity1 see computeSelfSimilarity
+		 * \return the same distance as compute
+		 */
+		float compute(const cv::Mat& _signature0, float _selfSimilarity0, const cv::Mat& _signature1, float _selfSimilarity1) const;
+
+		/**
+		 * \brief SQFD of two encoded signatures whose self-similarities are known (see SignatureStore::getCodes).
+		 * INT8 rows are compared on their codes, the difference of two values is the difference of their codes
+		 * times the scale of the column; FLOAT16 rows are widened once per signature.
+		 * \param _quantizer encoding of both signatures
+		 * \param _codes0
+		 * \param _selfSimilarity0 see computeSelfSimilarity
+		 * \param _codes1
+		 * \param _selfSimilarity1 see computeSelfSimilarity
+		 * \return the distance of the decoded signatures up to the rounding of the float sums
+		 */
+		float compute(const Quantizer& _quantizer, const cv::Mat& _codes0, float _selfSimilarity0, const cv::Mat& _codes1, float _selfSimilarity1) const;
+
+		/**
+		 * \brief
+		 * \param _signature
+		 * \return partial SQFD of a signature with itself
+		 */
+		float computeSelfSimilarity(const cv::Mat& _signature) const;
+
+		/**
+		 * \brief
+		 * \param _quantizer
+		 * \param _codes encoded signature
+		 * \return partial SQFD of an encoded signature with itself
+		 */
+		float computeSelfSimilarity(const Quantizer& _quantizer, const cv::Mat& _codes) const;
+
+		/**
+		 * \brief Norm of a signature in the feature space of the similarity, the square root of its self-similarity
+		 * \param _signature
+		 * \return
+		 */
+		float computeNorm(const cv::Mat& _signature) const;
+
+		/**
+		 * \brief The norm bound holds if the similarity is positive definite: the heuristic similarity
+		 * with alpha > 0 and the L1 or L2 ground distance
+		 * \return true if lowerBound may be used for pruning
+		 */
+		bool hasLowerBound() const;
+
+		/**
+		 * \brief Lower bound of the SQFD of two signatures, |norm0 - norm1| reduced by LOWER_BOUND_TOLERANCE * (norm0^2 + norm1^2)
+		 * under the square root
+		 * \param _norm0 see computeNorm
+		 * \param _norm1 see computeNorm
+		 * \return
+		 */
+		static float lowerBound(float _norm0, float _norm1);
+
+		/**
+		 * \brief
+		 * \return the settings, e.g. SQFD_heuristic_L2_1
+		 */
+		std::string toString() const;
+
+	private:
+
+		/**
+		 * \brief Partial SQFD of two encoded signatures
+		 */
+		float computePartial(const Quantizer& _quantizer, const cv::Mat& _codes0, const cv::Mat& _codes1) const;
+	};
+}
+
+#endif //_SQFDISTANCE_HPP_
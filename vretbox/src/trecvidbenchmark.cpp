@@ -0,0 +1,336 @@
+#include "trecvidbenchmark.hpp"
+#include "trecvidvaluation.hpp"
+#include "trecvidxtraction.hpp"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+trecvid::TRECVidBenchmark::TRECVidBenchmark()
+	: mResults(nullptr), mSamplePoints(nullptr), mWarmup(0), mRepetitions(0)
+{
+	mArgs = nullptr;
+}
+
+bool trecvid::TRECVidBenchmark::init(boost::program_options::variables_map _args)
+{
+	mArgs = _args;
+	bool argsValid = true;
+
+	if (!mArgs.count("outfile"))
+	{
+		LOG_ERROR("The csv file of the results (--outfile) is missing");
+		return false;
+	}
+	mResults = new File(mArgs["outfile"].as<std::string>());
+
+	if (!mArgs.count("Cfg.ffs.samplepointdir"))
+	{
+		LOG_ERROR("The directory of the sample points (Cfg.ffs.samplepointdir) is missing");
+		return false;
+	}
+	mSamplePoints = new Directory(mArgs["Cfg.ffs.samplepointdir"].as<std::string>());
+
+	mWarmup = mArgs["Cfg.benchmark.warmup"].as<int>();
+	mRepetitions = mArgs["Cfg.benchmark.repetitions"].as<int>();
+	if (mWarmup < 0 || mRepetitions < 1)
+	{
+		LOG_ERROR("Cfg.benchmark.warmup must not be negative and Cfg.benchmark.repetitions must be positive");
+		argsValid = false;
+	}
+
+	std::vector<std::string> sizes = cplusutil::String::split(mArgs["Cfg.benchmark.sizes"].as<std::string>(), ',');
+	for (int iSize = 0; iSize < sizes.size(); iSize++)
+	{
+		int size = std::atoi(sizes.at(iSize).c_str());
+		if (size <= 0)
+		{
+			LOG_ERROR("Cfg.benchmark.sizes " << sizes.at(iSize) << " is not a number of sample points");
+			argsValid = false;
+			continue;
+		}
+		mSizes.push_back(size);
+	}
+
+	std::vector<std::string> kernels = cplusutil::String::split(mArgs["Cfg.benchmark.kernels"].as<std::string>(), ',');
+	for (int iKernel = 0; iKernel < kernels.size(); iKernel++)
+	{
+		std::string kernel = kernels.at(iKernel);
+		kernel.erase(std::remove(kernel.begin(), kernel.end(), ' '), kernel.end());
+		if (kernel != "sample" && kernel != "contrastentropy" && kernel != "clusterize"
+			&& kernel != "sqfd" && kernel != "temporal" && kernel != "evaluate")
+		{
+			LOG_ERROR("Cfg.benchmark.kernels " << kernel << " is not defined");
+			argsValid = false;
+			continue;
+		}
+		mKernels.insert(kernel);
+	}
+
+	//the frames are shifted copies of one image, so that the temporal matching finds moving centroids
+	cv::Mat image;
+	std::string imageFile = mArgs["Cfg.benchmark.image"].as<std::string>();
+	if (!imageFile.empty())
+	{
+		image = cv::imread(imageFile, cv::IMREAD_COLOR);
+		if (image.empty())
+		{
+			LOG_ERROR("Cfg.benchmark.image " << imageFile << " cannot be read");
+			return false;
+		}
+	}
+	else
+	{
+		int width = mArgs["Cfg.benchmark.width"].as<int>();
+		int height = mArgs["Cfg.benchmark.height"].as<int>();
+		if (width <= 0 || height <= 0)
+		{
+			LOG_ERROR("Cfg.benchmark.width and Cfg.benchmark.height must be positive");
+			return false;
+		}
+
+		//smoothed noise with a fixed seed, the results are comparable between runs
+		image.create(height, width, CV_8UC3);
+		cv::RNG rng(0x5eed);
+		rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+		cv::GaussianBlur(image, image, cv::Size(0, 0), 4);
+	}
+
+	int frames = std::max(2, mArgs["Cfg.ffs.maxFrames"].as<int>());
+	for (int iFrame = 0; iFrame < frames; iFrame++)
+	{
+		cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, 4 * iFrame, 0, 1, 2 * iFrame);
+		cv::Mat frame;
+		cv::warpAffine(image, frame, shift, image.size(), cv::INTER_NEAREST, cv::BORDER_REFLECT);
+		mFrames.push_back(frame);
+	}
+
+	return argsValid;
+}
+
+void trecvid::TRECVidBenchmark::run()
+{
+	std::ofstream of(mResults->getFile(), std::ofstream::out | std::ofstream::trunc);
+	if (!of.is_open())
+	{
+		LOG_FATAL("Fatal Error: The results " << mResults->getFile() << " cannot be written.");
+		exit(EXIT_FAILURE);
+	}
+	of << "kernel,size,warmup,repetitions,min,mean,p50,p90,p99,max" << "\n";
+	of.close();
+
+	LOG_INFO("Benchmark with " << mWarmup << " warm-up runs, " << mRepetitions << " repetitions and frames of "
+		<< mFrames.at(0).cols << "x" << mFrames.at(0).rows << " pixels");
+
+	if (isMeasured("sample") || isMeasured("contrastentropy") || isMeasured("clusterize") || isMeasured("sqfd") || isMeasured("temporal"))
+	{
+		for (int iSize = 0; iSize < mSizes.size(); iSize++)
+		{
+			benchmarkSize(mSizes.at(iSize));
+		}
+	}
+
+	if (isMeasured("evaluate"))
+	{
+		benchmarkEvaluation();
+	}
+}
+
+trecvid::TRECVidBenchmark::~TRECVidBenchmark()
+{
+	delete mResults;
+	delete mSamplePoints;
+}
+
+bool trecvid::TRECVidBenchmark::loadSamplePoints(int _size, std::vector<cv::Point2f>& _points) const
+{
+	return TRECVidXtraction::loadSamplePoints(mSamplePoints->getPath(), "random", _size, _points);
+}
+
+void trecvid::TRECVidBenchmark::benchmarkSize(int _size)
+{
+	std::vector<cv::Point2f> initPoints;
+	if (!loadSamplePoints(_size, initPoints))
+	{
+		return;
+	}
+
+	int grayscaleBits = mArgs["Cfg.ffs.grayscaleBits"].as<int>();
+	int windowRadius = mArgs["Cfg.ffs.windowRadius"].as<int>();
+
+	cv::Ptr<cv::xfeatures2d::pct_signatures::PCTSampler> sampler =
+		cv::xfeatures2d::pct_signatures::PCTSampler::create(initPoints, _size, grayscaleBits, windowRadius);
+
+	int initSeeds = std::min(mArgs["Cfg.ffs.initialCentroids"].as<int>(), _size);
+	cv::Ptr<cv::xfeatures2d::pct_signatures::PCTClusterizer> clusterizer =
+		cv::xfeatures2d::pct_signatures::PCTClusterizer::create(initSeeds, mArgs["Cfg.ffs.iterations"].as<int>());
+	clusterizer->setClusterMinSize(mArgs["Cfg.ffs.minClusterSize"].as<int>());
+	clusterizer->setJoiningDistance(mArgs["Cfg.ffs.minDistance"].as<float>());
+	clusterizer->setDropThreshold(mArgs["Cfg.ffs.dropThreshold"].as<float>());
+
+	//inputs of the later kernels, computed once and not measured
+	std::vector<cv::Mat> samples(mFrames.size());
+	std::vector<cv::Mat> signatures(mFrames.size());
+	for (int iFrame = 0; iFrame < mFrames.size(); iFrame++)
+	{
+		sampler->sample(mFrames.at(iFrame), samples.at(iFrame));
+		clusterizer->clusterize(samples.at(iFrame), signatures.at(iFrame));
+	}
+
+	if (isMeasured("sample"))
+	{
+		cv::Mat result;
+		write(measure("sample", _size, [&]()
+		{
+			sampler->sample(mFrames.at(0), result);
+		}));
+	}
+
+	if (isMeasured("contrastentropy"))
+	{
+		const cv::Mat& frame = mFrames.at(0);
+		cv::xfeatures2d::pct_signatures::GrayscaleBitmap bitmap(frame, grayscaleBits);
+
+		std::vector<cv::Point> points;
+		for (int iPoint = 0; iPoint < initPoints.size(); iPoint++)
+		{
+			points.push_back(cv::Point(int(initPoints[iPoint].x * (frame.cols - 1) + 0.5), int(initPoints[iPoint].y * (frame.rows - 1) + 0.5)));
+		}
+
+		std::vector<double> contrast, entropy;
+		write(measure("contrastentropy", _size, [&]()
+		{
+			bitmap.getContrastEntropy(points, contrast, entropy, windowRadius);
+		}));
+	}
+
+	if (isMeasured("clusterize"))
+	{
+		cv::Mat result;
+		write(measure("clusterize", _size, [&]()
+		{
+			clusterizer->clusterize(samples.at(0), result);
+		}));
+	}
+
+	if (isMeasured("sqfd"))
+	{
+		//the similarity is resolved once, as by a caller that computes many distances
+		cv::xfeatures2d::pct_signatures::HeuristicSimilarity similarity;
+		cv::xfeatures2d::pct_signatures::SQFDKernel kernel(similarity);
+		volatile float distance = 0;
+		write(measure("sqfd", _size, [&]()
+		{
+			distance = cv::xfeatures2d::PCTSignatures::computeQuadraticFormDistance(signatures.at(0), signatures.at(1), kernel);
+		}));
+	}
+
+	if (isMeasured("temporal"))
+	{
+		analysis::tpct_signatures::TPCTSignatures tracker;
+		cv::Mat result;
+		write(measure("temporal", _size, [&]()
+		{
+			//the static signatures are enlarged in place, the copies are part of the measurement
+			std::vector<cv::Mat> staticsignatures;
+			for (int iFrame = 0; iFrame < signatures.size(); iFrame++)
+			{
+				staticsignatures.push_back(signatures.at(iFrame).clone());
+			}
+			tracker.computeTemporalSignature(staticsignatures, result);
+		}));
+	}
+}
+
+void trecvid::TRECVidBenchmark::benchmarkEvaluation()
+{
+	if (!mArgs.count("infile") || !mArgs.count("indir"))
+	{
+		LOG_INFO("The evaluation is not measured, the ground truth (--infile) and the model (--indir) are required");
+		return;
+	}
+
+	TRECVidValuation valuation;
+	if (!valuation.init(mArgs))
+	{
+		LOG_ERROR("The evaluation is not measured, the valuation cannot be initialized");
+		return;
+	}
+
+	std::unordered_map<int, std::vector<int>> queries;
+	if (!valuation.loadModel(queries))
+	{
+		LOG_ERROR("The evaluation is not measured, the model cannot be loaded");
+		return;
+	}
+	valuation.prepareSignatures();
+
+	int modelSize = 0;
+	for (auto iGroup = queries.begin(); iGroup != queries.end(); ++iGroup)
+	{
+		modelSize += int((*iGroup).second.size());
+	}
+
+	write(measure("evaluate", modelSize, [&]()
+	{
+		valuation.evaluate(queries);
+	}));
+}
+
+trecvid::TRECVidBenchmark::Measurement trecvid::TRECVidBenchmark::measure(std::string _kernel, int _size, const std::function<void()>& _function) const
+{
+	for (int iRun = 0; iRun < mWarmup; iRun++)
+	{
+		_function();
+	}
+
+	std::vector<double> times;
+	for (int iRun = 0; iRun < mRepetitions; iRun++)
+	{
+		double start = double(cv::getTickCount());
+		_function();
+		times.push_back((double(cv::getTickCount()) - start) / cv::getTickFrequency() * 1000.0);
+	}
+	std::sort(times.begin(), times.end());
+
+	double sum = 0;
+	for (int iRun = 0; iRun < times.size(); iRun++)
+	{
+		sum += times[iRun];
+	}
+
+	Measurement measurement;
+	measurement.mKernel = _kernel;
+	measurement.mSize = _size;
+	measurement.mMin = times.front();
+	measurement.mMean = sum / times.size();
+	measurement.mP50 = getPercentile(times, 50);
+	measurement.mP90 = getPercentile(times, 90);
+	measurement.mP99 = getPercentile(times, 99);
+	measurement.mMax = times.back();
+	return measurement;
+}
+
+void trecvid::TRECVidBenchmark::write(const Measurement& _measurement) const
+{
+	LOG_INFO("**** " << _measurement.mKernel << " (" << _measurement.mSize << "): " << _measurement.mP50 << " ms median, "
+		<< _measurement.mMin << " ms min, " << _measurement.mP90 << " ms p90");
+
+	std::ofstream of(mResults->getFile(), std::ofstream::out | std::ofstream::app);
+	of << _measurement.mKernel << "," << _measurement.mSize << "," << mWarmup << "," << mRepetitions << ","
+		<< _measurement.mMin << "," << _measurement.mMean << "," << _measurement.mP50 << ","
+		<< _measurement.mP90 << "," << _measurement.mP99 << "," << _measurement.mMax << "\n";
+	of.close();
+}
+
+double trecvid::TRECVidBenchmark::getPercentile(const std::vector<double>& _sorted, double _percent)
+{
+	int rank = int(std::ceil(_percent / 100.0 * _sorted.size()));
+	return _sorted.at(std::min(std::max(rank, 1), int(_sorted.size())) - 1);
+}
+
+bool trecvid::TRECVidBenchmark::isMeasured(std::string _kernel) const
+{
+	return mKernels.count(_kernel) > 0;
+}
@@ -0,0 +1,147 @@
+#ifndef _TRECVIDBENCHMARK_HPP_
+#define  _TRECVIDBENCHMARK_HPP_
+
+#include "toolbase.hpp"
+#include <defuse.hpp>
+#include <cvtfsig.h>
+#include <functional>
+#include <vector>
+#include <string>
+#include <set>
+
+namespace trecvid {
+
+	/**
+	* \brief Micro-benchmark of the extraction and valuation kernels: the sampler, the contrast and entropy
+	* of the grayscale bitmap, the clusterizer, the sqfd, the temporal matching and the evaluation of the ground truth.
+	* Each kernel is measured for each size of the sample points (samplepoints_random_<size>.yml) with warm-up runs
+	* and repetitions; the minimum, the mean and the percentiles of the repetitions are written to a csv file (--outfile).
+	*/
+	class TRECVidBenchmark : public vretbox::ToolBase
+	{
+
+		/**
+		* \brief csv file of the results, one line per kernel and size
+		*/
+		File* mResults;
+
+		/**
+		* \brief directory of the samplepoints_random_<size>.yml files
+		*/
+		Directory* mSamplePoints;
+
+		/**
+		* \brief numbers of sample points
+		*/
+		std::vector<int> mSizes;
+
+		/**
+		* \brief names of the measured kernels
+		*/
+		std::set<std::string> mKernels;
+
+		/**
+		* \brief unmeasured runs before the repetitions of a kernel
+		*/
+		int mWarmup;
+
+		int mRepetitions;
+
+		/**
+		* \brief synthetic frames, or frames shifted from an image (Cfg.benchmark.image)
+		*/
+		std::vector<cv::Mat> mFrames;
+
+	public:
+
+		/**
+		* \brief Time statistics of the repetitions of a kernel in milliseconds
+		*/
+		struct Measurement
+		{
+			std::string mKernel;
+
+			int mSize;
+
+			double mMin;
+
+			double mMean;
+
+			double mP50;
+
+			double mP90;
+
+			double mP99;
+
+			double mMax;
+		};
+
+		/**
+		* \brief
+		*/
+		TRECVidBenchmark();
+
+		/**
+		* \brief
+		* \param _args
+		* \return
+		*/
+		bool init(boost::program_options::variables_map _args) override;
+
+		/**
+		* \brief
+		*/
+		void run() override;
+
+		/**
+		* \brief
+		*/
+		~TRECVidBenchmark() override;
+
+		/**
+		* \brief Reads the sample points of one size
+		* \param _size
+		* \param _points
+		* \return false if the file is missing or has another number of points
+		*/
+		bool loadSamplePoints(int _size, std::vector<cv::Point2f>& _points) const;
+
+		/**
+		* \brief Measures the kernels of one size
+		* \param _size
+		*/
+		void benchmarkSize(int _size);
+
+		/**
+		* \brief Measures the evaluation of the ground truth (--infile) with the model (--indir)
+		*/
+		void benchmarkEvaluation();
+
+		/**
+		* \brief Runs a kernel mWarmup times unmeasured and mRepetitions times measured
+		* \param _kernel
+		* \param _size
+		* \param _function
+		* \return
+		*/
+		Measurement measure(std::string _kernel, int _size, const std::function<void()>& _function) const;
+
+		/**
+		* \brief Logs a measurement and appends it to the results
+		* \param _measurement
+		*/
+		void write(const Measurement& _measurement) const;
+
+		/**
+		* \brief Nearest rank percentile
+		* \param _sorted ascending times
+		* \param _percent
+		* \return
+		*/
+		static double getPercentile(const std::vector<double>& _sorted, double _percent);
+
+		bool isMeasured(std::string _kernel) const;
+	};
+}
+
+#endif //_TRECVIDBENCHMARK_HPP_
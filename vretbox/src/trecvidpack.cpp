@@ -0,0 +1,80 @@
+#include "trecvidpack.hpp"
+#include "featurecollection.hpp"
+
+trecvid::TRECVidPack::TRECVidPack()
+	: mFeatures(nullptr), mCollection(nullptr), mEncoding(Quantizer::FLOAT32)
+{
+	mArgs = nullptr;
+}
+
+bool trecvid::TRECVidPack::init(boost::program_options::variables_map _args)
+{
+	mArgs = _args;
+	bool argsValid = true;
+
+	if (!mArgs.count("indir") || !mArgs.count("outfile"))
+	{
+		LOG_ERROR("The feature directory (--indir) and the collection file (--outfile) are required");
+		return false;
+	}
+
+	mFeatures = new Directory(mArgs["indir"].as<std::string>());
+	mCollection = new File(mArgs["outfile"].as<std::string>());
+
+	if (!Quantizer::parse(mArgs["Cfg.pack.encoding"].as<std::string>(), mEncoding))
+	{
+		LOG_ERROR("Cfg.pack.encoding " << mArgs["Cfg.pack.encoding"].as<std::string>() << " is not defined");
+		argsValid = false;
+	}
+
+	return argsValid;
+}
+
+void trecvid::TRECVidPack::run()
+{
+	double start = double(cv::getTickCount());
+
+	std::vector<std::string> files = cplusutil::FileIO::getFileListFromDirectory(mFeatures->getPath());
+
+	SignatureStore store;
+
+	int fileSize = files.size();
+	for (int iFile = 0; iFile < fileSize; iFile++)
+	{
+		showProgress("Pack features", iFile, fileSize);
+
+		if (store.load(files.at(iFile)) < 0)
+		{
+			LOG_ERROR("Fatal Error: Feature file " << files.at(iFile) << " cannot be packed.");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (mEncoding != Quantizer::FLOAT32 && !store.quantize(mEncoding))
+	{
+		LOG_ERROR("Fatal Error: The signatures cannot be encoded as " << Quantizer::toString(mEncoding) << ".");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!FeatureCollection::write(store, mCollection->getFile()))
+	{
+		LOG_ERROR("Fatal Error: Collection " << mCollection->getFile() << " cannot be written.");
+		exit(EXIT_FAILURE);
+	}
+
+	double time = (double(cv::getTickCount()) - start) / double(cv::getTickFrequency());
+
+	LOG_INFO("Packed " << store.size() << " signatures with " << store.getRowCount() << " rows (" << Quantizer::toString(mEncoding) << ", "
+		<< store.getMemorySize() << " bytes) into " << mCollection->getFile() << " in " << time << "s");
+}
+
+void trecvid::TRECVidPack::showProgress(std::string _name, int _step, int _total) const
+{
+	cplusutil::Terminal::showProgress(_name + " ", _step + 1, _total);
+}
+
+trecvid::TRECVidPack::~TRECVidPack()
+{
+	delete mFeatures;
+	delete mCollection;
+}
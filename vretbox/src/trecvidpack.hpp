@@ -0,0 +1,59 @@
+#ifndef _TRECVIDPACK_HPP_
+#define  _TRECVIDPACK_HPP_
+
+#include "toolbase.hpp"
+#include <defuse.hpp>
+#include "signaturestore.hpp"
+
+namespace trecvid {
+
+	/**
+	* \brief Merges a directory of feature files into one collection file (see FeatureCollection)
+	*/
+	class TRECVidPack : public vretbox::ToolBase
+	{
+
+		/**
+		* \brief input directory
+		*/
+		Directory* mFeatures;
+
+		/**
+		* \brief output file
+		*/
+		File* mCollection;
+
+		/**
+		* \brief encoding of the signature rows in the collection file
+		*/
+		Quantizer::Encoding mEncoding;
+
+	public:
+
+		/**
+		* \brief
+		*/
+		TRECVidPack();
+
+		/**
+		* \brief
+		* \param _args
+		* \return
+		*/
+		bool init(boost::program_options::variables_map _args) override;
+
+		/**
+		* \brief
+		*/
+		void run() override;
+
+		/**
+		* \brief
+		*/
+		~TRECVidPack() override;
+
+		void showProgress(std::string _name, int _step, int _total) const;
+	};
+}
+
+#endif //_TRECVIDPACK_HPP_
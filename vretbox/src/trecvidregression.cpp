@@ -0,0 +1,376 @@
+#include "trecvidregression.hpp"
+#include "trecvidxtraction.hpp"
+#include "trecvidvaluation.hpp"
+#include "avsfeatures.hpp"
+#include "csvreader.hpp"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <cmath>
+
+trecvid::TRECVidRegression::TRECVidRegression()
+	: mReport(nullptr), mShots(nullptr), mWorkDir(nullptr), mRepetitions(0), mTolerance(0), mAggregateTolerance(0),
+	mSlack(0), mEpsilon(0), mExpectedMAP(-1), mMAPTolerance(0)
+{
+	mArgs = nullptr;
+}
+
+bool trecvid::TRECVidRegression::init(boost::program_options::variables_map _args)
+{
+	mArgs = _args;
+	bool argsValid = true;
+
+	if (!mArgs.count("indir") || !mArgs.count("outfile"))
+	{
+		LOG_ERROR("The master shots (--indir) and the report (--outfile) are required");
+		return false;
+	}
+
+	mShots = new Directory(mArgs["indir"].as<std::string>());
+	mReport = new File(mArgs["outfile"].as<std::string>());
+	mWorkDir = new Directory(mArgs["Cfg.regression.workdir"].as<std::string>());
+
+	mRepetitions = mArgs["Cfg.regression.repetitions"].as<int>();
+	mTolerance = mArgs["Cfg.regression.tolerance"].as<float>();
+	mAggregateTolerance = mArgs["Cfg.regression.aggregatetolerance"].as<float>();
+	mSlack = mArgs["Cfg.regression.slack"].as<float>();
+	mEpsilon = mArgs["Cfg.regression.epsilon"].as<float>();
+	mExpectedMAP = mArgs["Cfg.regression.map"].as<float>();
+	mMAPTolerance = mArgs["Cfg.regression.maptolerance"].as<float>();
+
+	if (mRepetitions < 1)
+	{
+		LOG_ERROR("Cfg.regression.repetitions must be positive");
+		argsValid = false;
+	}
+
+	if (mTolerance < 1 || mAggregateTolerance < 1 || mSlack < 0)
+	{
+		LOG_ERROR("Cfg.regression.tolerance and Cfg.regression.aggregatetolerance must be at least 1, Cfg.regression.slack must not be negative");
+		argsValid = false;
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(mWorkDir->getPath(), error);
+	if (error)
+	{
+		LOG_ERROR("Cfg.regression.workdir " << mWorkDir->getPath() << " cannot be created: " << error.message());
+		argsValid = false;
+	}
+
+	return argsValid;
+}
+
+void trecvid::TRECVidRegression::run()
+{
+	std::string xtractorID;
+	std::map<std::string, std::vector<double>> measured;
+
+	if (!runXtraction(xtractorID, measured) || measured.empty())
+	{
+		addCheck("xtraction", mShots->getPath(), 0, 0, 0, FAIL);
+	}
+	else
+	{
+		//the baseline is named like the measurements of the same settings
+		std::string baselineName = mArgs["Cfg.regression.baseline"].as<std::string>();
+		File baselineFile(baselineName.empty() ? mArgs["General.measurements"].as<std::string>() : baselineName);
+		baselineFile.extendFileName(xtractorID);
+
+		std::map<std::string, std::vector<double>> baseline;
+		if (readTimes(baselineFile.getFile(), baseline))
+		{
+			compareTimes(baseline, measured);
+		}
+		else
+		{
+			LOG_INFO("No baseline " << baselineFile.getFile() << ", the extraction times are not compared");
+			addCheck("total time", baselineFile.getFilename(), 0, 0, 0, SKIP);
+		}
+
+		if (!mArgs["Cfg.regression.signatures"].as<std::string>().empty())
+		{
+			compareSignatures(xtractorID, measured);
+		}
+	}
+
+	if (mArgs.count("infile") && !mArgs["Cfg.regression.model"].as<std::string>().empty())
+	{
+		runValuation();
+	}
+
+	if (!writeReport())
+	{
+		exit(EXIT_FAILURE);
+	}
+}
+
+trecvid::TRECVidRegression::~TRECVidRegression()
+{
+	delete mReport;
+	delete mShots;
+	delete mWorkDir;
+}
+
+bool trecvid::TRECVidRegression::runXtraction(std::string& _xtractorID, std::map<std::string, std::vector<double>>& _times)
+{
+	//batch mode with one worker, so that the times are comparable with the times of single extractions
+	boost::program_options::variables_map args = mArgs;
+	args.erase("msbfile");
+	args.erase("filelist");
+	setArgument(args, "indir", mArgs["indir"].as<std::string>());
+	setArgument(args, "outfile", mWorkDir->getPath());
+	setArgument(args, "General.measurements", File(mWorkDir->getPath(), "xtraction-times.csv").getFile());
+	setArgument(args, "General.threads", 1);
+	setArgument(args, "General.cache", false);
+
+	std::string timesFile;
+	for (int iRun = 0; iRun < mRepetitions; iRun++)
+	{
+		LOG_INFO("**** " << "Regression extraction " << iRun + 1 << " of " << mRepetitions);
+
+		TRECVidXtraction xtraction;
+		if (!xtraction.init(args))
+		{
+			LOG_ERROR("The extraction cannot be initialized");
+			return false;
+		}
+
+		if (iRun == 0)
+		{
+			_xtractorID = xtraction.getXtractorID();
+			timesFile = xtraction.getXtractionTimes()->getFile();
+			boost::filesystem::remove(timesFile);
+
+			File features(mWorkDir->getPath(), "features.bin");
+			features.addDirectoryToPath(_xtractorID);
+			boost::filesystem::create_directories(boost::filesystem::path(features.getFile()).parent_path());
+		}
+
+		xtraction.run();
+	}
+
+	return readTimes(timesFile, _times);
+}
+
+void trecvid::TRECVidRegression::compareTimes(const std::map<std::string, std::vector<double>>& _baseline, const std::map<std::string, std::vector<double>>& _measured)
+{
+	double baselineSum = 0;
+	double measuredSum = 0;
+	int compared = 0;
+
+	for (auto iShot = _measured.begin(); iShot != _measured.end(); ++iShot)
+	{
+		double measured = getMedian((*iShot).second);
+
+		auto baseline = _baseline.find((*iShot).first);
+		if (baseline == _baseline.end())
+		{
+			addCheck("time", (*iShot).first, 0, measured, 0, SKIP);
+			continue;
+		}
+
+		//repeated baseline times of a shot show its noise, the limit is at least the slowest of them
+		const std::vector<double>& times = (*baseline).second;
+		double median = getMedian(times);
+		double spread = *std::max_element(times.begin(), times.end()) - *std::min_element(times.begin(), times.end());
+		double limit = std::max(median * mTolerance, median + spread) + mSlack;
+
+		addCheck("time", (*iShot).first, median, measured, limit, measured <= limit ? PASS : FAIL);
+
+		baselineSum += median;
+		measuredSum += measured;
+		compared++;
+	}
+
+	//a baseline of other shots does not check anything, it has to be measured on the same shots
+	if (compared == 0)
+	{
+		LOG_ERROR("No extracted shot is in the baseline, the baseline has to be measured on the shots of " << mArgs["indir"].as<std::string>());
+		addCheck("total time", "no shot of the baseline", 0, measuredSum, 0, FAIL);
+		return;
+	}
+
+	double limit = baselineSum * mAggregateTolerance + mSlack;
+	addCheck("total time", std::to_string(compared) + " shots", baselineSum, measuredSum, limit, measuredSum <= limit ? PASS : FAIL);
+}
+
+void trecvid::TRECVidRegression::compareSignatures(std::string _xtractorID, const std::map<std::string, std::vector<double>>& _measured)
+{
+	std::string signatures = mArgs["Cfg.regression.signatures"].as<std::string>();
+
+	for (auto iShot = _measured.begin(); iShot != _measured.end(); ++iShot)
+	{
+		std::string name = boost::filesystem::path((*iShot).first).stem().string();
+
+		File reference(signatures, name + ".yml");
+		if (!boost::filesystem::exists(reference.getFile()))
+		{
+			addCheck("signature", name, 0, 0, mEpsilon, SKIP);
+			continue;
+		}
+
+		cv::Mat expected;
+		cv::FileStorage fs(reference.getFile(), cv::FileStorage::READ);
+		fs["Data"][0]["Features"] >> expected;
+		fs.release();
+
+		File extracted(mWorkDir->getPath(), name + ".bin");
+		extracted.addDirectoryToPath(_xtractorID);
+
+		AVSFeatures features;
+		features.deserialize(extracted.getFile());
+
+		//a different number of centroids or columns is a failure of its own
+		double difference = std::numeric_limits<double>::infinity();
+		if (!expected.empty() && expected.size() == features.mVectors.size())
+		{
+			cv::Mat values;
+			expected.convertTo(values, features.mVectors.type());
+			difference = cv::norm(values, features.mVectors, cv::NORM_INF);
+		}
+		else
+		{
+			LOG_ERROR("Signature of " << name << " has " << features.mVectors.rows << "x" << features.mVectors.cols
+				<< " values instead of " << expected.rows << "x" << expected.cols);
+		}
+
+		addCheck("signature", name, 0, difference, mEpsilon, difference <= mEpsilon ? PASS : FAIL);
+	}
+}
+
+void trecvid::TRECVidRegression::runValuation()
+{
+	boost::program_options::variables_map args = mArgs;
+	setArgument(args, "indir", mArgs["Cfg.regression.model"].as<std::string>());
+
+	TRECVidValuation valuation;
+	std::unordered_map<int, std::vector<int>> queries;
+	if (!valuation.init(args) || !valuation.loadModel(queries))
+	{
+		LOG_ERROR("The valuation of the model " << mArgs["Cfg.regression.model"].as<std::string>() << " cannot be initialized");
+		addCheck("valuation", mArgs["infile"].as<std::string>(), 0, 0, 0, FAIL);
+		return;
+	}
+	valuation.prepareSignatures();
+
+	std::vector<double> times;
+	for (int iRun = 0; iRun < mRepetitions; iRun++)
+	{
+		double start = double(cv::getTickCount());
+		valuation.evaluate(queries);
+		times.push_back((double(cv::getTickCount()) - start) / cv::getTickFrequency());
+	}
+
+	//there is no stored valuation time, the time is reported only
+	addCheck("valuation time", mArgs["infile"].as<std::string>(), 0, getMedian(times), 0, SKIP);
+
+	double map = valuation.getMeanAveragePrecision();
+	if (mExpectedMAP < 0)
+	{
+		addCheck("map", mArgs["infile"].as<std::string>(), 0, map, 0, SKIP);
+	}
+	else
+	{
+		addCheck("map", mArgs["infile"].as<std::string>(), mExpectedMAP, map, mMAPTolerance,
+			std::abs(map - mExpectedMAP) <= mMAPTolerance ? PASS : FAIL);
+	}
+}
+
+void trecvid::TRECVidRegression::addCheck(std::string _type, std::string _name, double _baseline, double _measured, double _limit, Result _result)
+{
+	Check check;
+	check.mType = _type;
+	check.mName = _name;
+	check.mBaseline = _baseline;
+	check.mMeasured = _measured;
+	check.mLimit = _limit;
+	check.mResult = _result;
+	mChecks.push_back(check);
+
+	if (_result == FAIL)
+	{
+		LOG_ERROR("Regression " << _type << " of " << _name << " failed: " << _measured << " (baseline " << _baseline << ", limit " << _limit << ")");
+	}
+}
+
+bool trecvid::TRECVidRegression::writeReport() const
+{
+	int counts[3] = { 0, 0, 0 };
+
+	std::ofstream of(mReport->getFile(), std::ofstream::out | std::ofstream::trunc);
+	of << "check,name,baseline,measured,limit,result" << "\n";
+	for (int iCheck = 0; iCheck < mChecks.size(); iCheck++)
+	{
+		const Check& check = mChecks.at(iCheck);
+		of << check.mType << "," << check.mName << "," << check.mBaseline << "," << check.mMeasured << ","
+			<< check.mLimit << "," << toString(check.mResult) << "\n";
+		counts[check.mResult]++;
+	}
+
+	bool passed = counts[FAIL] == 0;
+	of << "result,all,,,," << toString(passed ? PASS : FAIL) << "\n";
+	of.close();
+
+	LOG_INFO("**** " << "Regression " << toString(passed ? PASS : FAIL) << ": " << counts[PASS] << " checks passed, "
+		<< counts[FAIL] << " failed, " << counts[SKIP] << " skipped (" << mReport->getFile() << ")");
+	return passed;
+}
+
+bool trecvid::TRECVidRegression::readTimes(std::string _file, std::map<std::string, std::vector<double>>& _times)
+{
+	if (!boost::filesystem::exists(_file))
+	{
+		return false;
+	}
+
+	CSVReader reader;
+	if (!reader.open(_file))
+	{
+		return false;
+	}
+
+	while (reader.next())
+	{
+		if (reader.size() < 2)
+		{
+			LOG_ERROR("Extraction time in line " << reader.getLine() << " of " << _file << " is skipped");
+			continue;
+		}
+
+		_times[reader.getString(0)].push_back(std::atof(reader.getString(1).c_str()));
+	}
+	return true;
+}
+
+double trecvid::TRECVidRegression::getMedian(std::vector<double> _values)
+{
+	if (_values.empty())
+	{
+		return 0;
+	}
+
+	std::sort(_values.begin(), _values.end());
+	size_t middle = _values.size() / 2;
+	return _values.size() % 2 == 1 ? _values[middle] : (_values[middle - 1] + _values[middle]) / 2;
+}
+
+void trecvid::TRECVidRegression::setArgument(boost::program_options::variables_map& _args, std::string _name, const boost::any& _value)
+{
+	_args.erase(_name);
+	_args.insert(std::make_pair(_name, boost::program_options::variable_value(_value, false)));
+}
+
+std::string trecvid::TRECVidRegression::toString(Result _result)
+{
+	switch (_result)
+	{
+	case PASS:
+		return "PASS";
+	case FAIL:
+		return "FAIL";
+	default:
+		return "SKIP";
+	}
+}
@@ -0,0 +1,180 @@
+#ifndef _TRECVIDREGRESSION_HPP_
+#define  _TRECVIDREGRESSION_HPP_
+
+#include "toolbase.hpp"
+#include <defuse.hpp>
+#include <boost/any.hpp>
+#include <vector>
+#include <string>
+#include <map>
+
+namespace trecvid {
+
+	/**
+	* \brief Performance regression of the extraction and the valuation.
+	* The master shots (--indir) are extracted Cfg.regression.repetitions times with the Cfg.ffs settings; the median
+	* extraction time of each shot is compared with the stored extraction times of the same xtractor ID
+	* (<General.measurements>_<xtractor ID>.csv), whose spread widens the limit. The signatures are compared with the
+	* stored .yml signatures (Cfg.regression.signatures) and the ground truth (--infile) is evaluated with the stored
+	* model (Cfg.regression.model). All checks are written to a pass/fail report (--outfile); a failed check ends the tool with an error.
+	*/
+	class TRECVidRegression : public vretbox::ToolBase
+	{
+
+	public:
+
+		enum Result
+		{
+			PASS,
+			FAIL,
+			SKIP
+		};
+
+		/**
+		* \brief One line of the report
+		*/
+		struct Check
+		{
+			std::string mType;
+
+			std::string mName;
+
+			double mBaseline;
+
+			double mMeasured;
+
+			double mLimit;
+
+			Result mResult;
+		};
+
+	private:
+
+		/**
+		* \brief pass/fail report
+		*/
+		File* mReport;
+
+		/**
+		* \brief master shots to be extracted
+		*/
+		Directory* mShots;
+
+		/**
+		* \brief features and extraction times of the runs
+		*/
+		Directory* mWorkDir;
+
+		int mRepetitions;
+
+		/**
+		* \brief factor of the baseline median that a shot may take
+		*/
+		double mTolerance;
+
+		/**
+		* \brief factor of the baseline sum that all shots may take
+		*/
+		double mAggregateTolerance;
+
+		/**
+		* \brief seconds added to each limit, short shots are dominated by the timer and the file system
+		*/
+		double mSlack;
+
+		/**
+		* \brief maximal absolute difference of a signature value
+		*/
+		double mEpsilon;
+
+		/**
+		* \brief expected mean average precision of the stored model (negative = not checked)
+		*/
+		double mExpectedMAP;
+
+		double mMAPTolerance;
+
+		std::vector<Check> mChecks;
+
+	public:
+
+		/**
+		* \brief
+		*/
+		TRECVidRegression();
+
+		/**
+		* \brief
+		* \param _args
+		* \return
+		*/
+		bool init(boost::program_options::variables_map _args) override;
+
+		/**
+		* \brief
+		*/
+		void run() override;
+
+		/**
+		* \brief
+		*/
+		~TRECVidRegression() override;
+
+		/**
+		* \brief Extracts the master shots in batch mode with one worker and without the manifest
+		* \param _xtractorID
+		* \param _times extraction times of each shot name
+		* \return false if the extraction cannot be initialized
+		*/
+		bool runXtraction(std::string& _xtractorID, std::map<std::string, std::vector<double>>& _times);
+
+		/**
+		* \brief Compares the median extraction time of each shot and their sum with the baseline
+		* \param _baseline
+		* \param _measured
+		*/
+		void compareTimes(const std::map<std::string, std::vector<double>>& _baseline, const std::map<std::string, std::vector<double>>& _measured);
+
+		/**
+		* \brief Compares the extracted signatures with the stored .yml signatures of the same name
+		* \param _xtractorID
+		* \param _measured names of the extracted shots
+		*/
+		void compareSignatures(std::string _xtractorID, const std::map<std::string, std::vector<double>>& _measured);
+
+		/**
+		* \brief Evaluates the ground truth with the stored model Cfg.regression.repetitions times
+		*/
+		void runValuation();
+
+		void addCheck(std::string _type, std::string _name, double _baseline, double _measured, double _limit, Result _result);
+
+		/**
+		* \brief Writes and logs the report
+		* \return true if no check failed
+		*/
+		bool writeReport() const;
+
+		/**
+		* \brief Reads extraction times (<shot>, <seconds>[, <stage times>] per line), a shot may have several times
+		* \param _file
+		* \param _times
+		* \return false if the file cannot be read
+		*/
+		static bool readTimes(std::string _file, std::map<std::string, std::vector<double>>& _times);
+
+		static double getMedian(std::vector<double> _values);
+
+		/**
+		* \brief Replaces an argument of a tool that is run by the regression
+		* \param _args
+		* \param _name
+		* \param _value
+		*/
+		static void setArgument(boost::program_options::variables_map& _args, std::string _name, const boost::any& _value);
+
+		static std::string toString(Result _result);
+	};
+}
+
+#endif //_TRECVIDREGRESSION_HPP_
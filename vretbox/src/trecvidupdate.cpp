@@ -1,6 +1,5 @@
 #include "trecvidupdate.hpp"
-#include "avsquery.hpp"
-#include "mastershot.hpp"
+#include "csvreader.hpp"
 
 trecvid::TRECVidUpdate::TRECVidUpdate()
 	: mGroundTruth(nullptr), mMasterShots(nullptr), mUpdatedGroundTruth(nullptr)
@@ -38,118 +37,127 @@ bool trecvid::TRECVidUpdate::init(boost::program_options::variables_map _args)
 
 void trecvid::TRECVidUpdate::run()
 {
-	int qid, vid, sid;
-	std::list<trecvid::AVSQuery*> queries;
-	std::list<trecvid::MasterShot*> shots;
+	double start = double(cv::getTickCount());
 
-	//faster as ifstream
-	FILE *file = fopen(mGroundTruth->getFile().c_str(), "r");
-	while(fscanf(file, "%d,%d,%d", &qid, &vid, &sid) == 3)
+	std::unordered_set<uint64_t> shots;
+	if (!readFilteredShots(mMasterShots->getFile(), shots))
 	{
-		AVSQuery *query = new AVSQuery(qid, vid, sid);
-		queries.push_back(query);
+		LOG_ERROR("Fatal Error: Master shots " << mMasterShots->getFile() << " cannot be read.");
+		exit(EXIT_FAILURE);
 	}
-	fclose(file);
+	LOG_INFO("Found " << shots.size() << " shots");
 
-	char srvid[256],filename[256], xtractorid[256];
-	int startframe, endframe, widht, height;
-	float fps, length;
-	int filter;
+	int kept = 0, removed = 0;
+	if (!filterGroundTruth(mGroundTruth->getFile(), shots, mUpdatedGroundTruth->getFile(), kept, removed))
+	{
+		LOG_ERROR("Fatal Error: Ground truth " << mUpdatedGroundTruth->getFile() << " cannot be written.");
+		exit(EXIT_FAILURE);
+	}
+
+	LOG_INFO("Found " << kept + removed << " queries");
+	LOG_INFO("found " << removed << " shots in query list");
+	LOG_INFO("Ground truth updated in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency()) << "s");
+}
 
-	file = fopen(mMasterShots->getFile().c_str(), "r");
+uint64_t trecvid::TRECVidUpdate::getShotKey(int _vid, int _sid)
+{
+	return (uint64_t(uint32_t(_vid)) << 32) | uint64_t(uint32_t(_sid));
+}
 
-	//fscanf awaits a whitespace terminated string when it tries to read %s
-	while (fscanf(file, "%[^,],%[^,],%[^,],%d,%d,%d,%d,%f,%d,%d,%f,%d", srvid, filename, xtractorid, &vid, &sid, &startframe, &endframe, &fps, &widht, &height, &length, &filter) == 12)
+bool trecvid::TRECVidUpdate::readFilteredShots(std::string _file, std::unordered_set<uint64_t>& _shots)
+{
+	CSVReader reader;
+	if (!reader.open(_file))
 	{
-		//remove all shots with less than x, which is indicated by filter=true
-		if(filter == true)
+		return false;
+	}
+
+	int invalid = 0;
+	while (reader.next())
+	{
+		int vid, sid, filter;
+		if (!reader.getInt(3, vid) || !reader.getInt(4, sid) || !reader.getInt(11, filter))
 		{
-			trecvid::MasterShot *shot = new trecvid::MasterShot(vid, sid, startframe, endframe, fps, widht, height);
-			shots.push_back(shot);
+			//the first invalid line is reported, the others are counted
+			if (invalid == 0)
+			{
+				LOG_ERROR("Master shots " << _file << ": line " << reader.getLine() << " is invalid and skipped");
+			}
+			invalid++;
+			continue;
 		}
 
+		//remove all shots with less than x, which is indicated by filter=true
+		if (filter != 0)
+		{
+			_shots.insert(getShotKey(vid, sid));
+		}
 	}
-	fclose(file);
-
-	LOG_INFO("Found " << queries.size() << " queries");
-	LOG_INFO("Found " << shots.size() << " shots");
-
-	updateQueryList(&shots,&queries);
 
+	if (invalid > 0)
+	{
+		LOG_ERROR("Master shots " << _file << ": " << invalid << " invalid lines were skipped");
+	}
+	return true;
+}
 
-	writeQueryList(&queries, mUpdatedGroundTruth->getFile());
+bool trecvid::TRECVidUpdate::filterGroundTruth(std::string _groundTruth, const std::unordered_set<uint64_t>& _shots, std::string _file, int& _kept, int& _removed)
+{
+	_kept = 0;
+	_removed = 0;
 
-	std::list<trecvid::AVSQuery*>::iterator itqeueries;
-	for(itqeueries = queries.begin(); itqeueries != queries.end(); ++itqeueries)
+	CSVReader reader;
+	if (!reader.open(_groundTruth))
 	{
-		AVSQuery* entry = *itqeueries;
-		delete entry;
+		return false;
 	}
-	queries.clear();
 
-	std::list<trecvid::MasterShot*>::iterator itshots;
-	for (itshots = shots.begin(); itshots != shots.end(); ++itshots)
+	FILE *file = fopen(_file.c_str(), "w");
+	if (file == nullptr)
 	{
-		MasterShot* entry = *itshots;
-		delete entry;
+		return false;
 	}
-	shots.clear();
 
-}
+	//the entries are collected in a buffer that is written in large blocks
+	std::string buffer;
+	buffer.reserve(1 << 20);
+	bool isWritten = true;
 
-void trecvid::TRECVidUpdate::updateQueryList(
-	std::list<trecvid::MasterShot*>* _shots, std::list<trecvid::AVSQuery*>* _queries)
-{
-	std::list<trecvid::AVSQuery*> _updatedQueries;
-	_queries->sort([](const AVSQuery* f, const AVSQuery* s) {return f->mVid < s->mVid; });
-	_shots->sort([](const MasterShot* f, const MasterShot* s) {return f->mVid < s->mVid; });
-
-	std::list<trecvid::MasterShot*>::iterator itshots;
-	int progress = 1;
-	int lenght = _shots->size();
-	int counter = 0;
-	for (itshots = _shots->begin(); itshots != _shots->end(); ++itshots)
+	while (reader.next())
 	{
-		cplusutil::Terminal::showProgress("Update QueryList: ", progress, lenght);
-		progress++;
-
-		AVSQuery* findelem = new AVSQuery((*itshots)->mVid, (*itshots)->mSid);
-
-		std::list<AVSQuery*>::iterator matching = find_if(_queries->begin(), _queries->end(), [&findelem](const AVSQuery* q)
+		int qid, vid, sid;
+		if (!reader.getInt(0, qid) || !reader.getInt(1, vid) || !reader.getInt(2, sid))
 		{
-			return (findelem->mVid == q->mVid) && (findelem->mSid == q->mSid);
-		});
+			LOG_ERROR("Ground truth " << _groundTruth << ": line " << reader.getLine() << " is invalid and skipped");
+			continue;
+		}
 
-		if(matching != _queries->end())
+		//a filtered shot is removed from every query it belongs to
+		if (_shots.count(getShotKey(vid, sid)) != 0)
 		{
-			auto index = std::distance(_queries->begin(), matching);
-			counter++;
-			_queries->erase(matching);
+			_removed++;
+			continue;
 		}
-		
-	}
-
-	LOG_INFO("found " << counter << " shots in query list");
-}
 
-bool trecvid::TRECVidUpdate::writeQueryList(std::list<trecvid::AVSQuery*>* _queries, std::string _file)
-{
-	bool successful = false;
-	FILE *file = fopen(_file.c_str(), "w");
+		buffer += std::to_string(qid);
+		buffer += ',';
+		buffer += std::to_string(vid);
+		buffer += ',';
+		buffer += std::to_string(sid);
+		buffer += '\n';
+		_kept++;
 
-	if(file != nullptr)
-	{
-		std::list<trecvid::AVSQuery*>::iterator itqeueries;
-		for (itqeueries = _queries->begin(); itqeueries != _queries->end(); ++itqeueries)
+		if (buffer.size() >= (1 << 20))
 		{
-			fprintf(file, "%d,%d,%d\n", (*itqeueries)->mQid, (*itqeueries)->mVid, (*itqeueries)->mSid);
+			isWritten = isWritten && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+			buffer.clear();
 		}
-
-		fclose(file);
-		successful = true;
 	}
-	
-	return successful;
+
+	isWritten = isWritten && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	isWritten = fclose(file) == 0 && isWritten;
+
+	return isWritten;
 }
 
 void trecvid::TRECVidUpdate::showProgress(std::string _name, int _step, int _total) const
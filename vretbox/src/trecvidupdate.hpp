@@ -3,13 +3,13 @@
 
 #include "toolbase.hpp"
 #include <defuse.hpp>
-#include "mastershot.hpp"
-#include "avsquery.hpp"
+#include <unordered_set>
+#include <cstdint>
 
 namespace trecvid {
 
 	/**
-	* \brief
+	* \brief Removes the shots that are marked by the filter column of the master shots from the ground truth
 	*/
 	class TRECVidUpdate : public vretbox::ToolBase
 	{
@@ -53,9 +53,32 @@ namespace trecvid {
 		*/
 		~TRECVidUpdate() override;
 
-		static void updateQueryList(std::list<trecvid::MasterShot*>* _shots, std::list<trecvid::AVSQuery*>* _queries);
+		/**
+		* \brief
+		* \param _vid video id
+		* \param _sid shot id
+		* \return key of a shot in the set of filtered shots
+		*/
+		static uint64_t getShotKey(int _vid, int _sid);
+
+		/**
+		* \brief Reads the master shots (srvid,filename,xtractorid,vid,sid,start,end,fps,width,height,length,filter)
+		* \param _file master shot file
+		* \param _shots filled with the keys of the shots whose filter is set
+		* \return false if the file cannot be read
+		*/
+		static bool readFilteredShots(std::string _file, std::unordered_set<uint64_t>& _shots);
 
-		static bool writeQueryList(std::list<trecvid::AVSQuery*>* _queries, std::string _file);
+		/**
+		* \brief Streams the ground truth (qid,vid,sid) into a new file without the filtered shots, in the order of the input
+		* \param _groundTruth input file
+		* \param _shots keys of the filtered shots
+		* \param _file output file
+		* \param _kept number of written entries
+		* \param _removed number of removed entries
+		* \return false if a file cannot be read or written
+		*/
+		static bool filterGroundTruth(std::string _groundTruth, const std::unordered_set<uint64_t>& _shots, std::string _file, int& _kept, int& _removed);
 
 		void showProgress(std::string _name, int _step, int _total) const;
 
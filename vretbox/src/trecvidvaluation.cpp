@@ -21,6 +21,13 @@
 #include "avsfeatures.hpp"
 #include <unordered_map>
 #include <boost/thread/thread.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <sstream>
+#include <cmath>
+#include <memory>
+#include <functional>
 
 
 /**
@@ -55,12 +62,135 @@ namespace std
 	};
 }
 
+/**
+ * \brief Limits of a request of the daemon mode, a longer request or a larger signature is rejected
+ */
+const size_t MAX_REQUEST_SIZE = 1 << 20;
+const int MAX_SIGNATURE_ROWS = 4096;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+/**
+ * \brief Connection of the daemon mode. All connections are read asynchronously by the thread of the daemon,
+ * so an idle client does not block the others; it is closed if it neither sends a request nor reads its reply in time.
+ */
+class DaemonSession : public std::enable_shared_from_this<DaemonSession>
+{
+public:
+
+	/**
+	 * \brief Answers a request, the flag is set by a shutdown request
+	 */
+	typedef std::function<std::string(const std::string&, bool&)> Handler;
+
+	DaemonSession(boost::asio::io_service& _service, Handler _handler, int _timeout)
+		: mService(_service), mSocket(_service), mTimer(_service), mBuffer(MAX_REQUEST_SIZE), mHandler(_handler), mTimeout(_timeout), mShutdown(false)
+	{
+	}
+
+	boost::asio::local::stream_protocol::socket& getSocket()
+	{
+		return mSocket;
+	}
+
+	/**
+	 * \brief Reads the next request, answers it and writes the reply
+	 */
+	void read()
+	{
+		std::shared_ptr<DaemonSession> self = shared_from_this();
+		expire();
+		boost::asio::async_read_until(mSocket, mBuffer, '\n', [self](const boost::system::error_code& _error, size_t)
+		{
+			self->mTimer.cancel();
+			if (_error)
+			{
+				//the client closed the connection, the request is too long or the connection timed out
+				return;
+			}
+
+			std::istream stream(&self->mBuffer);
+			std::string request;
+			std::getline(stream, request);
+			self->mReply = self->mHandler(request, self->mShutdown);
+			self->write();
+		});
+	}
+
+private:
+
+	boost::asio::io_service& mService;
+
+	boost::asio::local::stream_protocol::socket mSocket;
+
+	boost::asio::deadline_timer mTimer;
+
+	boost::asio::streambuf mBuffer;
+
+	std::string mReply;
+
+	Handler mHandler;
+
+	int mTimeout;
+
+	bool mShutdown;
+
+	void write()
+	{
+		std::shared_ptr<DaemonSession> self = shared_from_this();
+		expire();
+		boost::asio::async_write(mSocket, boost::asio::buffer(mReply), [self](const boost::system::error_code& _error, size_t)
+		{
+			self->mTimer.cancel();
+			if (_error)
+			{
+				LOG_ERROR("Error: Reply cannot be sent: " << _error.message());
+				return;
+			}
+
+			if (self->mShutdown)
+			{
+				//the shutdown is confirmed, the other connections are dropped
+				self->mService.stop();
+				return;
+			}
+			self->read();
+		});
+	}
+
+	/**
+	 * \brief Closes the connection after the timeout unless the pending read or write is finished before
+	 */
+	void expire()
+	{
+		std::shared_ptr<DaemonSession> self = shared_from_this();
+		mTimer.expires_from_now(boost::posix_time::seconds(mTimeout));
+		mTimer.async_wait([self](const boost::system::error_code& _error)
+		{
+			if (!_error)
+			{
+				boost::system::error_code ignored;
+				self->mSocket.close(ignored);
+			}
+		});
+	}
+};
+#endif
+
 trecvid::TRECVidValuation::TRECVidValuation()
-	: mDistance(nullptr), mXtractor(nullptr), mFeatures(nullptr), mGroundTruth(nullptr), mMAPValues(nullptr)
+	: mDistance(nullptr), mSQFD(nullptr), mPruning(false), mXtractor(nullptr), mFeatures(nullptr), mCollectionFile(nullptr), mGroundTruth(nullptr), mMAPValues(nullptr), mPool(nullptr), mSymmetric(false)
 {
 	mArgs = nullptr;
 	mAVGMeanAverageComputationTime = 0.0;
 	mAVGMeanAveragePrecision = 0.0;
+	mThreads = 0;
+	mChunkSize = 0;
+	mTopK = 0;
+	mTimeout = 0;
+	mPivots = 0;
+	mEncoding = Quantizer::FLOAT32;
+	mBaseline = false;
+	mEvaluatedQueries = 0;
+	mQueryCount = 0;
 }
 
 bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args)
@@ -69,8 +199,30 @@ bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args
 	bool areArgsValid = true;
 
 	mGroundTruth = new File(mArgs["infile"].as< std::string >());
-	mFeatures = new Directory(mArgs["indir"].as< std::string >());
-	mMAPValues = new File(mArgs["outfile"].as< std::string >());
+
+	//a packed collection file is mapped, otherwise each feature file of the directory is read
+	std::string indir = mArgs["indir"].as< std::string >();
+	if (boost::filesystem::is_regular_file(indir))
+	{
+		mCollectionFile = new File(indir);
+		mFeatureSetName = mCollectionFile->getFilename();
+	}
+	else
+	{
+		mFeatures = new Directory(indir);
+		mFeatureSetName = mFeatures->mDirName;
+	}
+	//the daemon mode writes no csv template
+	mSocket = mArgs["Cfg.valuation.socket"].as<std::string>();
+	if (mArgs.count("outfile"))
+	{
+		mMAPValues = new File(mArgs["outfile"].as< std::string >());
+	}
+	else if (mSocket.empty())
+	{
+		LOG_FATAL("The csv template (--outfile) is missing");
+		return false;
+	}
 
 	defuse::Parameter* paramter = nullptr;
 	int grounddistance;
@@ -78,6 +230,7 @@ bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args
 	int direction;
 	int costfunction;
 	float lambda;
+	std::string settings;
 
 
 	if (mArgs["General.distance"].as< std::string >() == "smd")
@@ -147,10 +300,66 @@ bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args
 		static_cast<defuse::SMDParamter *>(paramter)->cost = costfunction;
 		static_cast<defuse::SMDParamter *>(paramter)->lambda = lambda;
 
+		mDistance = new defuse::SMD(paramter, defuse::DYSIGXtractor::as_integer(defuse::DYSIGXtractor::IDX::WEIGHT), -1);
+		settings = paramter->get();
+		mSymmetric = direction == 0;
+
+	}else if (mArgs["General.distance"].as< std::string >() == "sqfd")
+	{
+		float Lp;
+		SQFDistance::SimilarityType similarity;
+
+		if (mArgs["Cfg.sqfd.grounddistance"].as<std::string>() == "L1")
+		{
+			Lp = 1.0;
+		}
+		else if (mArgs["Cfg.sqfd.grounddistance"].as<std::string>() == "L2")
+		{
+			Lp = 2.0;
+		}
+		else
+		{
+			Lp = 2.0;
+			LOG_FATAL("Cfg.sqfd.grounddistance " << mArgs["Cfg.sqfd.grounddistance"].as< std::string >() << " is not defined");
+			areArgsValid = false;
+		}
+
+		if (mArgs["Cfg.sqfd.similarity"].as<std::string>() == "heuristic")
+		{
+			similarity = SQFDistance::HEURISTIC;
+		}
+		else if (mArgs["Cfg.sqfd.similarity"].as<std::string>() == "minus")
+		{
+			similarity = SQFDistance::MINUS;
+		}
+		else
+		{
+			similarity = SQFDistance::HEURISTIC;
+			LOG_FATAL("Cfg.sqfd.similarity " << mArgs["Cfg.sqfd.similarity"].as< std::string >() << " is not defined");
+			areArgsValid = false;
+		}
+
+		//the policies read the weight of a centroid from the column of the pct signatures
+		if (defuse::DYSIGXtractor::as_integer(defuse::DYSIGXtractor::IDX::WEIGHT) != cv::xfeatures2d::pct_signatures::WEIGHT_IDX)
+		{
+			LOG_FATAL("General.distance sqfd requires the weight of a centroid in column " << cv::xfeatures2d::pct_signatures::WEIGHT_IDX);
+			areArgsValid = false;
+		}
+
+		mSQFD = new SQFDistance(similarity, Lp, mArgs["Cfg.sqfd.alpha"].as<float>());
+		settings = mSQFD->toString();
+		mSymmetric = true;
+
+		mPruning = mArgs["Cfg.valuation.pruning"].as<bool>();
+		if (mPruning && !mSQFD->hasLowerBound())
+		{
+			LOG_INFO("Cfg.valuation.pruning is ignored, the lower bound requires the heuristic similarity with L1 or L2 and alpha > 0");
+			mPruning = false;
+		}
 	}else 
 	{
 		LOG_FATAL("Distance " << mArgs["General.distance"].as< std::string >() << " is not defined");
-		areArgsValid = false;
+		return false;
 	}
 
 	time_t now = time(nullptr);
@@ -158,7 +367,7 @@ bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args
 	strftime(name, sizeof(name), "%Y%m%d_%H%M%S", localtime(&now));
 
 	std::stringstream logfile;
-	logfile << paramter->getFilename() << "_" << mFeatures->mDirName << "_Evaluation" << ".log";
+	logfile << (paramter != nullptr ? paramter->getFilename() : settings) << "_" << mFeatureSetName << "_Evaluation" << ".log";
 	Directory workingdir(".");
 	File log(workingdir.getPath(), logfile.str());
 	log.addDirectoryToPath("logs");
@@ -171,16 +380,72 @@ bool trecvid::TRECVidValuation::init(boost::program_options::variables_map _args
 	LOG_INFO("**** " << "Timestamp " << name);
 	LOG_INFO("**** " << "TRECVidValuation Tool " << "**** ");
 	LOG_INFO("**** " << "Settings");
-	LOG_INFO("**** " << paramter->get());
+	LOG_INFO("**** " << settings);
 	LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
 
+	mDistanceSettings = settings;
 
-	mDistance = new defuse::SMD(paramter, defuse::DYSIGXtractor::as_integer(defuse::DYSIGXtractor::IDX::WEIGHT), -1);
+	mThreads = mArgs["General.threads"].as<int>();
+	mChunkSize = mArgs["Cfg.valuation.chunksize"].as<int>();
+	if (mChunkSize <= 0)
+	{
+		LOG_FATAL("Cfg.valuation.chunksize " << mChunkSize << " must be greater than zero");
+		areArgsValid = false;
+	}
+
+	mTopK = mArgs["Cfg.valuation.topk"].as<int>();
+	if (mTopK < 0)
+	{
+		LOG_FATAL("Cfg.valuation.topk " << mTopK << " must not be negative");
+		areArgsValid = false;
+	}
+
+	mMatrixFile = mArgs["Cfg.valuation.matrix"].as<std::string>();
+
+	mIndexFile = mArgs["Cfg.valuation.index"].as<std::string>();
+	mPivots = mArgs["Cfg.valuation.pivots"].as<int>();
+	if (mPivots <= 0)
+	{
+		LOG_FATAL("Cfg.valuation.pivots " << mPivots << " must be greater than zero");
+		areArgsValid = false;
+	}
+	if (!mIndexFile.empty() && !mPruning)
+	{
+		LOG_INFO("Cfg.valuation.index is ignored, the pivot index requires the sqfd with pruning and the heuristic similarity");
+		mIndexFile.clear();
+	}
+
+	if (!Quantizer::parse(mArgs["Cfg.valuation.encoding"].as<std::string>(), mEncoding))
+	{
+		LOG_FATAL("Cfg.valuation.encoding " << mArgs["Cfg.valuation.encoding"].as<std::string>() << " is not defined");
+		areArgsValid = false;
+	}
+	mBaseline = mArgs["Cfg.valuation.baseline"].as<bool>();
+	if (mBaseline && (mEncoding == Quantizer::FLOAT32 || !mSocket.empty()))
+	{
+		LOG_INFO("Cfg.valuation.baseline is ignored, it requires an encoding of the model and the evaluation of the ground truth");
+		mBaseline = false;
+	}
+
+	int cacheSize = mArgs["Cfg.valuation.cachesize"].as<int>();
+	if (cacheSize < 0)
+	{
+		LOG_FATAL("Cfg.valuation.cachesize " << cacheSize << " must not be negative");
+		areArgsValid = false;
+	}
+	mReplies.setCapacity(std::max(cacheSize, 0));
+
+	mTimeout = mArgs["Cfg.valuation.timeout"].as<int>();
+	if (mTimeout <= 0)
+	{
+		LOG_FATAL("Cfg.valuation.timeout " << mTimeout << " must be greater than zero");
+		areArgsValid = false;
+	}
 
 	return areArgsValid;
 }
 
-void trecvid::TRECVidValuation::run()
+bool trecvid::TRECVidValuation::loadModel(std::unordered_map<int, std::vector<int>>& _queries)
 {
 	int qid, vid, sid;
 
@@ -189,6 +454,11 @@ void trecvid::TRECVidValuation::run()
 
 	//fetch all queries from ground truth
 	FILE *gtfile = fopen(mGroundTruth->getFile().c_str(), "r");
+	if (gtfile == nullptr)
+	{
+		LOG_ERROR("Fatal Error: Ground truth " << mGroundTruth->getFile() << " cannot be opened.");
+		return false;
+	}
 	while (fscanf(gtfile, "%d,%d,%d", &qid, &vid, &sid) == 3)
 	{
 		AVSQuery *query = new AVSQuery(qid, vid, sid);
@@ -202,265 +472,1083 @@ void trecvid::TRECVidValuation::run()
 
 
 	//fetch all features
-	std::vector<std::string> files = cplusutil::FileIO::getFileListFromDirectory(mFeatures->getPath());
+	double loadStart = double(cv::getTickCount());
+	mModel.clear();
+
+	if (mCollectionFile != nullptr)
+	{
+		if (!mCollection.open(mCollectionFile->getFile(), mModel))
+		{
+			LOG_ERROR("Fatal Error: Collection " << mCollectionFile->getFile() << " cannot be opened.");
+			return false;
+		}
+	}
+	else
+	{
+		std::vector<std::string> files = cplusutil::FileIO::getFileListFromDirectory(mFeatures->getPath());
 
-	std::unordered_map<int, std::vector<AVSFeatures*>> queries;
+		int fileSize = files.size();
+		for (int iFile = 0; iFile < fileSize; iFile++)
+		{
+			showProgress("Load features", iFile, fileSize);
+
+			std::string file = files.at(iFile);
+
+			if (mModel.load(file) < 0)
+			{
+				LOG_ERROR("Fatal Error: Feature file " << file << "cannot be deserialized.");
+				return false;
+			}
+		}
+	}
+
+	//add qid if available, otherwise zero id
+	mShotIndex.clear();
+	for (int iElem = 0; iElem < mModel.size(); iElem++)
+	{
+		std::pair<int, int> queryid = std::make_pair(mModel.getVID(iElem), mModel.getSID(iElem));
+		mModel.setQID(iElem, queryindex[queryid]);
+		_queries[mModel.getQID(iElem)].push_back(iElem);
+		mShotIndex.insert(std::make_pair(queryid, iElem));
+	}
+
+	LOG_INFO("Loaded " << mModel.size() << " signatures in " << (double(cv::getTickCount()) - loadStart) / double(cv::getTickFrequency()) << "s");
+	return true;
+}
+
+void trecvid::TRECVidValuation::run()
+{
+	//key is qid; value are the indices of its shots in the model
+	std::unordered_map<int, std::vector<int>> queries;
 
-	int fileSize = files.size();
-	for (int iFile = 0; iFile < fileSize; iFile++)
+	if (!loadModel(queries))
 	{
-		showProgress("Load features", iFile, fileSize);
+		exit(EXIT_FAILURE);
+	}
+
+	if (mSQFD != nullptr && mModel.getDimension() <= cv::xfeatures2d::pct_signatures::WEIGHT_IDX)
+	{
+		LOG_FATAL("Signatures with " << mModel.getDimension() << " columns have no weight for the sqfd");
+		exit(EXIT_FAILURE);
+	}
+
+	//the float model is evaluated first, so that the change of the encoded model can be reported
+	std::vector<std::pair<int, float>> baselineMAPvalues;
+	float baselineMAP = 0.0;
+	if (mBaseline && mModel.isQuantized())
+	{
+		LOG_INFO("Cfg.valuation.baseline is ignored, the collection is stored as " << Quantizer::toString(mModel.getQuantizer().getEncoding()));
+		mBaseline = false;
+	}
+	if (mBaseline)
+	{
+		LOG_INFO("Float baseline of the " << Quantizer::toString(mEncoding) << " evaluation");
+		prepareSignatures();
+		evaluate(queries);
 
-		std::string file = files.at(iFile);
+		baselineMAPvalues = mCollectedMAPvalues;
+		baselineMAP = mAVGMeanAveragePrecision;
+	}
+
+	if (mEncoding != Quantizer::FLOAT32 && mModel.isQuantized())
+	{
+		LOG_INFO("Cfg.valuation.encoding is ignored, the collection is stored as " << Quantizer::toString(mModel.getQuantizer().getEncoding()));
+	}
+	else if (mEncoding != Quantizer::FLOAT32 && !quantizeModel())
+	{
+		exit(EXIT_FAILURE);
+	}
 
-		AVSFeatures* features = new AVSFeatures();
-		features->deserialize(file);
+	if (!mIndexFile.empty())
+	{
+		prepareIndex();
+	}
 
-		if (features->mVectors.empty())
+	prepareSignatures();
+
+	if (!mSocket.empty())
+	{
+		serve();
+		return;
+	}
+
+	if (!mMatrixFile.empty())
+	{
+		prepareMatrix();
+	}
+
+	evaluate(queries);
+
+	appendValuesToCSVTemplate("MAP", mCollectedMAPvalues);
+	appendValuesToCSVTemplate("SMD", mCollectedCompTimes);
+
+	if (mBaseline)
+	{
+		//both evaluations collect the groups in the order of their query id
+		std::vector<std::pair<int, float>> deltas;
+		for (int iGroup = 0; iGroup < mCollectedMAPvalues.size() && iGroup < baselineMAPvalues.size(); iGroup++)
 		{
-			LOG_ERROR("Fatal Error: Feature file " << file << "cannot be deserialized.");
-			exit(EXIT_FAILURE);
+			float delta = mCollectedMAPvalues[iGroup].second - baselineMAPvalues[iGroup].second;
+			deltas.push_back(std::make_pair(mCollectedMAPvalues[iGroup].first, delta));
+			LOG_INFO("Mean Average Precision for group " << mCollectedMAPvalues[iGroup].first << " changes by " << delta
+				<< " from " << baselineMAPvalues[iGroup].second << " (float) to " << mCollectedMAPvalues[iGroup].second << " (" << Quantizer::toString(mEncoding) << ")");
 		}
 
-		//add qid if available, otherwise zero id
-		std::pair<int, int> queryid = std::make_pair(features->mVID, features->mSID);
-		features->mQID = queryindex[queryid];
-		queries[features->mQID].push_back(features);
-		mModel.push_back(features);
+		LOG_INFO("Total Mean Average Precision changes by " << mAVGMeanAveragePrecision - baselineMAP << " from " << baselineMAP
+			<< " (float) to " << mAVGMeanAveragePrecision << " (" << Quantizer::toString(mEncoding) << ")");
+
+		appendValuesToCSVTemplate("MAP float", baselineMAPvalues);
+		appendValuesToCSVTemplate("MAP delta", deltas);
 	}
+}
 
+void trecvid::TRECVidValuation::evaluate(std::unordered_map<int, std::vector<int>>& _queries)
+{
 	float avgMeanAveragePrecision = 0.0;
 	float avgMeanAverageComputationTime = 0.0;
 
-	int querySize = queries.size();
-	int queryCounter = 0;
+	//the values of a previous evaluation are not accumulated
+	mAVGMeanAveragePrecision = 0.0;
+	mAVGMeanAverageComputationTime = 0.0;
+	mCollectedMAPvalues.clear();
+	mCollectedCompTimes.clear();
 
-	//************************************************************************************************
-	//sequential
-	//std::vector<std::pair<int, float>> mapvalues;
-	////evaluate mean average precision for all elements in each query group
-	//for (auto iQueryGroup = queries.begin(); iQueryGroup != queries.end(); ++iQueryGroup)
-	//{
-	//	LOG_INFO("Group " << (*iQueryGroup).first << " size " << ((*iQueryGroup).second).size());
-	//	std::string groupnr = std::to_string((*iQueryGroup).first);
-	//	showProgress(groupnr, queryCounter, querySize);
-	//	queryCounter++;
-
-	//	if((*iQueryGroup).first == 0)
-	//	{
-	//		LOG_INFO("Group 0 is not in the ground truth, evaluation step is skipped.");
-	//		continue;
-	//	}
-
-	//	std::tuple<std::vector<std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>>>, float, float> interim;
-	//	
-	//	interim = evaluate((*iQueryGroup).first, (*iQueryGroup).second);
-	//	avgMeanAveragePrecision += std::get<1>(interim);
-	//	avgMeanAverageComputationTime += std::get<2>(interim);
-
-	//	LOG_INFO("Mean Average Precision for group " << (*iQueryGroup).first << " is " << std::get<1>(interim));
-	//	LOG_INFO("Average computation time for group " << (*iQueryGroup).first << " is " << std::get<2>(interim));
-
-	//	mapvalues.push_back(std::make_pair((*iQueryGroup).first, std::get<1>(interim)));
-	//}
-
-	//appendValuesToCSVTemplate("MAP", mapvalues);
-	//avgMeanAveragePrecision /= float(queries.size());
-	//avgMeanAverageComputationTime /= float(queries.size());
-
-	//LOG_INFO("Total Mean Average Precision for " << queries.size() << " queries is " << avgMeanAveragePrecision);
-	//LOG_INFO("Total Average Computation for " << queries.size() << " queries is " << avgMeanAverageComputationTime << "s");
-	//************************************************************************************************
+	int querySize = _queries.size();
+	int queryCounter = 0;
 
 	//evaluate mean average precision for all elements in each query group
-	std::vector<boost::thread*> threads;
-	for (auto iQueryGroup = queries.begin(); iQueryGroup != queries.end(); ++iQueryGroup)
+	//groups are processed in the order of their query id, so that the reduction is deterministic
+	std::vector<int> groupids;
+	for (auto iQueryGroup = _queries.begin(); iQueryGroup != _queries.end(); ++iQueryGroup)
+	{
+		groupids.push_back((*iQueryGroup).first);
+	}
+	std::sort(groupids.begin(), groupids.end());
+
+	mEvaluatedQueries = 0;
+	mQueryCount = 0;
+	for (int iGroup = 0; iGroup < groupids.size(); iGroup++)
 	{
-		LOG_INFO("Group " << (*iQueryGroup).first << " size " << ((*iQueryGroup).second).size());
-		std::string groupnr = std::to_string((*iQueryGroup).first);
-		showProgress(groupnr, queryCounter, querySize);
-		queryCounter++;
+		if (groupids.at(iGroup) != 0)
+		{
+			mQueryCount += _queries[groupids.at(iGroup)].size();
+		}
+	}
+
+	std::vector<QueryEvaluation*> evaluations;
+	{
+		vretbox::WorkStealingPool pool(mThreads);
+		LOG_INFO("Evaluation with " << pool.size() << " workers and chunks of " << mChunkSize << " model elements");
+
+		for (int iGroup = 0; iGroup < groupids.size(); iGroup++)
+		{
+			int groupid = groupids.at(iGroup);
+			std::vector<int>& group = _queries[groupid];
 
-		if ((*iQueryGroup).first == 0)
+			LOG_INFO("Group " << groupid << " size " << group.size());
+			{
+				boost::mutex::scoped_lock lock(mProgressMutex);
+				showProgress(std::to_string(groupid), queryCounter, querySize);
+			}
+			queryCounter++;
+
+			if (groupid == 0)
+			{
+				LOG_INFO("Group 0 is not in the ground truth, evaluation step is skipped.");
+				continue;
+			}
+
+			for (int iQuery = 0; iQuery < group.size(); iQuery++)
+			{
+				QueryEvaluation* evaluation = new QueryEvaluation(group.at(iQuery), &group);
+				evaluations.push_back(evaluation);
+
+				vretbox::WorkStealingPool* workers = &pool;
+				pool.submit([this, workers, evaluation](int _worker)
+				{
+					evaluateInParallel(workers, _worker, evaluation);
+				});
+			}
+		}
+
+		try
+		{
+			pool.wait();
+		}
+		catch (std::exception& e)
+		{
+			LOG_FATAL("A query cannot be evaluated. Exception: " << e.what());
+			exit(EXIT_FAILURE);
+		}
+		LOG_INFO("Evaluation finished, " << pool.getStolenTasks() << " tasks were stolen by idle workers");
+	}
+
+	//reduce the evaluated queries per group in the order of the ground truth
+	int iEvaluation = 0;
+	float avgPrecisionAtK = 0.0;
+	long long computed = 0, pruned = 0;
+	for (int iGroup = 0; iGroup < groupids.size(); iGroup++)
+	{
+		int groupid = groupids.at(iGroup);
+		if (groupid == 0)
 		{
-			LOG_INFO("Group 0 is not in the ground truth, evaluation step is skipped.");
 			continue;
 		}
 
-		threads.push_back(new boost::thread(boost::bind(&TRECVidValuation::evaluateInParallel, this, (*iQueryGroup).first, (*iQueryGroup).second)));
+		int groupSize = _queries[groupid].size();
+
+		float meanAveragePrecision = 0.0;
+		float meansAverageComputationTime = 0.0;
+		float meanPrecisionAtK = 0.0;
+
+		for (int iQuery = 0; iQuery < groupSize; iQuery++, iEvaluation++)
+		{
+			QueryEvaluation* evaluation = evaluations.at(iEvaluation);
+			meanAveragePrecision += evaluation->mResult->mAPValue;
+			meansAverageComputationTime += evaluation->mResult->mAvgSearchtime;
+			meanPrecisionAtK += evaluation->mPrecisionAtK;
+			computed += evaluation->mComputed;
+			pruned += evaluation->mPruned;
+		}
+
+		meansAverageComputationTime /= float(groupSize);
+		meanAveragePrecision = meanAveragePrecision / float(groupSize);
+		meanPrecisionAtK /= float(groupSize);
+		avgPrecisionAtK += meanPrecisionAtK;
+
+		mAVGMeanAveragePrecision += meanAveragePrecision;
+		mAVGMeanAverageComputationTime += meansAverageComputationTime;
 
+		LOG_INFO("Mean Average Precision for group " << groupid << " is " << meanAveragePrecision);
+		LOG_INFO("Average computation time for group " << groupid << " is " << meansAverageComputationTime);
+		if (mTopK > 0)
+		{
+			LOG_INFO("Mean Precision at " << mTopK << " for group " << groupid << " is " << meanPrecisionAtK);
+		}
+
+		mCollectedMAPvalues.push_back(std::make_pair(groupid, meanAveragePrecision));
+		mCollectedCompTimes.push_back(std::make_pair(groupid, meansAverageComputationTime));
 	}
 
-	for (int iThread = 0; iThread < threads.size(); iThread++)
+	for (int iEval = 0; iEval < evaluations.size(); iEval++)
 	{
-		threads[iThread]->join();
-		delete threads[iThread];
+		delete evaluations.at(iEval);
 	}
 
-	appendValuesToCSVTemplate("MAP", mCollectedMAPvalues);
-	appendValuesToCSVTemplate("SMD", mCollectedCompTimes);
-	mAVGMeanAveragePrecision /= float(queries.size());
-	mAVGMeanAverageComputationTime /= float(queries.size());
+	mAVGMeanAveragePrecision /= float(_queries.size());
+	mAVGMeanAverageComputationTime /= float(_queries.size());
 
-	LOG_INFO("Total Mean Average Precision for " << queries.size() << " queries is " << mAVGMeanAveragePrecision);
-	LOG_INFO("Total Average Computation for " << queries.size() << " queries is " << mAVGMeanAverageComputationTime << "s");
+	LOG_INFO("Total Mean Average Precision for " << _queries.size() << " queries is " << mAVGMeanAveragePrecision);
+	LOG_INFO("Total Average Computation for " << _queries.size() << " queries is " << mAVGMeanAverageComputationTime << "s");
+	if (mTopK > 0)
+	{
+		LOG_INFO("Total Mean Precision at " << mTopK << " for " << _queries.size() << " queries is " << avgPrecisionAtK / float(_queries.size()));
+	}
+	if (!mNorms.empty())
+	{
+		LOG_INFO("Total " << pruned << " of " << computed + pruned << " distances were pruned by the lower bound ("
+			<< (computed + pruned > 0 ? 100.0 * double(pruned) / double(computed + pruned) : 0.0) << "%)");
+	}
+}
 
+float trecvid::TRECVidValuation::getMeanAveragePrecision() const
+{
+	return mAVGMeanAveragePrecision;
 }
 
+bool trecvid::TRECVidValuation::quantizeModel()
+{
+	size_t size = mModel.getMemorySize();
+	double start = double(cv::getTickCount());
+
+	if (!mModel.quantize(mEncoding))
+	{
+		LOG_ERROR("Fatal Error: The model cannot be encoded as " << Quantizer::toString(mEncoding));
+		return false;
+	}
+
+	LOG_INFO("Model encoded as " << Quantizer::toString(mEncoding) << " in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency())
+		<< "s, " << size << " bytes are reduced to " << mModel.getMemorySize());
+	return true;
+}
 
-std::tuple<std::vector<std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>>>, float, float> trecvid::TRECVidValuation::evaluate(int _queryid, std::vector<AVSFeatures*> _queries)
+void trecvid::TRECVidValuation::serve()
 {
-	std::tuple<std::vector<std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>>>, float, float>  results;
-	int querySize = _queries.size();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	boost::asio::io_service service;
+
+	//a socket file of a previous daemon would block the bind, it is only removed if no daemon accepts on it anymore
+	boost::system::error_code error;
+	boost::filesystem::file_status status = boost::filesystem::status(mSocket, error);
+	if (boost::filesystem::exists(status))
+	{
+		if (status.type() != boost::filesystem::socket_file)
+		{
+			LOG_FATAL(mSocket << " exists and is not a socket");
+			return;
+		}
+
+		boost::asio::local::stream_protocol::socket probe(service);
+		probe.connect(boost::asio::local::stream_protocol::endpoint(mSocket), error);
+		if (!error)
+		{
+			LOG_FATAL("A daemon is still listening on " << mSocket);
+			return;
+		}
+		boost::filesystem::remove(mSocket);
+	}
+
+	vretbox::WorkStealingPool pool(mThreads);
+	mPool = &pool;
+
+	boost::asio::local::stream_protocol::acceptor acceptor(service, boost::asio::local::stream_protocol::endpoint(mSocket));
+
+	LOG_INFO("Daemon with " << mModel.size() << " signatures and " << pool.size() << " workers listens on " << mSocket);
+	LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
+
+	//the connections are read concurrently, the requests are answered one after the other by the thread of the daemon
+	//and a query itself is ranked by all workers
+	DaemonSession::Handler handler = [this](const std::string& _request, bool& _shutdown)
+	{
+		return answer(_request, _shutdown);
+	};
+
+	std::function<void()> accept = [&]()
+	{
+		std::shared_ptr<DaemonSession> session = std::make_shared<DaemonSession>(service, handler, mTimeout);
+		acceptor.async_accept(session->getSocket(), [&, session](const boost::system::error_code& _error)
+		{
+			if (_error == boost::asio::error::operation_aborted)
+			{
+				return;
+			}
+			if (!_error)
+			{
+				session->read();
+			}
+			accept();
+		});
+	};
+	accept();
+	service.run();
+
+	acceptor.close();
+	boost::filesystem::remove(mSocket);
+	mPool = nullptr;
+
+	LOG_INFO("Daemon stopped, " << mReplies.getHits() << " of " << mReplies.getHits() + mReplies.getMisses() << " requests were answered from the cache");
+#else
+	LOG_FATAL("The daemon mode requires local sockets, which are not supported on this platform");
+#endif
+}
+
+std::string trecvid::TRECVidValuation::answer(const std::string& _request, bool& _shutdown)
+{
+	//skip windows line endings and trailing blanks
+	std::string request = _request;
+	request.erase(request.find_last_not_of(" \r\n\t") + 1);
 
-	float meanAveragePrecision = 0.0;
-	float meansAverageComputationTime = 0.0;
+	std::istringstream tokens(request);
+	std::string command;
+	int k = 0;
+	tokens >> command;
+
+	if (command == "shutdown")
+	{
+		_shutdown = true;
+		return "shutdown\n\n";
+	}
+
+	if (!(tokens >> k) || k < 0)
+	{
+		return "error,invalid number of results\n\n";
+	}
+	if (k == 0)
+	{
+		k = mTopK > 0 ? mTopK : mModel.size();
+	}
 
-	for(int iQuery = 0; iQuery < querySize; iQuery++)
+	//a feature file may be rewritten between two requests, so its replies are cached per modification time and size
+	std::string key = request;
+	std::string file;
+	if (command == "file")
 	{
-		showProgress("Queries", iQuery, querySize);
+		std::getline(tokens >> std::ws, file);
+		boost::system::error_code error;
+		if (!boost::filesystem::is_regular_file(file, error))
+		{
+			return "error,feature file " + file + " not found\n\n";
+		}
 
-		std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>> interim = evaluate(_queries.at(iQuery));
-		std::get<0>(results).push_back(interim);
+		std::time_t modified = boost::filesystem::last_write_time(file, error);
+		uintmax_t size = error ? 0 : boost::filesystem::file_size(file, error);
+		if (error)
+		{
+			return "error,feature file " + file + " cannot be read\n\n";
+		}
+		key += "\n" + std::to_string(modified) + "," + std::to_string(size);
+	}
 
-		meanAveragePrecision += interim.first->mAPValue;
-		meansAverageComputationTime += interim.first->mAvgSearchtime;
+	std::string reply;
+	if (mReplies.get(key, reply))
+	{
+		return reply;
 	}
 
-	meansAverageComputationTime /= float(querySize);
-	meanAveragePrecision = meanAveragePrecision / float(querySize);
+	double start = double(cv::getTickCount());
+
+	cv::Mat query;
+	if (command == "file")
+	{
+		//a broken feature file must not stop the daemon
+		try
+		{
+			AVSFeatures features;
+			features.deserialize(file);
+			query = features.mVectors;
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Error: Feature file " << file << " cannot be deserialized. Exception: " << e.what());
+			return "error,feature file " + file + " cannot be deserialized\n\n";
+		}
+	}
+	else if (command == "shot")
+	{
+		int vid, sid;
+		if (!(tokens >> vid >> sid))
+		{
+			return "error,invalid shot\n\n";
+		}
 
-	std::get<1>(results) = meanAveragePrecision;
-	std::get<2>(results) = meansAverageComputationTime;
-	return results;
+		std::map<std::pair<int, int>, int>::const_iterator shot = mShotIndex.find(std::make_pair(vid, sid));
+		if (shot == mShotIndex.end())
+		{
+			return "error,shot " + std::to_string(vid) + "_" + std::to_string(sid) + " is not in the model\n\n";
+		}
+		query = mModel.getSignature(shot->second);
+	}
+	else if (command == "signature")
+	{
+		int rows, cols;
+		if (!(tokens >> rows >> cols) || rows <= 0 || rows > MAX_SIGNATURE_ROWS || cols != mModel.getDimension())
+		{
+			return "error,a signature needs 1 to " + std::to_string(MAX_SIGNATURE_ROWS) + " rows and " + std::to_string(mModel.getDimension()) + " columns\n\n";
+		}
+
+		query.create(rows, cols, CV_32F);
+		for (int iValue = 0; iValue < rows * cols; iValue++)
+		{
+			if (!(tokens >> query.at<float>(iValue / cols, iValue % cols)))
+			{
+				return "error,signature has less than " + std::to_string(rows * cols) + " values\n\n";
+			}
+		}
+	}
+	else
+	{
+		return "error,unknown request " + command + "\n\n";
+	}
+
+	if (query.empty())
+	{
+		return "error,empty signature\n\n";
+	}
+
+	std::vector<RankedElement> ranking;
+	int pruned = 0;
+	try
+	{
+		rankModel(query, k, ranking, pruned);
+	}
+	catch (std::exception& e)
+	{
+		LOG_ERROR("Error: Request " << command << " cannot be ranked. Exception: " << e.what());
+		return "error,query cannot be ranked\n\n";
+	}
+
+	std::stringstream lines;
+	for (int iResult = 0; iResult < ranking.size(); iResult++)
+	{
+		const RankedElement& key = ranking[iResult];
+		lines << iResult + 1 << "," << mModel.getVID(key.mElement) << "," << mModel.getSID(key.mElement) << ","
+			<< mModel.getQID(key.mElement) << "," << key.mDistance << "," << mModel.getFilename(key.mElement) << "\n";
+	}
+	lines << "\n";
+	reply = lines.str();
+
+	mReplies.put(key, reply);
+
+	LOG_INFO("Request " << command << " ranked in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency()) << "s, "
+		<< pruned << " of " << mModel.size() << " distances were pruned");
+	return reply;
 }
 
-void trecvid::TRECVidValuation::evaluateInParallel(int _queryid, std::vector<AVSFeatures*> _queries)
+void trecvid::TRECVidValuation::rankModel(const cv::Mat& _query, int _k, std::vector<RankedElement>& _ranking, int& _pruned)
 {
-	std::tuple<std::vector<std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>>>, float, float>  results;
-	int querySize = _queries.size();
+	//a query of a quantized model is compared with the encoded rows, by the scan and by the pivot index
+	cv::Mat queryCodes = mModel.isQuantized() ? mModel.encode(_query) : cv::Mat();
+
+	if (!mIndex.isEmpty())
+	{
+		std::vector<PivotIndex::Match> matches;
+		PivotIndex::Statistics statistics;
+		mIndex.knn(queryCodes.empty() ? _query : queryCodes, _k, mChunkSize, *mPool, matches, statistics);
+
+		_ranking.resize(matches.size());
+		for (int iMatch = 0; iMatch < matches.size(); iMatch++)
+		{
+			_ranking[iMatch].mDistance = matches[iMatch].first;
+			_ranking[iMatch].mElement = matches[iMatch].second;
+			_ranking[iMatch].mSearchTime = 0;
+		}
+		_pruned = int(statistics.mAvoided);
+		return;
+	}
+
+	int modelSize = mModel.size();
+	int chunkSize = mChunkSize;
+	int chunks = (modelSize + chunkSize - 1) / chunkSize;
+
+	std::vector<RankedElement> topK;
+	boost::mutex mutex;
 
-	float meanAveragePrecision = 0.0;
-	float meansAverageComputationTime = 0.0;
+	//k-th distance of the merged chunks, it tightens the pruning of the chunks that start later
+	std::atomic<float> bound(std::numeric_limits<float>::infinity());
+	std::atomic<int> pruned(0);
+	float querySelfSimilarity = 0;
+	if (mSQFD != nullptr)
+	{
+		querySelfSimilarity = queryCodes.empty() ? mSQFD->computeSelfSimilarity(_query) : mSQFD->computeSelfSimilarity(mModel.getQuantizer(), queryCodes);
+	}
+	float queryNorm = mNorms.empty() ? -1 : (querySelfSimilarity > 0 ? std::sqrt(querySelfSimilarity) : 0);
 
-	for (int iQuery = 0; iQuery < querySize; iQuery++)
+	for (int iChunk = 0; iChunk < chunks; iChunk++)
 	{
-		showProgress("Queries", iQuery, querySize);
+		int begin = iChunk * chunkSize;
+		int end = std::min(begin + chunkSize, modelSize);
+		mPool->submit([this, &_query, &queryCodes, _k, begin, end, &topK, &mutex, &bound, &pruned, querySelfSimilarity, queryNorm](int)
+		{
+			std::vector<RankedElement> chunkTopK;
+			chunkTopK.reserve(std::min(_k, end - begin));
+
+			AVSFeatures query, element;
+			query.mVectors = _query;
+			query.mCodes = queryCodes;
+
+			std::vector<std::pair<float, int>> candidates;
+			orderByLowerBound(queryNorm, nullptr, begin, end, -1, candidates);
+
+			for (int iCandidate = 0; iCandidate < candidates.size(); iCandidate++)
+			{
+				//the candidates are ordered by their bound, no later one can enter the top k either
+				if (queryNorm >= 0 && _k > 0)
+				{
+					float threshold = bound;
+					if (chunkTopK.size() == _k)
+					{
+						threshold = std::min(threshold, chunkTopK.front().mDistance);
+					}
+					if (candidates[iCandidate].first > threshold)
+					{
+						pruned += int(candidates.size()) - iCandidate;
+						break;
+					}
+				}
+
+				int iElem = candidates[iCandidate].second;
+				getFeatures(iElem, element);
+
+				RankedElement key;
+				key.mDistance = computeDistance(query, querySelfSimilarity, iElem, element);
+				key.mElement = iElem;
+				key.mSearchTime = 0;
+				pushTopK(chunkTopK, key, _k);
+			}
+
+			boost::mutex::scoped_lock lock(mutex);
+			for (int iKey = 0; iKey < chunkTopK.size(); iKey++)
+			{
+				pushTopK(topK, chunkTopK[iKey], _k);
+			}
+			if (_k > 0 && topK.size() == _k)
+			{
+				bound = topK.front().mDistance;
+			}
+		});
+	}
+	mPool->wait();
+	_pruned = pruned;
 
-		std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>> interim = evaluate(_queries.at(iQuery));
-		std::get<0>(results).push_back(interim);
+	//the keys are ordered by distance and index, so the ranking does not depend on the scheduling
+	std::sort_heap(topK.begin(), topK.end());
+	_ranking.swap(topK);
+}
 
-		meanAveragePrecision += interim.first->mAPValue;
-		meansAverageComputationTime += interim.first->mAvgSearchtime;
+bool trecvid::TRECVidValuation::prepareMatrix()
+{
+	//every element of a query group of the ground truth is a query
+	std::vector<int> queries;
+	for (int iElem = 0; iElem < mModel.size(); iElem++)
+	{
+		if (mModel.getQID(iElem) != 0)
+		{
+			queries.push_back(iElem);
+		}
 	}
 
-	meansAverageComputationTime /= float(querySize);
-	meanAveragePrecision = meanAveragePrecision / float(querySize);
+	std::string tag = "features=" + mFeatureSetName + "\ndistance=" + mDistanceSettings + "\n";
+	uint64_t modelHash = DistanceMatrix::hashModel(mModel);
+
+	if (mMatrix.open(mMatrixFile, tag, modelHash, mModel.size()))
+	{
+		LOG_INFO("Distances of " << queries.size() << " queries are read from " << mMatrixFile);
+		return true;
+	}
 
-	std::get<1>(results) = meanAveragePrecision;
-	std::get<2>(results) = meansAverageComputationTime;
-	
-	mAVGMeanAveragePrecision += meanAveragePrecision;
-	mAVGMeanAverageComputationTime += meansAverageComputationTime;
+	double start = double(cv::getTickCount());
+	bool isComputed;
+	{
+		vretbox::WorkStealingPool pool(mThreads);
+		LOG_INFO("Distance matrix of " << queries.size() << " queries and " << mModel.size() << " elements is computed with " << pool.size() << " workers"
+			<< (mSymmetric ? ", the distances between queries are mirrored" : ""));
 
-	LOG_INFO("Mean Average Precision for group " << _queryid << " is " << meanAveragePrecision);
-	LOG_INFO("Average computation time for group " << _queryid << " is " << meansAverageComputationTime);
+		//the slots of each worker hold the signatures of its current tile, an encoded model is decoded once per slot
+		const int slotsPerWorker = DistanceMatrix::TILE_ROWS + 1;
+		std::vector<AVSFeatures> slots(pool.size() * slotsPerWorker);
 
-	mCollectedMAPvalues.push_back(std::make_pair(_queryid, meanAveragePrecision));
-	mCollectedCompTimes.push_back(std::make_pair(_queryid, meansAverageComputationTime));
+		isComputed = DistanceMatrix::compute(mMatrixFile, tag, modelHash, queries, mModel.size(), mSymmetric, mChunkSize, pool,
+			[this, &slots, slotsPerWorker](int _worker, int _slot, int _element)
+		{
+			getFeatures(_element, slots[_worker * slotsPerWorker + _slot]);
+		},
+			[this, &slots, slotsPerWorker](int _worker, int _slot, int _query, int _element)
+		{
+			AVSFeatures* workerSlots = &slots[_worker * slotsPerWorker];
+			return computeDistance(workerSlots[_slot], getSelfSimilarity(_query), _element, workerSlots[DistanceMatrix::ELEMENT_SLOT]);
+		});
+	}
+
+	if (!isComputed || !mMatrix.open(mMatrixFile, tag, modelHash, mModel.size()))
+	{
+		LOG_ERROR("Error: Distance matrix " << mMatrixFile << " is not available, the distances are computed during the evaluation");
+		return false;
+	}
+
+	LOG_INFO("Distance matrix " << mMatrixFile << " computed in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency()) << "s");
+	return true;
 }
 
-std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>> trecvid::TRECVidValuation::evaluate(AVSFeatures* _query)
+bool trecvid::TRECVidValuation::prepareIndex()
 {
-	int modelSize = mModel.size();
-	std::vector<defuse::ResultBase*> results;
-	results.reserve(modelSize);
+	std::string tag = "features=" + mFeatureSetName + "\ndistance=" + mDistanceSettings + "\n";
+	uint64_t modelHash = DistanceMatrix::hashModel(mModel);
+
+	if (mIndex.load(mIndexFile, tag, modelHash, mModel, *mSQFD))
+	{
+		LOG_INFO("Pivot index with " << mIndex.getPivotCount() << " pivots is read from " << mIndexFile);
+		return true;
+	}
+
+	double start = double(cv::getTickCount());
+	{
+		vretbox::WorkStealingPool pool(mThreads);
+		LOG_INFO("Pivot index with " << mPivots << " pivots of " << mModel.size() << " elements is built with " << pool.size() << " workers");
+		mIndex.build(mModel, *mSQFD, mPivots, pool);
+	}
+
+	//an index that cannot be written is used for this run nevertheless
+	if (!mIndex.save(mIndexFile, tag, modelHash))
+	{
+		LOG_ERROR("Error: Pivot index " << mIndexFile << " cannot be written, it is only used in this run");
+	}
+
+	LOG_INFO("Pivot index " << mIndexFile << " built in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency()) << "s");
+	return true;
+}
+
+void trecvid::TRECVidValuation::prepareSignatures()
+{
+	mSelfSimilarities.clear();
+	mNorms.clear();
+	if (mSQFD == nullptr)
+	{
+		return;
+	}
+
+	double start = double(cv::getTickCount());
+	mSelfSimilarities.resize(mModel.size());
+	if (mPruning)
+	{
+		mNorms.resize(mModel.size());
+	}
+
+	{
+		vretbox::WorkStealingPool pool(mThreads);
+		for (int iBegin = 0; iBegin < mModel.size(); iBegin += mChunkSize)
+		{
+			int end = std::min(iBegin + mChunkSize, int(mModel.size()));
+			pool.submit([this, iBegin, end](int)
+			{
+				for (int iElem = iBegin; iElem < end; iElem++)
+				{
+					float selfSimilarity = mModel.isQuantized() ? mSQFD->computeSelfSimilarity(mModel.getQuantizer(), mModel.getCodes(iElem))
+						: mSQFD->computeSelfSimilarity(mModel.getSignature(iElem));
+					mSelfSimilarities[iElem] = selfSimilarity;
+					if (!mNorms.empty())
+					{
+						mNorms[iElem] = selfSimilarity > 0 ? std::sqrt(selfSimilarity) : 0;
+					}
+				}
+			});
+		}
+		pool.wait();
+	}
 
-	float avgSearchTime = 0.0;
-	float distance = 0.0;
+	LOG_INFO("Self-similarities of " << mModel.size() << " signatures computed in " << (double(cv::getTickCount()) - start) / double(cv::getTickFrequency()) << "s");
+}
+
+void trecvid::TRECVidValuation::orderByLowerBound(float _queryNorm, const float* _queryPivots, int _begin, int _end, int _skippedQID, std::vector<std::pair<float, int>>& _candidates) const
+{
+	_candidates.clear();
+	_candidates.reserve(_end - _begin);
+
+	for (int iElem = _begin; iElem < _end; iElem++)
+	{
+		if (mModel.getQID(iElem) == _skippedQID)
+		{
+			continue;
+		}
+
+		float lowerBound = 0;
+		if (_queryPivots != nullptr)
+		{
+			lowerBound = mIndex.lowerBound(_queryPivots, _queryNorm, iElem);
+		}
+		else if (_queryNorm >= 0)
+		{
+			lowerBound = SQFDistance::lowerBound(_queryNorm, mNorms[iElem]);
+		}
+		_candidates.push_back(std::make_pair(lowerBound, iElem));
+	}
+
+	//without a bound the elements keep the order of the arena
+	if (_queryNorm >= 0)
+	{
+		std::sort(_candidates.begin(), _candidates.end());
+	}
+}
+
+float trecvid::TRECVidValuation::getSelfSimilarity(int _element) const
+{
+	return mSelfSimilarities.empty() ? 0 : mSelfSimilarities[_element];
+}
+
+float trecvid::TRECVidValuation::computeDistance(AVSFeatures& _query, float _querySelfSimilarity, int _element, AVSFeatures& _elementFeatures) const
+{
+	if (mSQFD != nullptr && mModel.isQuantized())
+	{
+		return mSQFD->compute(mModel.getQuantizer(), _query.mCodes, _querySelfSimilarity, _elementFeatures.mCodes, mSelfSimilarities[_element]);
+	}
 
-	for (int iElem = 0; iElem < modelSize; iElem++)
+	if (mSQFD != nullptr)
 	{
+		return mSQFD->compute(_query.mVectors, _querySelfSimilarity, _elementFeatures.mVectors, mSelfSimilarities[_element]);
+	}
+
+	return mDistance->compute(_query, _elementFeatures);
+}
 
-		AVSFeatures* element = mModel.at(iElem);
+void trecvid::TRECVidValuation::getFeatures(int _element, AVSFeatures& _features) const
+{
+	if (mSQFD != nullptr && mModel.isQuantized())
+	{
+		_features.mCodes = mModel.getCodes(_element);
+		return;
+	}
 
-		size_t e1_start, e1_end;
-	
-		e1_start = double(cv::getTickCount());
-		distance = mDistance->compute(*(_query), *element);
-		e1_end = cv::getTickCount();
+	_features.mVectors = mModel.getSignature(_element);
+}
+
+float trecvid::TRECVidValuation::getDistance(int _row, int _element, AVSFeatures& _query, float _querySelfSimilarity, AVSFeatures& _elementFeatures, float& _searchTime) const
+{
+	if (_row >= 0)
+	{
+		_searchTime = float(mMatrix.getTime(_row));
+		return mMatrix.get(_row, _element);
+	}
+
+	getFeatures(_element, _elementFeatures);
+
+	double start = double(cv::getTickCount());
+	float distance = computeDistance(_query, _querySelfSimilarity, _element, _elementFeatures);
+	_searchTime = float((double(cv::getTickCount()) - start) / double(cv::getTickFrequency()));
+
+	return distance;
+}
+
+void trecvid::TRECVidValuation::evaluateInParallel(vretbox::WorkStealingPool* _pool, int _worker, QueryEvaluation* _evaluation)
+{
+	int modelSize = mModel.size();
+	int chunkSize = mChunkSize;
+	int chunks = (modelSize + chunkSize - 1) / chunkSize;
+
+	//the relevant elements are ranked first, their keys split the other elements into gaps
+	AVSFeatures query, element;
+	getFeatures(_evaluation->mQuery, query);
+	float querySelfSimilarity = getSelfSimilarity(_evaluation->mQuery);
+	int row = mMatrix.isOpen() ? mMatrix.getRow(_evaluation->mQuery) : -1;
+
+	const std::vector<int>& relevant = *(_evaluation->mRelevant);
+	_evaluation->mRelevantKeys.reserve(relevant.size());
+
+	for (int iRelevant = 0; iRelevant < relevant.size(); iRelevant++)
+	{
+		int iElem = relevant.at(iRelevant);
+		float searchTime;
+		float distance = getDistance(row, iElem, query, querySelfSimilarity, element, searchTime);
 
 		if (distance < 0)
 		{
 			LOG_ERROR(" Error: Distance is smaller than zero.");
 		}
-	
-		double tickFrequency = double(cv::getTickFrequency());
-		double searchTime = (e1_end - e1_start) / tickFrequency;
-		avgSearchTime += searchTime;
-
-		defuse::ResultBase* result = new defuse::ResultBase();
-		result->mVideoFileName = element->mVideoFileName;
-		result->mVideoID = element->mVID;
-		result->mShotID = element->mSID;
-		result->mQueryID = element->mQID;
-		result->mDistance = distance;
-		result->mSearchTime = searchTime;
-	
-		results.push_back(result);
-	}
-	
-	avgSearchTime = avgSearchTime / float(modelSize);
-	
-	std::sort(results.begin(), results.end(), [](const defuse::ResultBase* s1, const defuse::ResultBase* s2)
-	{
-		return (s1->mDistance < s2->mDistance);
-	});
-	
-	
-	defuse::EvaluatedQuery* evalQuery = evaluate(_query, results, avgSearchTime);
-
-	std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>> evaluation = std::make_pair(evalQuery, results);
-
-	return evaluation;
+
+		RankedElement key;
+		key.mDistance = distance;
+		key.mElement = iElem;
+		key.mSearchTime = searchTime;
+
+		_evaluation->mRelevantSearchTime += key.mSearchTime;
+		_evaluation->mRelevantKeys.push_back(key);
+	}
+
+	std::sort(_evaluation->mRelevantKeys.begin(), _evaluation->mRelevantKeys.end());
+
+	_evaluation->mNonRelevantCounts.assign(_evaluation->mRelevantKeys.size() + 1, 0);
+	_evaluation->mChunkSearchTimes.assign(chunks, 0.0);
+	_evaluation->mOpenChunks = chunks;
+
+	if (chunks == 0)
+	{
+		rankQuery(_evaluation);
+		return;
+	}
+
+	//the last chunk is pushed first; the worker continues with the first chunk
+	//and idle workers steal the remaining chunks
+	for (int iChunk = chunks - 1; iChunk > 0; iChunk--)
+	{
+		int begin = iChunk * chunkSize;
+		int end = std::min(begin + chunkSize, modelSize);
+		_pool->spawn(_worker, [this, _evaluation, iChunk, begin, end](int)
+		{
+			evaluateChunk(_evaluation, iChunk, begin, end);
+		});
+	}
+
+	evaluateChunk(_evaluation, 0, 0, std::min(chunkSize, modelSize));
 }
 
-defuse::EvaluatedQuery* trecvid::TRECVidValuation::evaluate(AVSFeatures* _query, std::vector<defuse::ResultBase*> _results, float _avgSearchTime)
+void trecvid::TRECVidValuation::evaluateChunk(QueryEvaluation* _evaluation, int _chunk, int _begin, int _end)
 {
-	int matches = 0;
+	int queryid = mModel.getQID(_evaluation->mQuery);
+	const std::vector<RankedElement>& relevantKeys = _evaluation->mRelevantKeys;
+
+	std::vector<int> counts(relevantKeys.size() + 1, 0);
+	std::vector<RankedElement> topK;
+	topK.reserve(mTopK);
+	double searchTime = 0.0;
+	int computed = 0, pruned = 0;
+
+	//the signatures are headers over the model, the elements are scanned in the order of the arena
+	AVSFeatures query, element;
+	getFeatures(_evaluation->mQuery, query);
+	float querySelfSimilarity = getSelfSimilarity(_evaluation->mQuery);
+	int row = mMatrix.isOpen() ? mMatrix.getRow(_evaluation->mQuery) : -1;
+
+	//relevant elements are already ranked; distances of the matrix are read, so they are not pruned
+	bool isPruning = row < 0 && !mNorms.empty();
+	std::vector<std::pair<float, int>> candidates;
+	//the pivot distances of a query of the model are part of the index
+	const float* queryPivots = isPruning && !mIndex.isEmpty() ? mIndex.getPivotDistances(_evaluation->mQuery) : nullptr;
+	orderByLowerBound(isPruning ? mNorms[_evaluation->mQuery] : -1, queryPivots, _begin, _end, queryid, candidates);
+
+	float lastRelevant = relevantKeys.empty() ? -std::numeric_limits<float>::infinity() : relevantKeys.back().mDistance;
+
+	for (int iCandidate = 0; iCandidate < candidates.size(); iCandidate++)
+	{
+		//an element beyond the last relevant one and the k-th one only extends the last gap;
+		//the candidates are ordered by their bound, so this holds for all later ones as well
+		if (isPruning && candidates[iCandidate].first > lastRelevant)
+		{
+			float threshold = _evaluation->mTopKBound;
+			if (mTopK > 0 && topK.size() == mTopK)
+			{
+				threshold = std::min(threshold, topK.front().mDistance);
+			}
 
-	float precisionAsSum = 0;
+			if (mTopK == 0 || candidates[iCandidate].first > threshold)
+			{
+				int remaining = candidates.size() - iCandidate;
+				counts[relevantKeys.size()] += remaining;
+				pruned += remaining;
+				break;
+			}
+		}
+
+		int iElem = candidates[iCandidate].second;
+		float elementSearchTime;
+		float distance = getDistance(row, iElem, query, querySelfSimilarity, element, elementSearchTime);
+
+		if (distance < 0)
+		{
+			LOG_ERROR(" Error: Distance is smaller than zero.");
+		}
 
-	float precision;
+		RankedElement key;
+		key.mDistance = distance;
+		key.mElement = iElem;
+		key.mSearchTime = elementSearchTime;
+		searchTime += key.mSearchTime;
+		computed++;
 
-	int resultSize = _results.size();
+		//number of relevant elements ranked before this element
+		counts[std::upper_bound(relevantKeys.begin(), relevantKeys.end(), key) - relevantKeys.begin()]++;
+
+		if (mTopK > 0)
+		{
+			pushTopK(topK, key, mTopK);
+		}
+	}
 
-	for (int iResult = 1; iResult < resultSize + 1; iResult++)
 	{
-		defuse::ResultBase* rankedresult = _results.at(iResult - 1);
+		boost::mutex::scoped_lock lock(_evaluation->mMutex);
 
-		if (rankedresult->mQueryID == _query->mQID)
+		for (int iGap = 0; iGap < counts.size(); iGap++)
 		{
-			matches++;
-			precisionAsSum += (static_cast<float>(matches) / static_cast<float>(iResult));
+			_evaluation->mNonRelevantCounts[iGap] += counts[iGap];
 		}
 
-		precision = ((static_cast<float>(matches) / static_cast<float>(iResult)));
+		for (int iKey = 0; iKey < topK.size(); iKey++)
+		{
+			pushTopK(_evaluation->mTopK, topK[iKey], mTopK);
+		}
+		if (mTopK > 0 && _evaluation->mTopK.size() == mTopK)
+		{
+			_evaluation->mTopKBound = _evaluation->mTopK.front().mDistance;
+		}
 
-		rankedresult->mPrecision = precision;
+		_evaluation->mChunkSearchTimes[_chunk] = searchTime;
+		_evaluation->mComputed += computed;
+		_evaluation->mPruned += pruned;
 	}
 
-	float ap = (precisionAsSum / static_cast<float>(matches));
+	if (--_evaluation->mOpenChunks == 0)
+	{
+		rankQuery(_evaluation);
+	}
+}
+
+void trecvid::TRECVidValuation::rankQuery(QueryEvaluation* _evaluation)
+{
+	int modelSize = mModel.size();
+	int queryid = mModel.getQID(_evaluation->mQuery);
+	const std::vector<RankedElement>& relevantKeys = _evaluation->mRelevantKeys;
+	int relevantSize = relevantKeys.size();
+
+	//the i-th relevant element is ranked after all non-relevant elements of the gaps 0..i
+	//and after i relevant elements
+	float precisionAsSum = 0;
+	int nonRelevantBefore = 0;
+
+	for (int iRelevant = 0; iRelevant < relevantSize; iRelevant++)
+	{
+		nonRelevantBefore += _evaluation->mNonRelevantCounts[iRelevant];
+
+		int matches = iRelevant + 1;
+		int rank = nonRelevantBefore + matches;
+		precisionAsSum += (static_cast<float>(matches) / static_cast<float>(rank));
+	}
+
+	float ap = (precisionAsSum / static_cast<float>(relevantSize));
+
+	//the chunks are summed in their order, so that the result does not depend on the scheduling
+	double searchTime = _evaluation->mRelevantSearchTime;
+	for (int iChunk = 0; iChunk < _evaluation->mChunkSearchTimes.size(); iChunk++)
+	{
+		searchTime += _evaluation->mChunkSearchTimes[iChunk];
+	}
+	float avgSearchTime = float(searchTime) / float(modelSize);
 
 	defuse::EvaluatedQuery* evalQuery = new defuse::EvaluatedQuery();
-	evalQuery->mVideoFileName = _query->mVideoFileName;
-	evalQuery->mQueryID = _query->mQID;
-	evalQuery->mVideoID = _query->mVID;
-	evalQuery->mShotID = _query->mSID;
+	evalQuery->mVideoFileName = mModel.getFilename(_evaluation->mQuery);
+	evalQuery->mQueryID = queryid;
+	evalQuery->mVideoID = mModel.getVID(_evaluation->mQuery);
+	evalQuery->mShotID = mModel.getSID(_evaluation->mQuery);
 	evalQuery->mAPValue = ap;
-	evalQuery->mAvgSearchtime = _avgSearchTime;
+	evalQuery->mAvgSearchtime = avgSearchTime;
+	_evaluation->mResult = evalQuery;
+
+	if (!mNorms.empty())
+	{
+		LOG_INFO("Query " << evalQuery->mVideoID << "_" << evalQuery->mShotID << ": " << _evaluation->mPruned << " of "
+			<< _evaluation->mComputed + _evaluation->mPruned << " distances were pruned by the lower bound");
+	}
+
+	//the relevant elements compete with the best non-relevant ones for the top k
+	if (mTopK > 0)
+	{
+		std::vector<RankedElement>& topK = _evaluation->mTopK;
+		for (int iRelevant = 0; iRelevant < relevantSize; iRelevant++)
+		{
+			pushTopK(topK, relevantKeys[iRelevant], mTopK);
+		}
+
+		//the precision at k does not depend on the order within the top k
+		int matches = 0;
+		for (int iResult = 0; iResult < topK.size(); iResult++)
+		{
+			if (mModel.getQID(topK[iResult].mElement) == queryid)
+			{
+				matches++;
+			}
+		}
 
-	return evalQuery;
+		//a model smaller than k cannot fill the top k
+		_evaluation->mPrecisionAtK = static_cast<float>(matches) / static_cast<float>(std::min(mTopK, mModel.size()));
+	}
+
+	//release the keys, only the evaluated query is kept
+	std::vector<RankedElement>().swap(_evaluation->mRelevantKeys);
+	std::vector<RankedElement>().swap(_evaluation->mTopK);
+	std::vector<int>().swap(_evaluation->mNonRelevantCounts);
+	std::vector<double>().swap(_evaluation->mChunkSearchTimes);
+
+	//the workers finish out of order, the progress counts the evaluated queries
+	{
+		boost::mutex::scoped_lock lock(mProgressMutex);
+		showProgress("Queries", mEvaluatedQueries++, mQueryCount);
+	}
+}
+
+void trecvid::TRECVidValuation::pushTopK(std::vector<RankedElement>& _heap, const RankedElement& _key, int _k)
+{
+	if (_heap.size() < _k)
+	{
+		_heap.push_back(_key);
+		std::push_heap(_heap.begin(), _heap.end());
+	}
+	else if (_key < _heap.front())
+	{
+		std::pop_heap(_heap.begin(), _heap.end());
+		_heap.back() = _key;
+		std::push_heap(_heap.begin(), _heap.end());
+	}
+}
+
+trecvid::TRECVidValuation::QueryEvaluation::~QueryEvaluation()
+{
+	delete mResult;
 }
 
 bool trecvid::TRECVidValuation::appendValuesToCSVTemplate(std::string type, std::vector<std::pair<int, float>> values) const
@@ -488,7 +1576,7 @@ bool trecvid::TRECVidValuation::appendValuesToCSVTemplate(std::string type, std:
 	std::vector<std::string> newLine(elems);
 
 	//first column is the model name
-	newLine.at(0) = mFeatures->mDirName + ",";
+	newLine.at(0) = mFeatureSetName + ",";
 	//second is the type of values
 	newLine.at(0) += type + ",";
 
@@ -5,7 +5,18 @@
 #include "avsquery.hpp"
 #include <defuse.hpp>
 #include "avsfeatures.hpp"
+#include "signaturestore.hpp"
+#include "featurecollection.hpp"
+#include "workstealingpool.hpp"
+#include "lrucache.hpp"
+#include "distancematrix.hpp"
+#include "sqfdistance.hpp"
+#include "pivotindex.hpp"
 #include <unordered_map>
+#include <map>
+#include <atomic>
+#include <limits>
+#include <boost/thread/mutex.hpp>
 
 
 namespace trecvid {
@@ -18,12 +29,75 @@ namespace trecvid {
 
 		defuse::Distance* mDistance;
 
+		/**
+		* \brief distance of the sqfd backend, used instead of mDistance if it is set
+		*/
+		SQFDistance* mSQFD;
+
+		/**
+		* \brief skip elements whose lower bound excludes them from the ranking (sqfd only)
+		*/
+		bool mPruning;
+
+		/**
+		* \brief self-similarity of each model element for the sqfd, so that a distance only computes the cross term
+		*/
+		std::vector<float> mSelfSimilarities;
+
+		/**
+		* \brief norm of each model element in the feature space of the sqfd, empty if there is no pruning
+		*/
+		std::vector<float> mNorms;
+
+		/**
+		* \brief file of the pivot index (empty = the lower bound is the difference of the norms)
+		*/
+		std::string mIndexFile;
+
+		/**
+		* \brief number of pivots of a new index
+		*/
+		int mPivots;
+
+		/**
+		* \brief encoding of the model rows in memory, FLOAT32 keeps the model as it is loaded
+		*/
+		Quantizer::Encoding mEncoding;
+
+		/**
+		* \brief evaluate the float model first and report the change of the mean average precision of the encoded model
+		*/
+		bool mBaseline;
+
+		/**
+		* \brief pivot index of the model, its bound tightens the pruning and it ranks the requests of the daemon mode
+		*/
+		PivotIndex mIndex;
+
 		defuse::Xtractor* mXtractor;
 
-		std::vector<AVSFeatures*> mModel;
+		/**
+		* \brief all signatures of the collection, queries are indices into the model
+		*/
+		SignatureStore mModel;
 
 		Directory* mFeatures;
 
+		/**
+		* \brief collection file, used instead of the feature directory if --indir is a file
+		*/
+		File* mCollectionFile;
+
+		/**
+		* \brief mapping of the collection file, the model is attached to it
+		*/
+		FeatureCollection mCollection;
+
+		/**
+		* \brief name of the feature directory or collection, used for the log and the csv template
+		*/
+		std::string mFeatureSetName;
+
 		File* mGroundTruth;
 
 		File* mMAPValues;
@@ -36,8 +110,173 @@ namespace trecvid {
 
 		float mAVGMeanAverageComputationTime;
 
+		/**
+		* \brief number of worker threads of the evaluation pool
+		*/
+		int mThreads;
+
+		/**
+		* \brief number of model elements compared by one evaluation task
+		*/
+		int mChunkSize;
+
+		/**
+		* \brief number of best results per query that are counted for the precision at k (0 = none)
+		*/
+		int mTopK;
+
+		/**
+		* \brief number of evaluated and of all queries (progress only)
+		*/
+		std::atomic<int> mEvaluatedQueries;
+
+		int mQueryCount;
+
+		/**
+		* \brief guards the progress output, the workers finish their queries concurrently
+		*/
+		boost::mutex mProgressMutex;
+
+		/**
+		* \brief path of the local socket of the daemon mode (empty = evaluation of the ground truth)
+		*/
+		std::string mSocket;
+
+		/**
+		* \brief index of each shot (vid, sid) in the model, used by the daemon mode
+		*/
+		std::map<std::pair<int, int>, int> mShotIndex;
+
+		/**
+		* \brief replies of recent requests of the daemon mode
+		*/
+		vretbox::LRUCache<std::string, std::string> mReplies;
+
+		/**
+		* \brief seconds until the daemon mode closes an idle connection
+		*/
+		int mTimeout;
+
+		/**
+		* \brief resident evaluation pool of the daemon mode
+		*/
+		vretbox::WorkStealingPool* mPool;
+
+		/**
+		* \brief file of the persistent distance matrix (empty = distances are computed during the evaluation)
+		*/
+		std::string mMatrixFile;
+
+		/**
+		* \brief distances of all queries to the model, used instead of the distance if it is open
+		*/
+		DistanceMatrix mMatrix;
+
+		/**
+		* \brief settings of the distance, part of the tag of the distance matrix
+		*/
+		std::string mDistanceSettings;
+
+		/**
+		* \brief true if the distance is symmetric (bidirectional smd)
+		*/
+		bool mSymmetric;
+
 	public:
 
+		/**
+		* \brief Ranking key of a model element; elements with the same distance are ordered by their index
+		*/
+		struct RankedElement
+		{
+			float mDistance;
+
+			int mElement;
+
+			float mSearchTime;
+
+			bool operator<(const RankedElement& _other) const
+			{
+				return mDistance < _other.mDistance || (mDistance == _other.mDistance && mElement < _other.mElement);
+			}
+		};
+
+		/**
+		* \brief State of one query while its model chunks are evaluated by the pool.
+		* Only the relevant elements (same query id) and the top k elements are kept, the other distances
+		* are counted per gap between two relevant elements, which is sufficient for the average precision.
+		*/
+		struct QueryEvaluation
+		{
+			/**
+			* \brief index of the query in the model
+			*/
+			int mQuery;
+
+			/**
+			* \brief indices of the relevant elements in the model
+			*/
+			const std::vector<int>* mRelevant;
+
+			/**
+			* \brief ranking keys of the relevant elements, sorted
+			*/
+			std::vector<RankedElement> mRelevantKeys;
+
+			/**
+			* \brief number of non-relevant elements ranked before relevant key i and after key i - 1
+			*/
+			std::vector<int> mNonRelevantCounts;
+
+			/**
+			* \brief best k elements of all finished chunks, sorted
+			*/
+			std::vector<RankedElement> mTopK;
+
+			/**
+			* \brief distance of the k-th element of mTopK if it is full, otherwise infinity;
+			* an element whose lower bound exceeds it cannot enter the top k
+			*/
+			std::atomic<float> mTopKBound;
+
+			/**
+			* \brief number of computed and of pruned distances of the non-relevant elements
+			*/
+			int mComputed;
+
+			int mPruned;
+
+			/**
+			* \brief search time of the relevant elements and of each chunk
+			*/
+			double mRelevantSearchTime;
+
+			std::vector<double> mChunkSearchTimes;
+
+			/**
+			* \brief guards the merge of the chunk results
+			*/
+			boost::mutex mMutex;
+
+			/**
+			* \brief number of chunks that are not evaluated yet
+			*/
+			std::atomic<int> mOpenChunks;
+
+			defuse::EvaluatedQuery* mResult;
+
+			/**
+			* \brief precision of the top k results
+			*/
+			float mPrecisionAtK;
+
+			QueryEvaluation(int _query, const std::vector<int>* _relevant)
+				: mQuery(_query), mRelevant(_relevant), mTopKBound(std::numeric_limits<float>::infinity()), mComputed(0), mPruned(0),
+				mRelevantSearchTime(0.0), mOpenChunks(0), mResult(nullptr), mPrecisionAtK(0.0) {}
+
+			~QueryEvaluation();
+		};
+
 		/**
 		* \brief
 		*/
@@ -60,21 +299,161 @@ namespace trecvid {
 		*/
 		~TRECVidValuation() override;
 
+		/**
+		* \brief Reads the ground truth and all signatures into the model
+		* \param _queries filled with the indices of the model elements of each query id (0 = not in the ground truth)
+		* \return true if the model is loaded, otherwise false
+		*/
+		bool loadModel(std::unordered_map<int, std::vector<int>>& _queries);
+
+		/**
+		* \brief Opens the distance matrix of the queries and the model, it is computed and written first
+		* if the file is missing or belongs to other features, distance settings or another model
+		* \return true if the matrix is open, otherwise the distances are computed during the evaluation
+		*/
+		bool prepareMatrix();
 
+		/**
+		* \brief Reads the pivot index of the model, it is built and written first if the file is missing
+		* or belongs to other features, distance settings or another model
+		* \return true if the index is available
+		*/
+		bool prepareIndex();
 
 		/**
-		* \brief Evaluates the mean average precision for the set of _queries
-		* \param _queryid unique number
-		* \param _queries set of queries related to the unique number
-		* \return a triple of the evaluated interim results, its mean average precision value and its average compution time
+		* \brief Evaluates all queries of the ground truth with the pool; the mean average precision and the
+		* computation time of each group are collected and their means are logged
+		* \param _queries indices of the model elements of each query id
 		*/
-		std::tuple<std::vector<std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>>>, float, float> evaluate(int _queryid, std::vector<AVSFeatures*> _queries);
+		void evaluate(std::unordered_map<int, std::vector<int>>& _queries);
 
-		void evaluateInParallel(int _queryid, std::vector<AVSFeatures*> _queries);
+		/**
+		* \brief
+		* \return mean of the mean average precisions of all groups of the last evaluation
+		*/
+		float getMeanAveragePrecision() const;
 
-		std::pair<defuse::EvaluatedQuery*, std::vector<defuse::ResultBase*>> evaluate(AVSFeatures* _query);
+		/**
+		* \brief Encodes the rows of the model with mEncoding
+		* \return false if the model cannot be encoded
+		*/
+		bool quantizeModel();
 
-		defuse::EvaluatedQuery* evaluate(AVSFeatures* _query, std::vector<defuse::ResultBase*> _results, float _avgSearchTime);
+		/**
+		* \brief Sets the signature of a model element: the encoded rows for the sqfd of a quantized model,
+		* otherwise the float rows (a decoded copy if the model is quantized)
+		* \param _element model index
+		* \param _features
+		*/
+		void getFeatures(int _element, AVSFeatures& _features) const;
+
+		/**
+		* \brief Computes the self-similarities of all model elements with the pool (sqfd only)
+		* and their norms, if the sqfd lower bound is used for pruning
+		*/
+		void prepareSignatures();
+
+		/**
+		* \brief
+		* \param _element model index
+		* \return self-similarity of a model element, 0 if the distance is not the sqfd
+		*/
+		float getSelfSimilarity(int _element) const;
+
+		/**
+		* \brief Collects the model elements [_begin, _end) with their sqfd lower bound, ascending by the bound
+		* \param _queryNorm norm of the query, negative = no bound, the elements keep the order of the model
+		* \param _queryPivots distances of the query to the pivots of the index, nullptr = the norms are the only bound
+		* \param _begin
+		* \param _end
+		* \param _skippedQID elements of this query id are skipped (-1 = none)
+		* \param _candidates pairs of lower bound and model index
+		*/
+		void orderByLowerBound(float _queryNorm, const float* _queryPivots, int _begin, int _end, int _skippedQID, std::vector<std::pair<float, int>>& _candidates) const;
+
+		/**
+		* \brief
+		* \param _query
+		* \param _querySelfSimilarity self-similarity of the query (sqfd only)
+		* \param _element model index of the element
+		* \param _elementFeatures features with the signature of the element
+		* \return distance of the configured backend
+		*/
+		float computeDistance(AVSFeatures& _query, float _querySelfSimilarity, int _element, AVSFeatures& _elementFeatures) const;
+
+		/**
+		* \brief Distance of a query to a model element, read from the distance matrix if the query has a row
+		* \param _row row of the query in the distance matrix, -1 = compute the distance
+		* \param _element model index of the element
+		* \param _query features of the query
+		* \param _querySelfSimilarity self-similarity of the query (sqfd only)
+		* \param _elementFeatures features, the signature of the element is set
+		* \param _searchTime time of the distance computation
+		* \return
+		*/
+		float getDistance(int _row, int _element, AVSFeatures& _query, float _querySelfSimilarity, AVSFeatures& _elementFeatures, float& _searchTime) const;
+
+		/**
+		* \brief Daemon mode: keeps the model and the distance resident and answers requests of a local socket
+		* until a shutdown request is received. Each line is one request, the reply is the ranking
+		* (<rank>,<vid>,<sid>,<qid>,<distance>,<filename> per line) or error,<message>, terminated by an empty line.
+		* Requests:
+		*	file <k> <feature file>
+		*	shot <k> <vid> <sid>
+		*	signature <k> <rows> <cols> <values row by row>
+		*	shutdown
+		* k = 0 uses Cfg.valuation.topk. The connections are read concurrently, a connection without a request
+		* for Cfg.valuation.timeout seconds is closed; the requests themselves are ranked one after the other.
+		*/
+		void serve();
+
+		/**
+		* \brief Answers one request of the daemon mode, recent replies are served from the cache;
+		* the reply of a feature file is cached per modification time and size of the file
+		* \param _request
+		* \param _shutdown set to true by a shutdown request
+		* \return the reply including the terminating empty line
+		*/
+		std::string answer(const std::string& _request, bool& _shutdown);
+
+		/**
+		* \brief Ranks the whole model by the distance to a signature with the resident pool.
+		* If the norms are available, the elements of a chunk are visited by ascending lower bound and the rest
+		* of the chunk is skipped as soon as the bound exceeds the k-th distance found so far, the top k stays exact.
+		* If the pivot index is available, it ranks the model instead.
+		* \param _query signature
+		* \param _k number of results
+		* \param _ranking the best _k elements, sorted
+		* \param _pruned number of elements whose distance was not computed
+		*/
+		void rankModel(const cv::Mat& _query, int _k, std::vector<RankedElement>& _ranking, int& _pruned);
+
+		/**
+		* \brief Ranks the relevant elements of a query, splits the rest of the model into chunks and spawns them in the pool
+		* \param _pool evaluation pool
+		* \param _worker index of the calling worker
+		* \param _evaluation state of the query
+		*/
+		void evaluateInParallel(vretbox::WorkStealingPool* _pool, int _worker, QueryEvaluation* _evaluation);
+
+		/**
+		* \brief Computes the distances of a query to the non-relevant model elements [_begin, _end)
+		* and merges their counts and top k into the query; the task finishing the last chunk ranks the query.
+		* If the norms are available, an element whose lower bound exceeds the distance of the last relevant element
+		* and the k-th distance of the top k is counted in the last gap without computing its distance.
+		*/
+		void evaluateChunk(QueryEvaluation* _evaluation, int _chunk, int _begin, int _end);
+
+		/**
+		* \brief Computes the average precision of the query from the ranks of its relevant elements
+		* and the precision at k from the merged top k, which is released afterwards
+		*/
+		void rankQuery(QueryEvaluation* _evaluation);
+
+		/**
+		* \brief Keeps the best _k keys of a max heap
+		*/
+		static void pushTopK(std::vector<RankedElement>& _heap, const RankedElement& _key, int _k);
 
 		/**
 		 * \brief Append evaluation values to csv template. Examples can be found in trecvid-maps.csv
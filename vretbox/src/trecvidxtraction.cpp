@@ -18,10 +18,17 @@
 
 #include "trecvidxtraction.hpp"
 #include "mastershot.hpp"
+#include "avsfeatures.hpp"
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
 
 
 trecvid::TRECVidXtraction::TRECVidXtraction()
-	: mXtractor(nullptr), mVideo(nullptr), mFeatures(nullptr), mXtractionTimes(nullptr)
+	: mXtractor(nullptr), mVideo(nullptr), mFeatures(nullptr), mXtractionTimes(nullptr), mFeatureDir(nullptr), mMasterShots(nullptr), mNextVideo(0), mFinishedVideos(0)
 {
 	mArgs = nullptr;
 }
@@ -31,10 +38,112 @@ bool trecvid::TRECVidXtraction::init(boost::program_options::variables_map _args
 	mArgs = _args;
 	bool areArgsValid = true;
 
-	mVideo = new File(mArgs["infile"].as< std::string >());
-	mFeatures = new File(mArgs["outfile"].as< std::string >());
 	mXtractionTimes = new File(mArgs["General.measurements"].as< std::string >());
 
+	mXtractor = createXtractor(true);
+	if (mXtractor == nullptr)
+	{
+		return false;
+	}
+
+	std::string xtractorID = static_cast<defuse::DYSIGXtractor *>(mXtractor)->getXtractorID();
+	mXtractionTimes->extendFileName(xtractorID);
+
+	//master shot mode: all master shots of a full video are extracted without splitting the video
+	if (mArgs.count("msbfile"))
+	{
+		if (!mArgs.count("infile") || !mArgs.count("outfile"))
+		{
+			LOG_FATAL("The master shot mode requires --infile (full video) and --outfile (output directory)");
+			return false;
+		}
+
+		//the features are stored under the ID of the DYSIG extractor, thus its sample points and settings are required
+		mSignatures = createSignatures(mArgs);
+		if (mSignatures.empty())
+		{
+			return false;
+		}
+
+		mVideo = new File(mArgs["infile"].as< std::string >());
+		mMasterShots = new File(mArgs["msbfile"].as< std::string >());
+		mFeatureDir = new Directory(mArgs["outfile"].as< std::string >());
+
+		openCache(mFeatureDir->getPath(), xtractorID);
+	}
+	//batch mode: a directory or a list of master shots is processed by warm extractors
+	else if (mArgs.count("indir") || mArgs.count("filelist"))
+	{
+		if (!mArgs.count("outfile"))
+		{
+			LOG_FATAL("The batch mode requires --indir or --filelist (master shots) and --outfile (output directory)");
+			return false;
+		}
+
+		if (mArgs.count("indir"))
+		{
+			Directory indir(mArgs["indir"].as< std::string >());
+			mVideos = cplusutil::FileIO::getFileListFromDirectory(indir.getPath());
+		}
+		else
+		{
+			std::ifstream filelist(mArgs["filelist"].as< std::string >());
+			if (!filelist.is_open())
+			{
+				LOG_FATAL("File list " << mArgs["filelist"].as< std::string >() << " cannot be opened");
+				return false;
+			}
+
+			std::string line;
+			while (std::getline(filelist, line))
+			{
+				//skip empty lines and windows line endings
+				line.erase(line.find_last_not_of(" \r\n\t") + 1);
+				if (!line.empty())
+				{
+					mVideos.push_back(line);
+				}
+			}
+		}
+
+		mFeatureDir = new Directory(mArgs["outfile"].as< std::string >());
+		openCache(mFeatureDir->getPath(), xtractorID);
+
+		//a batch appends many lines, the single video processes of a collection leave the compaction to it
+		mCache.compact();
+
+		int threads = mArgs["General.threads"].as<int>();
+		if (threads <= 0)
+		{
+			threads = std::max<int>(1, boost::thread::hardware_concurrency());
+		}
+		threads = std::max<int>(1, std::min<int>(threads, int(mVideos.size())));
+
+		//the first worker reuses the extractor created above
+		mXtractors.push_back(mXtractor);
+		for (int iWorker = 1; iWorker < threads; iWorker++)
+		{
+			mXtractors.push_back(createXtractor(false));
+		}
+
+		LOG_INFO("**** " << "Batch of " << mVideos.size() << " master shots with " << threads << " workers");
+		LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
+	}
+	else
+	{
+		mVideo = new File(mArgs["infile"].as< std::string >());
+		mFeatures = new File(mArgs["outfile"].as< std::string >());
+		mFeatures->addDirectoryToPath(xtractorID);
+
+		std::string outdir = boost::filesystem::path(mArgs["outfile"].as< std::string >()).parent_path().string();
+		openCache(outdir.empty() ? "." : outdir, xtractorID);
+	}
+
+	return areArgsValid;
+}
+
+defuse::Xtractor* trecvid::TRECVidXtraction::createXtractor(bool _log) const
+{
 	defuse::DYSIGXtractor::FrameSelection frameSelection;
 	int maxFrames;
 	int initSeeds;
@@ -50,6 +159,8 @@ bool trecvid::TRECVidXtraction::init(boost::program_options::variables_map _args
 	defuse::SamplePoints::Distribution distribution;
 	std::string samplepointdir;
 
+	defuse::Xtractor* xtractor = nullptr;
+
 	if(mArgs["General.descriptor"].as< std::string >() == "ffs")
 	{
 		
@@ -65,9 +176,8 @@ bool trecvid::TRECVidXtraction::init(boost::program_options::variables_map _args
 		}
 		else
 		{
-			frameSelection = defuse::DYSIGXtractor::FrameSelection::FramesPerVideo;
 			LOG_FATAL("Cfg.ffs.frameSelection " << mArgs["Cfg.ffs.frameSelection"].as< std::string >() << " is not defined");
-			areArgsValid = false;
+			return nullptr;
 		}
 
 		resetTracking = mArgs["Cfg.ffs.resetTracking"].as<bool>();
@@ -95,64 +205,425 @@ bool trecvid::TRECVidXtraction::init(boost::program_options::variables_map _args
 		}
 		else
 		{
-			distribution = defuse::SamplePoints::Distribution::REGULAR;
 			LOG_FATAL("Cfg.ffs.distribution " << mArgs["Cfg.ffs.distribution"].as< std::string >() << " is not defined");
-			areArgsValid = false;
+			return nullptr;
 		}
 
 		samplepointdir = mArgs["Cfg.ffs.samplepointdir"].as<std::string>();
 
-		mXtractor = new defuse::DYSIGXtractor(maxFrames, initSeeds, initialCentroids, samplepointdir, distribution);
+		xtractor = new defuse::DYSIGXtractor(maxFrames, initSeeds, initialCentroids, samplepointdir, distribution);
 
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mFrameSelection = frameSelection;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mIterations = iterations;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mMinimalClusterSize = minClusterSize;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mGrayscaleBits = grayscaleBits;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mWindowRadius = windowRadius;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mMinimalDistance = minDistance;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mClusterDropThreshold = dropThreshold;
-		static_cast<defuse::DYSIGXtractor *>(mXtractor)->mResetTracking = resetTracking;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mFrameSelection = frameSelection;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mIterations = iterations;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mMinimalClusterSize = minClusterSize;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mGrayscaleBits = grayscaleBits;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mWindowRadius = windowRadius;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mMinimalDistance = minDistance;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mClusterDropThreshold = dropThreshold;
+		static_cast<defuse::DYSIGXtractor *>(xtractor)->mResetTracking = resetTracking;
 
-		mXtractionTimes->extendFileName(static_cast<defuse::DYSIGXtractor *>(mXtractor)->getXtractorID());
-		mFeatures->addDirectoryToPath(static_cast<defuse::DYSIGXtractor *>(mXtractor)->getXtractorID());
-
-		LOG_INFO("**** " << "TRECVidXtraction Tool " << "**** ");
-		LOG_INFO("**** " << "Settings");
-		LOG_INFO("**** " << static_cast<defuse::DYSIGXtractor *>(mXtractor)->toString());
-		LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
+		if (_log)
+		{
+			LOG_INFO("**** " << "TRECVidXtraction Tool " << "**** ");
+			LOG_INFO("**** " << "Settings");
+			LOG_INFO("**** " << static_cast<defuse::DYSIGXtractor *>(xtractor)->toString());
+			LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
+		}
 
 	}else
 	{
 		LOG_FATAL("Descriptor " << mArgs["General.descriptor"].as< std::string >() << " is not defined");
-		areArgsValid = false;
 	}
 
-	return areArgsValid;
+	return xtractor;
+}
+
+void trecvid::TRECVidXtraction::openCache(std::string _outdir, std::string _xtractorID)
+{
+	if (!mArgs["General.cache"].as<bool>())
+	{
+		return;
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(_outdir, error);
+
+	File manifest(_outdir, _xtractorID + ".manifest.csv");
+	if (!mCache.open(manifest.getFile(), getParameters(), mArgs["General.contenthash"].as<bool>()))
+	{
+		LOG_ERROR("Error: Manifest " << manifest.getFile() << " cannot be written, all inputs are extracted without it");
+	}
+}
+
+std::string trecvid::TRECVidXtraction::getParameters() const
+{
+	std::stringstream parameters;
+	parameters << "General.descriptor=" << mArgs["General.descriptor"].as< std::string >() << "\n";
+
+	//the variables map is ordered by the option names
+	for (auto iOption = mArgs.begin(); iOption != mArgs.end(); ++iOption)
+	{
+		if (iOption->first.compare(0, 8, "Cfg.ffs.") != 0)
+		{
+			continue;
+		}
+
+		const boost::any& value = iOption->second.value();
+		parameters << iOption->first << "=";
+		if (const int* number = boost::any_cast<int>(&value))
+		{
+			parameters << *number;
+		}
+		else if (const float* real = boost::any_cast<float>(&value))
+		{
+			parameters << *real;
+		}
+		else if (const bool* flag = boost::any_cast<bool>(&value))
+		{
+			parameters << *flag;
+		}
+		else if (const std::string* text = boost::any_cast<std::string>(&value))
+		{
+			parameters << *text;
+		}
+		parameters << "\n";
+	}
+
+	//the master shot mode uses its own extractor
+	parameters << "mode=" << (mMasterShots != nullptr ? "msb" : "shot") << "\n";
+	return parameters.str();
+}
+
+cv::Ptr<cv::xfeatures2d::PCTSignatures> trecvid::TRECVidXtraction::createSignatures(const boost::program_options::variables_map& _args)
+{
+	std::string distribution = _args["Cfg.ffs.distribution"].as<std::string>();
+	if (distribution != "random" && distribution != "regular")
+	{
+		LOG_FATAL("Cfg.ffs.distribution " << distribution << " is not defined");
+		return cv::Ptr<cv::xfeatures2d::PCTSignatures>();
+	}
+
+	//the tracker matches the signatures of independently clustered frames
+	if (!_args["Cfg.ffs.resetTracking"].as<bool>())
+	{
+		LOG_FATAL("Cfg.ffs.resetTracking = false is not supported by the master shot mode, each frame is clustered from the sample points");
+		return cv::Ptr<cv::xfeatures2d::PCTSignatures>();
+	}
+
+	//the sample points of the DYSIG extractor, shared by all master shots of the video
+	int initSeeds = _args["Cfg.ffs.initSeeds"].as<int>();
+	std::vector<cv::Point2f> initPoints;
+	if (!loadSamplePoints(_args["Cfg.ffs.samplepointdir"].as<std::string>(), distribution, initSeeds, initPoints))
+	{
+		return cv::Ptr<cv::xfeatures2d::PCTSignatures>();
+	}
+
+	cv::Ptr<cv::xfeatures2d::PCTSignatures> signatures = cv::xfeatures2d::PCTSignatures::create(initPoints, _args["Cfg.ffs.initialCentroids"].as<int>());
+	signatures->setIterationCount(_args["Cfg.ffs.iterations"].as<int>());
+	signatures->setClusterMinSize(_args["Cfg.ffs.minClusterSize"].as<int>());
+	signatures->setJoiningDistance(_args["Cfg.ffs.minDistance"].as<float>());
+	signatures->setDropThreshold(_args["Cfg.ffs.dropThreshold"].as<float>());
+	signatures->setGrayscaleBits(_args["Cfg.ffs.grayscaleBits"].as<int>());
+	signatures->setWindowRadius(_args["Cfg.ffs.windowRadius"].as<int>());
+
+	return signatures;
+}
+
+bool trecvid::TRECVidXtraction::loadSamplePoints(std::string _directory, std::string _distribution, int _count, std::vector<cv::Point2f>& _points)
+{
+	File file(_directory, "samplepoints_" + _distribution + "_" + std::to_string(_count) + ".yml");
+
+	cv::FileStorage fs(file.getFile(), cv::FileStorage::READ);
+	if (!fs.isOpened())
+	{
+		LOG_ERROR("Sample points " << file.getFile() << " cannot be read");
+		return false;
+	}
+
+	//the points are stored as x, y pairs
+	std::vector<float> values;
+	fs["SamplePoints"]["SamplePoints"] >> values;
+	fs.release();
+
+	if (values.size() != 2 * size_t(_count))
+	{
+		LOG_ERROR("Sample points " << file.getFile() << " has " << values.size() / 2 << " instead of " << _count << " points");
+		return false;
+	}
+
+	_points.clear();
+	for (int iPoint = 0; iPoint < _count; iPoint++)
+	{
+		_points.push_back(cv::Point2f(values[2 * iPoint], values[2 * iPoint + 1]));
+	}
+	return true;
 }
 
 void trecvid::TRECVidXtraction::run()
 {
-	MasterShot* shot = new MasterShot(mVideo);
+	if (mMasterShots != nullptr)
+	{
+		xtractMasterShots(mVideo, mMasterShots);
+	}
+	else if (!mXtractors.empty())
+	{
+		runBatch();
+	}
+	else
+	{
+		xtract(mXtractor, mVideo, mFeatures);
+	}
 
-	defuse::Features* features = mXtractor->xtract(shot);
-	LOG_INFO("Write Binary");
-	//Process extraction times
-	std::ofstream of(mXtractionTimes->getFile(), std::ofstream::out | std::ofstream::app);
-	of << shot->mVideoFileName << ", " << features->mExtractionTime << "\n";
+	if (mCache.isOpen())
+	{
+		LOG_INFO("**** " << mCache.getHits() << " inputs were already extracted and skipped, " << mCache.getMisses() << " had to be extracted");
+	}
+}
+
+void trecvid::TRECVidXtraction::runBatch()
+{
+	mNextVideo = 0;
+	mFinishedVideos = 0;
 
+	std::vector<boost::thread*> threads;
+	for (int iWorker = 0; iWorker < mXtractors.size(); iWorker++)
+	{
+		threads.push_back(new boost::thread(boost::bind(&TRECVidXtraction::xtractInParallel, this, iWorker)));
+	}
+
+	for (int iThread = 0; iThread < threads.size(); iThread++)
+	{
+		threads[iThread]->join();
+		delete threads[iThread];
+	}
+}
+
+void trecvid::TRECVidXtraction::xtractInParallel(int _worker)
+{
+	defuse::Xtractor* xtractor = mXtractors.at(_worker);
+	std::string xtractorID = static_cast<defuse::DYSIGXtractor *>(xtractor)->getXtractorID();
+
+	int videoSize = mVideos.size();
+	int iVideo;
+	while ((iVideo = mNextVideo++) < videoSize)
+	{
+		File video(mVideos.at(iVideo));
+		File features(mFeatureDir->getPath(), video.getFilename() + ".bin");
+		features.addDirectoryToPath(xtractorID);
+
+		//a broken master shot must not stop the batch
+		try
+		{
+			xtract(xtractor, &video, &features);
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Error: File cannot be handled: " << video.getFile() << " Exception: " << e.what());
+		}
+
+		//the workers finish out of order, the progress counts the finished videos
+		{
+			boost::mutex::scoped_lock lock(mXtractionTimesMutex);
+			mFinishedVideos++;
+			cplusutil::Terminal::showProgress("Xtract master shots ", mFinishedVideos, videoSize);
+		}
+	}
+}
+
+bool trecvid::TRECVidXtraction::xtract(defuse::Xtractor* _xtractor, File* _video, File* _features)
+{
+	std::string fingerprint;
+	if (mCache.isOpen())
+	{
+		fingerprint = mCache.fingerprint(_video->getFile());
+		if (mCache.isXtracted(_video->getFile(), fingerprint, _features->getFile()))
+		{
+			LOG_INFO("Skip " << _video->getFile() << ", it is already extracted");
+			return true;
+		}
+	}
+
+	MasterShot* shot = new MasterShot(_video);
+
+	defuse::Features* features = _xtractor->xtract(shot);
+	if (features == nullptr)
+	{
+		LOG_ERROR("Error: No features extracted from " << _video->getFile());
+		mCache.update(_video->getFile(), fingerprint, false);
+		delete shot;
+		return false;
+	}
+
+	LOG_INFO("Write Binary");
 	//Save features
-	features->writeBinary(mFeatures->getFile());
+	double serializationStart = double(cv::getTickCount());
+	features->writeBinary(_features->getFile());
+	double serializationTime = (double(cv::getTickCount()) - serializationStart) / double(cv::getTickFrequency());
+	mCache.update(_video->getFile(), fingerprint, true);
+
+	//Process extraction times, the stages inside the xtractor are not measured, their columns stay empty
+	//so that all lines of the file have the columns of the master shot extraction
+	{
+		boost::mutex::scoped_lock lock(mXtractionTimesMutex);
+		std::ofstream of(mXtractionTimes->getFile(), std::ofstream::out | std::ofstream::app);
+		of << shot->mVideoFileName << ", " << features->mExtractionTime << ", , , , , , , " << serializationTime << ", , \n";
+	}
 	LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
 
+	delete features;
 	delete shot;
+	return true;
+}
+
+bool trecvid::TRECVidXtraction::xtractMasterShots(File* _video, File* _masterShots)
+{
+	//line number is the shot id in msb files
+	std::vector<std::pair<int, int> > boundaries;
+	{
+		std::ifstream msb(_masterShots->getFile());
+		if (!msb.is_open())
+		{
+			LOG_ERROR("Error: Master shot boundaries " << _masterShots->getFile() << " cannot be opened");
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(msb, line))
+		{
+			int start, end;
+			if (std::sscanf(line.c_str(), "%d,%d", &start, &end) != 2 || end < start)
+			{
+				LOG_ERROR("Error: Invalid master shot boundary " << boundaries.size() + 1 << " in " << _masterShots->getFile() << ": " << line);
+				return false;
+			}
+			boundaries.push_back(std::make_pair(start, end));
+		}
+	}
+
+	analysis::tpct_signatures::FrameReader reader(_video->getFile());
+	if (!reader.isOpened())
+	{
+		return false;
+	}
+
+	analysis::tpct_signatures::TPCTPipeline pipeline(mSignatures);
+
+	std::string xtractorID = static_cast<defuse::DYSIGXtractor *>(mXtractor)->getXtractorID();
+	int maxFrames = mArgs["Cfg.ffs.maxFrames"].as<int>();
+	bool perSecond = mArgs["Cfg.ffs.frameSelection"].as<std::string>() == "FramesPerSecond";
+
+	//the attributes of the master shot file names as written by divdeo.sh (fps is truncated to two decimals)
+	int vid = cplusutil::String::extractIntFromString(_video->getFilename());
+	double fps = reader.getFps();
+	char fpsName[32];
+	std::snprintf(fpsName, sizeof(fpsName), "%.2f", std::floor(fps * 100 + 1e-6) / 100);
+	std::string attributes = std::string(fpsName) + "_" + std::to_string(reader.getWidth()) + "x" + std::to_string(reader.getHeight());
+
+	LOG_INFO("**** " << "Master shot mode: " << boundaries.size() << " master shots of " << _video->getFile());
+
+	//the master shots share the fingerprint of the full video
+	std::string fingerprint;
+	if (mCache.isOpen())
+	{
+		fingerprint = mCache.fingerprint(_video->getFile());
+	}
+
+	bool isValid = true;
+	for (int iShot = 0; iShot < boundaries.size(); iShot++)
+	{
+		cplusutil::Terminal::showProgress("Xtract master shots ", iShot + 1, boundaries.size());
+
+		int sid = iShot + 1;
+		int start = boundaries.at(iShot).first;
+		int end = boundaries.at(iShot).second;
+		std::string name = std::to_string(vid) + "_" + std::to_string(sid) + "_" + std::to_string(start) + "-" + std::to_string(end) + "_" + attributes;
+
+		File file(mFeatureDir->getPath(), name + ".bin");
+		file.addDirectoryToPath(xtractorID);
+
+		std::string key = _video->getFile() + "#" + name;
+		if (mCache.isOpen() && mCache.isXtracted(key, fingerprint, file.getFile()))
+		{
+			continue;
+		}
+
+		//the master shots are ascending, thus the reader only decodes forward through the video
+		std::vector<int> frames = analysis::tpct_signatures::FrameReader::selectFrames(end - start + 1, fps, maxFrames, perSecond);
+		for (int iFrame = 0; iFrame < frames.size(); iFrame++)
+		{
+			frames.at(iFrame) += start;
+		}
+		reader.setFrames(frames);
+
+		AVSFeatures features(vid, sid);
+		//divdeo.sh stores single frame shots as image
+		features.setFilename(name + (start == end ? ".jpg" : ".mp4"));
+
+		cv::xfeatures2d::pct_signatures::StageTimes times;
+		double xtractionStart = double(cv::getTickCount());
+		try
+		{
+			if (pipeline.computeTemporalSignature(boost::bind(&analysis::tpct_signatures::FrameReader::next, &reader, _1), features.mVectors, &times) == 0)
+			{
+				LOG_ERROR("Error: No frames read from " << _video->getFile() << " for master shot " << name);
+				mCache.update(key, fingerprint, false);
+				isValid = false;
+				continue;
+			}
+		}
+		catch (std::exception& e)
+		{
+			LOG_ERROR("Error: Master shot cannot be handled: " << name << " Exception: " << e.what());
+			mCache.update(key, fingerprint, false);
+			isValid = false;
+			continue;
+		}
+		features.setExtractionTime(float((double(cv::getTickCount()) - xtractionStart) / double(cv::getTickFrequency())));
+
+		//Save features
+		double serializationStart = double(cv::getTickCount());
+		features.writeBinary(file.getFile());
+		double serializationTime = (double(cv::getTickCount()) - serializationStart) / double(cv::getTickFrequency());
+		mCache.update(key, fingerprint, true);
+
+		//Process extraction times, the stages run concurrently and may add up to more than the total
+		{
+			boost::mutex::scoped_lock lock(mXtractionTimesMutex);
+			std::ofstream of(mXtractionTimes->getFile(), std::ofstream::out | std::ofstream::app);
+			of << features.getFilename() << ", " << features.getExtractionTime() << ", "
+				<< times.mDecoding << ", " << times.mBitmap << ", " << times.mTexture << ", " << times.mSampling << ", "
+				<< times.mClustering << ", " << times.mTracking << ", " << serializationTime << ", "
+				<< times.mFrames << ", " << times.mSamples << "\n";
+		}
+	}
+
+	LOG_INFO("**** " << "Decoded " << reader.getDecodedCount() << " frames with " << reader.getSeekCount() << " seeks");
+	LOG_INFO("* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *");
+	return isValid;
+}
+
+const File* trecvid::TRECVidXtraction::getXtractionTimes() const
+{
+	return mXtractionTimes;
+}
+
+std::string trecvid::TRECVidXtraction::getXtractorID() const
+{
+	return static_cast<defuse::DYSIGXtractor *>(mXtractor)->getXtractorID();
 }
 
 trecvid::TRECVidXtraction::~TRECVidXtraction()
 {
+	//the first worker shares its extractor with mXtractor
+	for (int iWorker = 1; iWorker < mXtractors.size(); iWorker++)
+	{
+		delete mXtractors.at(iWorker);
+	}
+
 	delete mXtractor;
 	delete mVideo;
 	delete mFeatures;
 	delete mXtractionTimes;
+	delete mFeatureDir;
+	delete mMasterShots;
 }
-
-
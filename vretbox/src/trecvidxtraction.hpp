@@ -2,7 +2,11 @@
 #define  _TRECVIDXTRACTION_HPP_
 
 #include "toolbase.hpp"
+#include "xtractioncache.hpp"
 #include <defuse.hpp>
+#include <cvtfsig.h>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
 
 namespace trecvid {
 
@@ -20,30 +24,151 @@ namespace trecvid {
 
 		File* mXtractionTimes;
 
+		/**
+		 * \brief one warm extractor per worker thread (batch mode only)
+		 */
+		std::vector<defuse::Xtractor*> mXtractors;
+
+		/**
+		 * \brief input videos of the batch, given via --indir or --filelist
+		 */
+		std::vector<std::string> mVideos;
+
+		/**
+		 * \brief output directory of the batch (--outfile)
+		 */
+		Directory* mFeatureDir;
+
+		/**
+		 * \brief master shot boundaries of the full input video (--msbfile), one <start>,<end> per line
+		 */
+		File* mMasterShots;
+
+		/**
+		 * \brief static signature extractor of the master shot mode
+		 */
+		cv::Ptr<cv::xfeatures2d::PCTSignatures> mSignatures;
+
+		/**
+		 * \brief index of the next video to be processed by any worker
+		 */
+		std::atomic<int> mNextVideo;
+
+		/**
+		 * \brief guards the consolidated extraction times file and the progress of the batch
+		 */
+		boost::mutex mXtractionTimesMutex;
+
+		/**
+		 * \brief number of videos finished by any worker, guarded by mXtractionTimesMutex
+		 */
+		int mFinishedVideos;
+
+		/**
+		 * \brief manifest of the already extracted inputs, an input is skipped if neither its video nor the parameters changed
+		 */
+		XtractionCache mCache;
+
 	public:
 
 		/**
-		 * \brief 
+		 * \brief
 		 */
 		TRECVidXtraction();
 
 		/**
-		 * \brief 
-		 * \param _args 
-		 * \return 
+		 * \brief
+		 * \param _args
+		 * \return
 		 */
 		bool init(boost::program_options::variables_map _args) override;
 
 		/**
-		 * \brief 
+		 * \brief
 		 */
 		void run() override;
 
 		/**
-		 * \brief 
+		 * \brief
 		 */
 		~TRECVidXtraction() override;
+
+		/**
+		 * \brief Creates an extractor according to the configuration
+		 * \param _log log the settings of the extractor
+		 * \return the extractor or nullptr if the configuration is invalid
+		 */
+		defuse::Xtractor* createXtractor(bool _log) const;
+
+		/**
+		 * \brief Extracts all videos of the batch with one extractor per worker
+		 */
+		void runBatch();
+
+		/**
+		 * \brief Worker loop; fetches videos until the batch is exhausted
+		 * \param _worker index of the worker and its extractor
+		 */
+		void xtractInParallel(int _worker);
+
+		/**
+		 * \brief Extracts the features of one video and appends its extraction time; skipped if the manifest lists the video as extracted
+		 * \param _xtractor extractor of the calling worker
+		 * \param _video input video
+		 * \param _features output file
+		 * \return true if the extraction was successful, otherwise false
+		 */
+		bool xtract(defuse::Xtractor* _xtractor, File* _video, File* _features);
+
+		/**
+		 * \brief Extracts the features of all master shots of a full video in one decoding pass;
+		 *		the feature files are named like the master shots of divdeo.sh (<vid>_<sid>_<start>-<end>_<fps>_<W>x<H>.bin)
+		 * \param _video full input video
+		 * \param _masterShots master shot boundaries of the video
+		 * \return true if all master shots were extracted, otherwise false
+		 */
+		bool xtractMasterShots(File* _video, File* _masterShots);
+
+		/**
+		 * \brief Creates a static signature extractor with the Cfg.ffs settings and the stored sample points of the DYSIG extractor.
+		 * Every frame is clustered from the sample points, thus Cfg.ffs.resetTracking = false is rejected.
+		 * \param _args
+		 * \return the extractor or an empty pointer if the configuration is invalid or the sample points cannot be read
+		 */
+		static cv::Ptr<cv::xfeatures2d::PCTSignatures> createSignatures(const boost::program_options::variables_map& _args);
+
+		/**
+		 * \brief Reads the stored sample points samplepoints_<distribution>_<count>.yml
+		 * \param _directory Cfg.ffs.samplepointdir
+		 * \param _distribution Cfg.ffs.distribution
+		 * \param _count
+		 * \param _points
+		 * \return false if the file is missing or has another number of points
+		 */
+		static bool loadSamplePoints(std::string _directory, std::string _distribution, int _count, std::vector<cv::Point2f>& _points);
+
+		/**
+		 * \brief Opens the manifest <xtractor ID>.manifest.csv next to the feature directory (General.cache),
+		 * without a writable manifest all inputs are extracted
+		 * \param _outdir directory that contains the feature directory of the extractor
+		 * \param _xtractorID
+		 */
+		void openCache(std::string _outdir, std::string _xtractorID);
+
+		/**
+		 * \brief
+		 * \return file of the extraction times, its name is extended by the xtractor ID
+		 */
+		const File* getXtractionTimes() const;
+
+		std::string getXtractorID() const;
+
+		/**
+		 * \brief Full parameter set of the extraction: the descriptor, all Cfg.ffs settings and the mode
+		 * \return one <option>=<value> line per setting
+		 */
+		std::string getParameters() const;
 	};
 }
 
-#endif //_TRECVIDXTRACTION_HPP_
\ No newline at end of file
+#endif //_TRECVIDXTRACTION_HPP_
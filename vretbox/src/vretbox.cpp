@@ -60,6 +60,18 @@ int main(int argc, char const *argv[]) {
 	{
 		tool = new trecvid::TRECVidUpdate();
 	}
+	else if (args["tool"].as< std::string >() == "trecvid-pack")
+	{
+		tool = new trecvid::TRECVidPack();
+	}
+	else if (args["tool"].as< std::string >() == "trecvid-benchmark")
+	{
+		tool = new trecvid::TRECVidBenchmark();
+	}
+	else if (args["tool"].as< std::string >() == "trecvid-regression")
+	{
+		tool = new trecvid::TRECVidRegression();
+	}
 	else
 	{
 		LOG_FATAL(PROGNAME << " Error: Tool "<< args["tool"].as< std::string >() << " is not defined.");
@@ -73,7 +85,8 @@ int main(int argc, char const *argv[]) {
 		}
 		catch (std::exception& e)
 		{
-			LOG_FATAL(args["tool"].as< std::string >() << " Error: File cannot be handled: " << args["infile"].as< std::string >() << " Exception: " << e.what());
+			std::string input = args.count("infile") ? args["infile"].as< std::string >() : args.count("indir") ? args["indir"].as< std::string >() : "";
+			LOG_FATAL(args["tool"].as< std::string >() << " Error: File cannot be handled: " << input << " Exception: " << e.what());
 		}
 
 	}else
@@ -114,6 +127,8 @@ boost::program_options::variables_map processProgramOptions(const int argc, cons
 		("config", boost::program_options::value<std::string>()->default_value("default.ini"), "Configuration file for the settings to be used")
 		("infile,i", boost::program_options::value<std::string>(), "Input file")
 		("indir", boost::program_options::value<std::string>(), "Input directory")
+		("filelist", boost::program_options::value<std::string>(), "Input file containing one input file per line")
+		("msbfile", boost::program_options::value<std::string>(), "Master shot boundaries (<vid>.csv) of the full input video")
 		("outfile,o", boost::program_options::value<std::string >(), "Output file")
 		;
 
@@ -124,7 +139,14 @@ boost::program_options::variables_map processProgramOptions(const int argc, cons
 			"which features should be extracted")
 
 		("General.measurements", boost::program_options::value<std::string>(),
-			"in which file should times are stored")
+			"in which file should times are stored, one line per shot: name, total, decoding, bitmap, texture, sampling, "
+			"clustering, tracking, serialization (seconds), frames, samples; the stages, frames and samples are empty if the xtractor does not report them")
+		("General.threads", boost::program_options::value<int>()->default_value(0),
+			"how many worker threads should be used (0 = number of cores)")
+		("General.cache", boost::program_options::value<bool>()->default_value(true),
+			"should already extracted videos be skipped (manifest <xtractor ID>.manifest.csv next to the feature directory)")
+		("General.contenthash", boost::program_options::value<bool>()->default_value(false),
+			"should a video be identified by the hash of its content instead of its size and modification time")
 
 		("Cfg.ffs.maxFrames", boost::program_options::value<int>()->default_value(5), 
 			"how many frames should be used")
@@ -161,7 +183,7 @@ boost::program_options::variables_map processProgramOptions(const int argc, cons
 			"which list of master shots should be eleminated")
 		
 		("General.distance", boost::program_options::value<std::string>()->default_value("smd"),
-			"which distance should be used")
+			"which distance should be used: smd, sqfd")
 		("Cfg.smd.grounddistance", boost::program_options::value<std::string>()->default_value("L2"),
 			"which groundistance should be used with in connection with smd")
 		("Cfg.smd.matchingstrategy", boost::program_options::value<std::string>()->default_value("nearest-neighbor"),
@@ -172,6 +194,80 @@ boost::program_options::variables_map processProgramOptions(const int argc, cons
 			"which costfunction should be used in smd")
 		("Cfg.smd.lambda", boost::program_options::value<float>()->default_value(1.0),
 			"which value of lambda should be used with smd (only neceassary with bidirectional matching strategy)")
+		("Cfg.sqfd.grounddistance", boost::program_options::value<std::string>()->default_value("L2"),
+			"which groundistance should be used with in connection with sqfd: L1, L2")
+		("Cfg.sqfd.similarity", boost::program_options::value<std::string>()->default_value("heuristic"),
+			"which similarity of two centroids should be used in sqfd: heuristic, minus")
+		("Cfg.sqfd.alpha", boost::program_options::value<float>()->default_value(1.0),
+			"which value of alpha should be used with the heuristic similarity 1 / (alpha + distance)")
+
+		//All possible options that will be allowed in config file for the valuation tool
+		("Cfg.valuation.chunksize", boost::program_options::value<int>()->default_value(256),
+			"how many model elements should be compared with a query in one task")
+		("Cfg.valuation.topk", boost::program_options::value<int>()->default_value(1000),
+			"how many results of each query should be ranked for the precision at k (0 = none)")
+		("Cfg.valuation.matrix", boost::program_options::value<std::string>()->default_value(""),
+			"file of the persistent distance matrix of all queries, computed once if missing or outdated (empty = distances are computed in each evaluation)")
+		("Cfg.valuation.socket", boost::program_options::value<std::string>()->default_value(""),
+			"local socket of the daemon mode, which keeps the model loaded and answers ranking requests (empty = evaluate the ground truth)")
+		("Cfg.valuation.cachesize", boost::program_options::value<int>()->default_value(128),
+			"how many replies of recent requests should be cached by the daemon mode (0 = none)")
+		("Cfg.valuation.timeout", boost::program_options::value<int>()->default_value(30),
+			"after how many seconds without a request or a read of the reply the daemon mode closes a connection")
+		("Cfg.valuation.pruning", boost::program_options::value<bool>()->default_value(true),
+			"skip distances whose lower bound excludes the element from the exact ranking (sqfd with the heuristic similarity only)")
+		("Cfg.valuation.index", boost::program_options::value<std::string>()->default_value(""),
+			"file of the pivot index of the model, built once if missing or outdated; it tightens the pruning and ranks the requests of the daemon mode (empty = none)")
+		("Cfg.valuation.pivots", boost::program_options::value<int>()->default_value(16),
+			"how many pivots a new pivot index should have")
+		("Cfg.valuation.encoding", boost::program_options::value<std::string>()->default_value("float"),
+			"which encoding the signatures of the model should have in memory: float, fp16, int8 (a packed collection keeps its own encoding)")
+		("Cfg.valuation.baseline", boost::program_options::value<bool>()->default_value(false),
+			"evaluate the float model first and report the change of the mean average precision of the encoded model")
+
+		//All possible options that will be allowed in config file for the pack tool
+		("Cfg.pack.encoding", boost::program_options::value<std::string>()->default_value("float"),
+			"which encoding the signatures of the collection file should have: float, fp16, int8")
+
+		//All possible options that will be allowed in config file for the benchmark tool
+		("Cfg.benchmark.kernels", boost::program_options::value<std::string>()->default_value("sample,contrastentropy,clusterize,sqfd,temporal,evaluate"),
+			"which kernels should be measured: sample, contrastentropy, clusterize, sqfd, temporal, evaluate (evaluate requires --infile and --indir of the valuation)")
+		("Cfg.benchmark.sizes", boost::program_options::value<std::string>()->default_value("50,100,500,1000,2000,4000,5000,8000,10000,20000,40000,80000"),
+			"which numbers of sample points should be measured (samplepoints_random_<size>.yml in Cfg.ffs.samplepointdir)")
+		("Cfg.benchmark.warmup", boost::program_options::value<int>()->default_value(2),
+			"how many unmeasured runs should precede the repetitions of a kernel")
+		("Cfg.benchmark.repetitions", boost::program_options::value<int>()->default_value(10),
+			"how many runs of a kernel should be measured")
+		("Cfg.benchmark.image", boost::program_options::value<std::string>()->default_value(""),
+			"image of which the frames are shifted copies (empty = smoothed noise)")
+		("Cfg.benchmark.width", boost::program_options::value<int>()->default_value(640),
+			"width of the smoothed noise frames")
+		("Cfg.benchmark.height", boost::program_options::value<int>()->default_value(360),
+			"height of the smoothed noise frames")
+
+		//All possible options that will be allowed in config file for the regression tool
+		("Cfg.regression.workdir", boost::program_options::value<std::string>()->default_value("regression"),
+			"directory of the features and the extraction times of the regression runs")
+		("Cfg.regression.repetitions", boost::program_options::value<int>()->default_value(3),
+			"how often the master shots should be extracted and the ground truth evaluated, the median time of the runs is compared")
+		("Cfg.regression.baseline", boost::program_options::value<std::string>()->default_value(""),
+			"stored extraction times, the name is extended by the xtractor ID like General.measurements (empty = General.measurements)")
+		("Cfg.regression.tolerance", boost::program_options::value<float>()->default_value(1.5),
+			"which factor of its baseline median a shot may take, at least its slowest baseline time")
+		("Cfg.regression.aggregatetolerance", boost::program_options::value<float>()->default_value(1.25),
+			"which factor of the baseline sum all compared shots may take")
+		("Cfg.regression.slack", boost::program_options::value<float>()->default_value(0.05),
+			"how many seconds are added to each time limit")
+		("Cfg.regression.signatures", boost::program_options::value<std::string>()->default_value(""),
+			"directory of the stored <shot>.yml signatures (empty = the signatures are not compared)")
+		("Cfg.regression.epsilon", boost::program_options::value<float>()->default_value(1e-4),
+			"what is the maximal difference of a signature value")
+		("Cfg.regression.model", boost::program_options::value<std::string>()->default_value(""),
+			"stored features or collection file with which the ground truth (--infile) is evaluated (empty = no valuation)")
+		("Cfg.regression.map", boost::program_options::value<float>()->default_value(-1.0),
+			"expected mean average precision of the stored model (negative = not checked)")
+		("Cfg.regression.maptolerance", boost::program_options::value<float>()->default_value(0.001),
+			"what is the maximal difference of the mean average precision")
 		;
 
 
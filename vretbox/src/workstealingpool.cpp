@@ -0,0 +1,182 @@
+#include "workstealingpool.hpp"
+
+vretbox::WorkStealingPool::WorkStealingPool(int _threads)
+	: mQueued(0), mPending(0), mNextWorker(0), mStolen(0), mStop(false)
+{
+	if (_threads <= 0)
+	{
+		_threads = std::max<int>(1, boost::thread::hardware_concurrency());
+	}
+
+	for (int iWorker = 0; iWorker < _threads; iWorker++)
+	{
+		mWorkers.push_back(new Worker());
+	}
+
+	for (int iWorker = 0; iWorker < _threads; iWorker++)
+	{
+		mThreads.push_back(new boost::thread(boost::bind(&WorkStealingPool::work, this, iWorker)));
+	}
+}
+
+vretbox::WorkStealingPool::~WorkStealingPool()
+{
+	//an exception that is not collected by wait() is dropped, a destructor must not throw
+	waitForTasks();
+
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mStop = true;
+	}
+	mWakeUp.notify_all();
+
+	for (int iThread = 0; iThread < mThreads.size(); iThread++)
+	{
+		mThreads[iThread]->join();
+		delete mThreads[iThread];
+	}
+
+	for (int iWorker = 0; iWorker < mWorkers.size(); iWorker++)
+	{
+		delete mWorkers[iWorker];
+	}
+}
+
+void vretbox::WorkStealingPool::submit(Task _task)
+{
+	push(mNextWorker++ % mWorkers.size(), _task);
+}
+
+void vretbox::WorkStealingPool::spawn(int _worker, Task _task)
+{
+	push(_worker, _task);
+}
+
+void vretbox::WorkStealingPool::wait()
+{
+	waitForTasks();
+
+	std::exception_ptr error;
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		std::swap(error, mError);
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void vretbox::WorkStealingPool::waitForTasks()
+{
+	boost::mutex::scoped_lock lock(mMutex);
+	while (mPending > 0)
+	{
+		mDone.wait(lock);
+	}
+}
+
+int vretbox::WorkStealingPool::size() const
+{
+	return int(mWorkers.size());
+}
+
+int vretbox::WorkStealingPool::getStolenTasks() const
+{
+	return mStolen;
+}
+
+void vretbox::WorkStealingPool::push(int _worker, Task _task)
+{
+	mPending++;
+
+	{
+		boost::mutex::scoped_lock lock(mWorkers[_worker]->mMutex);
+		mWorkers[_worker]->mTasks.push_back(_task);
+	}
+
+	//the counter is changed under the pool lock, so a worker cannot miss the wake up
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mQueued++;
+	}
+	mWakeUp.notify_one();
+}
+
+bool vretbox::WorkStealingPool::pop(int _worker, Task& _task)
+{
+	boost::mutex::scoped_lock lock(mWorkers[_worker]->mMutex);
+	if (mWorkers[_worker]->mTasks.empty())
+	{
+		return false;
+	}
+
+	_task = mWorkers[_worker]->mTasks.back();
+	mWorkers[_worker]->mTasks.pop_back();
+	mQueued--;
+	return true;
+}
+
+bool vretbox::WorkStealingPool::steal(int _worker, Task& _task)
+{
+	int workerSize = mWorkers.size();
+	for (int iOffset = 1; iOffset < workerSize; iOffset++)
+	{
+		Worker* victim = mWorkers[(_worker + iOffset) % workerSize];
+
+		boost::mutex::scoped_lock lock(victim->mMutex);
+		if (!victim->mTasks.empty())
+		{
+			_task = victim->mTasks.front();
+			victim->mTasks.pop_front();
+			mQueued--;
+			mStolen++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void vretbox::WorkStealingPool::work(int _worker)
+{
+	Task task;
+	while (true)
+	{
+		if (pop(_worker, task) || steal(_worker, task))
+		{
+			//the task is counted as finished even if it fails, otherwise wait() would block forever
+			try
+			{
+				task(_worker);
+			}
+			catch (...)
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				if (!mError)
+				{
+					mError = std::current_exception();
+				}
+			}
+			task = nullptr;
+
+			if (--mPending == 0)
+			{
+				boost::mutex::scoped_lock lock(mMutex);
+				mDone.notify_all();
+			}
+			continue;
+		}
+
+		boost::mutex::scoped_lock lock(mMutex);
+		while (mQueued <= 0 && !mStop)
+		{
+			mWakeUp.wait(lock);
+		}
+
+		if (mStop && mQueued <= 0)
+		{
+			return;
+		}
+	}
+}
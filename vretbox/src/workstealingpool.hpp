@@ -0,0 +1,127 @@
+#ifndef _WORKSTEALINGPOOL_HPP_
+#define  _WORKSTEALINGPOOL_HPP_
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <exception>
+
+namespace vretbox {
+
+	/**
+	* \brief Bounded pool of worker threads with one task deque per worker.
+	* A worker takes tasks from the back of its own deque (newest first) and steals
+	* from the front of the other deques (oldest first) if its own deque is empty.
+	* Tasks spawned by a running task are pushed onto the deque of its worker.
+	* An exception of a task does not stop its worker, the first one is rethrown by wait().
+	*/
+	class WorkStealingPool
+	{
+	public:
+
+		/**
+		 * \brief A task receives the index of the worker that executes it
+		 */
+		typedef std::function<void(int)> Task;
+
+		/**
+		 * \brief Starts the workers
+		 * \param _threads number of workers, 0 = number of cores
+		 */
+		explicit WorkStealingPool(int _threads = 0);
+
+		/**
+		 * \brief Waits for all tasks and stops the workers
+		 */
+		~WorkStealingPool();
+
+		/**
+		 * \brief Adds a task from outside the pool; tasks are distributed round-robin
+		 * \param _task
+		 */
+		void submit(Task _task);
+
+		/**
+		 * \brief Adds a task from inside a running task to the deque of its worker
+		 * \param _worker index of the calling worker
+		 * \param _task
+		 */
+		void spawn(int _worker, Task _task);
+
+		/**
+		 * \brief Blocks until all submitted and spawned tasks are finished and rethrows
+		 * the first exception a task has thrown since the last wait
+		 */
+		void wait();
+
+		/**
+		 * \brief
+		 * \return number of workers
+		 */
+		int size() const;
+
+		/**
+		 * \brief
+		 * \return number of tasks a worker has taken from another worker
+		 */
+		int getStolenTasks() const;
+
+	private:
+
+		struct Worker
+		{
+			std::deque<Task> mTasks;
+			boost::mutex mMutex;
+		};
+
+		std::vector<Worker*> mWorkers;
+
+		std::vector<boost::thread*> mThreads;
+
+		/**
+		 * \brief guards the sleeping of idle workers and of wait()
+		 */
+		boost::mutex mMutex;
+
+		boost::condition_variable mWakeUp;
+
+		boost::condition_variable mDone;
+
+		/**
+		 * \brief number of tasks that are queued in any deque
+		 */
+		std::atomic<int> mQueued;
+
+		/**
+		 * \brief number of tasks that are queued or running
+		 */
+		std::atomic<int> mPending;
+
+		std::atomic<unsigned int> mNextWorker;
+
+		std::atomic<int> mStolen;
+
+		bool mStop;
+
+		/**
+		 * \brief first exception of a task, guarded by mMutex
+		 */
+		std::exception_ptr mError;
+
+		void push(int _worker, Task _task);
+
+		bool pop(int _worker, Task& _task);
+
+		bool steal(int _worker, Task& _task);
+
+		void work(int _worker);
+
+		void waitForTasks();
+	};
+}
+
+#endif //_WORKSTEALINGPOOL_HPP_
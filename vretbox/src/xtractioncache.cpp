@@ -0,0 +1,287 @@
+#include "xtractioncache.hpp"
+#include <cpluslogger.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+
+trecvid::XtractionCache::XtractionCache()
+	: mContentHash(false), mOpen(false), mLocked(false), mHits(0), mMisses(0)
+{
+}
+
+bool trecvid::XtractionCache::open(std::string _manifest, std::string _parameters, bool _contentHash)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+
+	mManifestFile = _manifest;
+	mParameters = toHex(hash(_parameters.data(), _parameters.size()));
+	mContentHash = _contentHash;
+	mOpen = false;
+	mLocked = false;
+
+	//the manifest and the lock file are created if they do not exist
+	{
+		std::ofstream manifest(mManifestFile, std::ofstream::out | std::ofstream::app);
+		if (!manifest.is_open())
+		{
+			LOG_ERROR("Manifest " << mManifestFile << " cannot be opened");
+			return false;
+		}
+	}
+
+	std::string lockFile = mManifestFile + ".lock";
+	{
+		std::ofstream(lockFile, std::ofstream::out | std::ofstream::app);
+	}
+	try
+	{
+		boost::interprocess::file_lock fileLock(lockFile.c_str());
+		mLock.swap(fileLock);
+		mLocked = true;
+	}
+	catch (boost::interprocess::interprocess_exception& e)
+	{
+		LOG_ERROR("Manifest " << mManifestFile << " is used without lock, it is not compacted: " << e.what());
+	}
+
+	int lines = 0;
+	{
+		boost::interprocess::sharable_lock<boost::interprocess::file_lock> fileLock;
+		if (mLocked)
+		{
+			boost::interprocess::sharable_lock<boost::interprocess::file_lock>(mLock).swap(fileLock);
+		}
+		mEntries.clear();
+		lines = read(mEntries);
+	}
+
+	int valid = 0;
+	for (auto iEntry = mEntries.begin(); iEntry != mEntries.end(); ++iEntry)
+	{
+		valid += iEntry->second.mParameters == mParameters ? 1 : 0;
+	}
+
+	mOpen = true;
+	LOG_INFO("Manifest " << mManifestFile << " with " << valid << " of " << lines << " entries for the parameters " << mParameters);
+	return true;
+}
+
+int trecvid::XtractionCache::read(std::unordered_map<std::string, Entry>& _entries) const
+{
+	int lines = 0;
+	std::ifstream manifest(mManifestFile);
+	std::string line;
+	while (std::getline(manifest, line))
+	{
+		lines++;
+		line.erase(line.find_last_not_of(" \r\n\t") + 1);
+
+		//the key is the rest of the line, it may contain commas
+		size_t status = line.find(',');
+		size_t fingerprint = status == std::string::npos ? status : line.find(',', status + 1);
+		size_t parameters = fingerprint == std::string::npos ? fingerprint : line.find(',', fingerprint + 1);
+		if (parameters == std::string::npos)
+		{
+			LOG_ERROR("Manifest " << mManifestFile << ": line " << lines << " is invalid and skipped");
+			continue;
+		}
+
+		Entry entry;
+		entry.mDone = line.substr(0, status) == "done";
+		entry.mFingerprint = line.substr(status + 1, fingerprint - status - 1);
+		entry.mParameters = line.substr(fingerprint + 1, parameters - fingerprint - 1);
+		_entries[line.substr(parameters + 1)] = entry;
+	}
+	return lines;
+}
+
+bool trecvid::XtractionCache::isOpen() const
+{
+	return mOpen;
+}
+
+void trecvid::XtractionCache::compact()
+{
+	boost::mutex::scoped_lock lock(mMutex);
+
+	if (!mOpen || !mLocked)
+	{
+		return;
+	}
+
+	//a process that appends or compacts the manifest holds the lock, the compaction is left to a later run
+	boost::interprocess::scoped_lock<boost::interprocess::file_lock> fileLock(mLock, boost::interprocess::try_to_lock);
+	if (!fileLock.owns())
+	{
+		LOG_INFO("Manifest " << mManifestFile << " is in use and not compacted");
+		return;
+	}
+
+	//the lines appended by other processes since open() are kept, also those of other parameters
+	std::unordered_map<std::string, Entry> entries;
+	int lines = read(entries);
+	if (size_t(lines) == entries.size())
+	{
+		return;
+	}
+
+	boost::system::error_code error;
+	std::string compacted = boost::filesystem::unique_path(mManifestFile + ".%%%%-%%%%-%%%%.tmp", error).string();
+	if (error)
+	{
+		LOG_ERROR("Manifest " << mManifestFile << " is not compacted: " << error.message());
+		return;
+	}
+
+	{
+		std::ofstream manifest(compacted, std::ofstream::out | std::ofstream::trunc);
+		for (auto iEntry = entries.begin(); iEntry != entries.end(); ++iEntry)
+		{
+			manifest << (iEntry->second.mDone ? "done" : "failed") << "," << iEntry->second.mFingerprint << ","
+				<< iEntry->second.mParameters << "," << iEntry->first << "\n";
+		}
+
+		manifest.close();
+		if (manifest.fail())
+		{
+			LOG_ERROR("Manifest " << compacted << " cannot be written, " << mManifestFile << " is not compacted");
+			boost::filesystem::remove(compacted, error);
+			return;
+		}
+	}
+
+	boost::filesystem::rename(compacted, mManifestFile, error);
+	if (error)
+	{
+		LOG_ERROR("Manifest " << mManifestFile << " is not compacted, it cannot be replaced: " << error.message());
+		boost::filesystem::remove(compacted, error);
+		return;
+	}
+
+	LOG_INFO("Manifest " << mManifestFile << " compacted from " << lines << " to " << entries.size() << " lines");
+}
+
+std::string trecvid::XtractionCache::fingerprint(std::string _video) const
+{
+	boost::system::error_code error;
+
+	if (!mContentHash)
+	{
+		uintmax_t size = boost::filesystem::file_size(_video, error);
+		if (error)
+		{
+			return "";
+		}
+
+		std::time_t time = boost::filesystem::last_write_time(_video, error);
+		if (error)
+		{
+			return "";
+		}
+
+		return std::to_string(size) + "-" + std::to_string(time);
+	}
+
+	std::ifstream video(_video, std::ifstream::in | std::ifstream::binary);
+	if (!video.is_open())
+	{
+		return "";
+	}
+
+	std::vector<char> buffer(1 << 20);
+	uint64_t value = hash(nullptr, 0);
+	while (video)
+	{
+		video.read(buffer.data(), buffer.size());
+		value = hash(buffer.data(), size_t(video.gcount()), value);
+	}
+
+	return "fnv" + toHex(value);
+}
+
+bool trecvid::XtractionCache::isXtracted(std::string _key, std::string _fingerprint, std::string _features)
+{
+	boost::mutex::scoped_lock lock(mMutex);
+
+	auto entry = mEntries.find(_key);
+	bool isHit = !_fingerprint.empty() && entry != mEntries.end() && entry->second.mDone
+		&& entry->second.mFingerprint == _fingerprint && entry->second.mParameters == mParameters
+		&& boost::filesystem::is_regular_file(_features);
+
+	if (isHit)
+	{
+		mHits++;
+	}
+	else
+	{
+		mMisses++;
+	}
+
+	return isHit;
+}
+
+void trecvid::XtractionCache::update(std::string _key, std::string _fingerprint, bool _done)
+{
+	//a video without fingerprint is extracted again in any case
+	if (_fingerprint.empty())
+	{
+		return;
+	}
+
+	boost::mutex::scoped_lock lock(mMutex);
+
+	Entry& entry = mEntries[_key];
+	entry.mFingerprint = _fingerprint;
+	entry.mParameters = mParameters;
+	entry.mDone = _done;
+
+	if (!mOpen)
+	{
+		return;
+	}
+
+	//the manifest is opened for each line, so it is never appended to a file replaced by a compaction
+	boost::interprocess::sharable_lock<boost::interprocess::file_lock> fileLock;
+	if (mLocked)
+	{
+		boost::interprocess::sharable_lock<boost::interprocess::file_lock>(mLock).swap(fileLock);
+	}
+
+	std::ofstream manifest(mManifestFile, std::ofstream::out | std::ofstream::app);
+	manifest << (_done ? "done" : "failed") << "," << _fingerprint << "," << mParameters << "," << _key << "\n";
+	manifest.close();
+	if (manifest.fail())
+	{
+		LOG_ERROR("Manifest " << mManifestFile << ": " << _key << " cannot be appended");
+	}
+}
+
+int trecvid::XtractionCache::getHits() const
+{
+	return mHits;
+}
+
+int trecvid::XtractionCache::getMisses() const
+{
+	return mMisses;
+}
+
+uint64_t trecvid::XtractionCache::hash(const char* _data, size_t _size, uint64_t _hash)
+{
+	for (size_t iByte = 0; iByte < _size; iByte++)
+	{
+		_hash ^= uint64_t(static_cast<unsigned char>(_data[iByte]));
+		_hash *= 1099511628211ULL;
+	}
+	return _hash;
+}
+
+std::string trecvid::XtractionCache::toHex(uint64_t _hash)
+{
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(_hash));
+	return hex;
+}
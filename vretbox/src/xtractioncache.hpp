@@ -0,0 +1,159 @@
+#ifndef _XTRACTIONCACHE_HPP_
+#define  _XTRACTIONCACHE_HPP_
+
+#include <boost/thread/mutex.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+namespace trecvid {
+
+	/**
+	* \brief Manifest of already extracted videos, so that a rerun only extracts new, changed or failed videos.
+	* An entry is keyed by the input (video file or master shot of a video) and records the fingerprint of the
+	* video (size and modification time or a content hash), the hash of the full extractor parameter set and
+	* its status. Each finished input is appended immediately, thus a crashed run resumes where it stopped.
+	* The manifest is a csv file with one <status>,<fingerprint>,<parameters>,<key> line per input,
+	* later lines replace earlier ones. Several processes may share a manifest: the lines are appended under
+	* a shared lock of <manifest>.lock, only compact() takes the exclusive lock and rewrites the manifest.
+	*/
+	class XtractionCache
+	{
+		struct Entry
+		{
+			std::string mFingerprint;
+
+			std::string mParameters;
+
+			bool mDone;
+		};
+
+		/**
+		 * \brief latest entry of each key
+		 */
+		std::unordered_map<std::string, Entry> mEntries;
+
+		/**
+		 * \brief hash of the extractor parameters of this run
+		 */
+		std::string mParameters;
+
+		/**
+		 * \brief hash the video content instead of using its size and modification time
+		 */
+		bool mContentHash;
+
+		std::string mManifestFile;
+
+		/**
+		 * \brief true if the manifest can be appended
+		 */
+		bool mOpen;
+
+		/**
+		 * \brief lock of the manifest shared by all processes, not valid if the lock file cannot be created
+		 */
+		boost::interprocess::file_lock mLock;
+
+		bool mLocked;
+
+		/**
+		 * \brief guards the entries and the manifest, the workers of a batch share the cache
+		 */
+		boost::mutex mMutex;
+
+		int mHits;
+
+		int mMisses;
+
+		/**
+		 * \brief Reads the latest entry of each key of the manifest
+		 * \param _entries
+		 * \return number of lines
+		 */
+		int read(std::unordered_map<std::string, Entry>& _entries) const;
+
+	public:
+
+		/**
+		 * \brief
+		 */
+		XtractionCache();
+
+		/**
+		 * \brief Reads the manifest, the finished inputs are appended to it
+		 * \param _manifest manifest file, created if it does not exist
+		 * \param _parameters full extractor parameter set, entries of other parameters are invalid
+		 * \param _contentHash hash the video content instead of using its size and modification time
+		 * \return true if the manifest can be written, otherwise false
+		 */
+		bool open(std::string _manifest, std::string _parameters, bool _contentHash);
+
+		/**
+		 * \brief
+		 * \return true if the manifest is open
+		 */
+		bool isOpen() const;
+
+		/**
+		 * \brief Rewrites the manifest with the latest line of each key. It is skipped if another process uses
+		 * the manifest; a failure is logged and keeps the manifest as it is.
+		 */
+		void compact();
+
+		/**
+		 * \brief Identifies the content of a video: "<size>-<modification time>" or the 64 bit FNV-1a hash of the file
+		 * \param _video
+		 * \return the fingerprint or an empty string if the file cannot be read
+		 */
+		std::string fingerprint(std::string _video) const;
+
+		/**
+		 * \brief Checks if an input is already extracted with the same content and parameters
+		 * \param _key input (video file or master shot)
+		 * \param _fingerprint fingerprint of the video
+		 * \param _features feature file of the input, it has to exist
+		 * \return true if the extraction can be skipped, otherwise false
+		 */
+		bool isXtracted(std::string _key, std::string _fingerprint, std::string _features);
+
+		/**
+		 * \brief Records the status of an input and appends it to the manifest
+		 * \param _key input (video file or master shot)
+		 * \param _fingerprint fingerprint of the video
+		 * \param _done true if the features are written, false if the extraction failed
+		 */
+		void update(std::string _key, std::string _fingerprint, bool _done);
+
+		/**
+		 * \brief
+		 * \return number of skipped inputs
+		 */
+		int getHits() const;
+
+		/**
+		 * \brief
+		 * \return number of inputs that have to be extracted
+		 */
+		int getMisses() const;
+
+		/**
+		 * \brief 64 bit FNV-1a hash
+		 * \param _data
+		 * \param _size number of bytes
+		 * \param _hash hash of the preceding data
+		 * \return
+		 */
+		static uint64_t hash(const char* _data, size_t _size, uint64_t _hash = 14695981039346656037ULL);
+
+		/**
+		 * \brief
+		 * \param _hash
+		 * \return hexadecimal representation of a hash
+		 */
+		static std::string toHex(uint64_t _hash);
+	};
+}
+
+#endif //_XTRACTIONCACHE_HPP_